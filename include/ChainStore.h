@@ -0,0 +1,75 @@
+// ChainStore.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <rocksdb/db.h>
+
+/**
+ * ChainStore :: append-only block log of the blockchain ledger, with the
+ * per-account indexes its queries need, in the "blockchain_log" column
+ * family (next to the "blockchain" kv family that keeps the rules).
+ *
+ *   b <index:8 BE>                          block JSON, as appended
+ *   a <account> \0 <timestamp> \0 <seq:12>  account's running balances
+ *                                           ({unit: value}) after that tx
+ *   x <account> \0 <seq:12>                 the tx, with blockIndex,
+ *                                           blockHash and blockTimestamp
+ *
+ * seq is the block index (8 bytes BE) and the tx's position in the block
+ * (4 bytes BE). A block and all its index entries go in one WriteBatch, so
+ * readers never see one without the other.
+ *
+ * append() is O(postings): it reads the running balance just before the new
+ * entry and writes the new one. A tx older than the account's latest entry
+ * (clock skew) also shifts the running balances after it. balance() is a
+ * single SeekForPrev, transactions() a prefix scan from the cursor.
+ *
+ * Block hashes are computed in JS (ledger.js); append() checks that a block
+ * continues the chain (index, previousHash) but doesn't rehash it.
+ */
+class ChainStore {
+public:
+    static ChainStore& instance();
+
+    // append one block (its JSON text); throws std::runtime_error if it is
+    // malformed or doesn't follow the last block. Returns the new length.
+    uint64_t append(const std::string& blockJson);
+
+    uint64_t length();
+
+    // block JSON; false if there is no such block
+    bool block(uint64_t index, std::string& out);
+
+    // JSON array of up to limit blocks from index from on, in order: one
+    // forward scan of the block keys
+    std::string blocks(uint64_t from, size_t limit);
+
+    // {unit: value} JSON of the account's postings (debit +, credit -) up to
+    // and including asOf (an ISO-8601 UTC timestamp, compared as text);
+    // empty asOf means all of them
+    std::string balance(const std::string& account, const std::string& asOf);
+
+    // JSON array of up to limit of the account's transactions, oldest first,
+    // starting after cursor ("" = from the start). next is the cursor of the
+    // following page, "" after the last one.
+    std::string transactions(const std::string& account, const std::string& cursor,
+                             size_t limit, std::string& next);
+
+private:
+    ChainStore() = default;
+    ChainStore(const ChainStore&) = delete;
+    ChainStore& operator=(const ChainStore&) = delete;
+
+    rocksdb::ColumnFamilyHandle* family();
+    void loadTail();   // _length/_lastHash from the last block; holds _mu
+
+    std::mutex                                _mu;   // appends, one at a time
+    std::atomic<rocksdb::ColumnFamilyHandle*> _cf{nullptr};
+    bool                                      _loaded = false;
+    uint64_t                                  _length = 0;
+    std::string                               _lastHash;
+};
@@ -0,0 +1,36 @@
+// include/CryptoUtils.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * SHA-256 of the given bytes, as lowercase hex.
+ */
+std::string CppSha256(const std::string& data);
+
+/**
+ * PBKDF2-HMAC-SHA256 of password with salt, 32-byte key as lowercase hex.
+ *
+ * @param iterations  work factor
+ * @throws std::runtime_error if OpenSSL fails
+ */
+std::string CppPbkdf2(const std::string& password, const std::string& salt,
+                      uint32_t iterations = 100000);
+
+/**
+ * scrypt of password with salt, 32-byte key as lowercase hex.
+ *
+ * @param N  CPU/memory cost (power of two), r block size, p parallelism
+ * @throws std::runtime_error on invalid parameters or OpenSSL failure
+ */
+std::string CppScrypt(const std::string& password, const std::string& salt,
+                      uint64_t N = 16384, uint64_t r = 8, uint64_t p = 1);
+
+/**
+ * Random id of len characters from [a-zA-Z0-9], drawn from the OpenSSL CSPRNG
+ * without modulo bias.
+ *
+ * @throws std::runtime_error if the CSPRNG fails
+ */
+std::string CppRandomId(size_t len = 16);
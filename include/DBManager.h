@@ -4,8 +4,17 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <unordered_map>
 #include <rocksdb/db.h>
+#include <rocksdb/utilities/optimistic_transaction_db.h>
+#include <rocksdb/utilities/transaction.h>
+#include <rocksdb/utilities/write_batch_with_index.h>
 #include "Query.h"
+#include "Predicate.h"
+#include "ViewManager.h"
 
 class DBManager {
 public:
@@ -18,7 +27,7 @@ public:
     // get or create column family
     rocksdb::ColumnFamilyHandle* cf(const std::string& name);
 
-    // Basic CRUD used by QueryExecutor
+    // Basic CRUD used by QueryExecutor (keeps IndexManager in sync)
     void insert(const std::string &table,
                 const std::map<std::string,std::string> &row);
     void update(const std::string &table,
@@ -34,6 +43,151 @@ public:
            int skip  = 0,
            int limit = -1) const;
 
+    // streaming scan: calls fn(key,row) for every row matching conds, in key
+    // order, until fn returns false. Rows are parsed straight from the
+    // iterator, nothing is materialized. An = or prefix LIKE on an indexed
+    // field turns the scan into an index seek. With after, the scan starts
+    // at the first key greater than *after (a seek, nothing is skipped).
+    using RowFn = std::function<bool(const std::string&,
+                                     std::map<std::string,std::string>&)>;
+    void scanEach(const std::string &table,
+                  const std::vector<Condition> &conds,
+                  const RowFn &fn) const;
+    void scanEach(const std::string &table,
+                  const Predicate &pred,
+                  const RowFn &fn,
+                  const std::string *after = nullptr) const;
+
+    // index seek for pred: when an = or prefix LIKE condition is on an
+    // indexed field, fills keys with the candidate row keys (sorted, unique;
+    // the full predicate still has to be checked) and returns true
+    bool seekKeys(const std::string &table,
+                  const Predicate &pred,
+                  std::vector<std::string> &keys) const;
+
+    // Half-open key range [begin, end); empty begin/end mean unbounded
+    struct KeyRange {
+        std::string begin;
+        std::string end;
+    };
+
+    // split the table's key space into at most n ranges of roughly equal
+    // on-disk size, using SST file boundaries. Returns a single unbounded
+    // range when the table is too small to split.
+    std::vector<KeyRange> partition(const std::string &table, size_t n);
+
+    // parallel scan: each range is scanned and filtered on the WorkerPool
+    // against one shared snapshot. fn(part,key,row) is called concurrently
+    // for different parts, in key order within a part; fn returning false
+    // stops that part only. An index-seekable predicate runs serially as
+    // part 0.
+    using PartRowFn = std::function<bool(size_t part,
+                                         const std::string&,
+                                         std::map<std::string,std::string>&)>;
+    void scanParallel(const std::string &table,
+                      const Predicate &pred,
+                      const std::vector<KeyRange> &ranges,
+                      const PartRowFn &fn);
+
+    // Writes grouped into one atomic unit. While a WriteScope (a Batch or a
+    // Transaction) is open on a thread, insert/update/remove on that thread
+    // go into it instead of the DB: get() and the old-row lookups behind
+    // index maintenance see them, but nothing is visible to other threads
+    // (or to scans, including the WHERE scans of UPDATE/DELETE) until the
+    // commit, after which the index changes are applied in statement order
+    // and the written tables' versions bumped (see tableVersion()).
+    // A scope destroyed without committing drops its writes. Scopes don't
+    // nest; inScope() tells whether one is open. Materialized views of the
+    // tables written are updated in the same scope (see ViewManager).
+    class WriteScope {
+    public:
+        virtual ~WriteScope();
+        WriteScope(const WriteScope&) = delete;
+        WriteScope& operator=(const WriteScope&) = delete;
+
+    protected:
+        WriteScope();
+        virtual bool get(rocksdb::ColumnFamilyHandle* h, const std::string &key, std::string &val) = 0;
+        virtual void put(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) = 0;
+        virtual void del(rocksdb::ColumnFamilyHandle* h, const std::string &key) = 0;
+        // row count deltas (see rowCount()), untracked by conflict checks
+        virtual void merge(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) = 0;
+        void close();          // stop routing this thread's writes here
+        void addCounts();      // merge the row count deltas, before the commit
+        void applyIndexOps();
+        void resketchViews();  // view groups whose sketches lost a value
+        void bumpVersions();   // of the tables written, after the commit
+
+    private:
+        friend class DBManager;
+        std::vector<std::function<void()>> _indexOps;   // run after the commit
+        std::set<std::string>              _written;    // tables (and views) written
+        std::map<std::string,int64_t>      _counts;     // row count deltas per table
+        std::set<std::pair<std::string,std::string>> _resketch;   // (view, group key)
+        std::unique_lock<std::mutex>       _viewLock;   // ViewManager::writeMutex, once views are written
+    };
+
+    // Blind writes committed as one WriteBatch (no conflict checks)
+    class Batch : public WriteScope {
+    public:
+        Batch();
+        void   commit();            // throws std::runtime_error if the write fails
+        size_t count() { return (size_t)_wb.GetWriteBatch()->Count(); }
+
+    protected:
+        bool get(rocksdb::ColumnFamilyHandle* h, const std::string &key, std::string &val) override;
+        void put(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) override;
+        void del(rocksdb::ColumnFamilyHandle* h, const std::string &key) override;
+        void merge(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) override;
+
+    private:
+        rocksdb::WriteBatchWithIndex _wb;
+        bool                         _done = false;
+    };
+
+    // Optimistic transaction: rows read by key (the read behind UPDATE's
+    // merge, the old-row lookups of INSERT/DELETE) are tracked, and commit()
+    // fails with a conflict if another writer changed any tracked or written
+    // key since the transaction began. Scans are not tracked.
+    class Transaction : public WriteScope {
+    public:
+        Transaction();
+        ~Transaction() override;    // rolls back if not committed
+
+        // false on a write conflict (nothing written; run the work again in
+        // a new Transaction); throws std::runtime_error on other failures
+        bool commit();
+
+    protected:
+        bool get(rocksdb::ColumnFamilyHandle* h, const std::string &key, std::string &val) override;
+        void put(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) override;
+        void del(rocksdb::ColumnFamilyHandle* h, const std::string &key) override;
+        void merge(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) override;
+
+    private:
+        std::unique_ptr<rocksdb::Transaction> _txn;
+        bool                                  _done = false;
+    };
+
+    static bool inScope();
+
+    // Write version of a table (or view, or kv family): bumped after every
+    // committed write to it, so a result read while the versions of its
+    // tables were unchanged is still current (see QueryCache). Read the
+    // versions before reading the data.
+    uint64_t tableVersion(const std::string &table);
+    void     bumpVersion(const std::string &table);
+
+    // Number of rows in a table declared in schemas.json, or -1 for other
+    // tables (views, kv families). Read from a counter in the "__counts"
+    // column family that insert/update/remove adjust with a merge in the
+    // same write as the row: O(1), no scan. Counters are rebuilt by a scan
+    // when missing (first start). A write outside a scope runs in its own
+    // Transaction, so two writers creating or deleting the same key can't
+    // both count it. Inside a Batch (no conflict checks) that is up to the
+    // caller, as for the rows themselves.
+    int64_t rowCount(const std::string &table) const;
+
     // fetch & parse one row
     std::map<std::string,std::string>
       get(const std::string &table,
@@ -46,7 +200,37 @@ public:
 
 private:
     DBManager() = default;
-    std::unique_ptr<rocksdb::DB>                       _db;
+
+    // point read / write that go through the thread's open WriteScope, if any
+    bool readRaw(rocksdb::ColumnFamilyHandle* h, const std::string &key, std::string &val) const;
+    void writeRow(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val);
+    void deleteRow(rocksdb::ColumnFamilyHandle* h, const std::string &key);
+    // index maintenance now, or after the open WriteScope commits
+    static void indexOp(std::function<void()> op);
+    // table was written: bump its version now, or after the open WriteScope
+    // commits
+    void written(const std::string &table);
+    // table gained (+1) or lost (-1) a row: added to the open WriteScope's
+    // counts, merged into "__counts" at its commit
+    void countRow(const std::string &table, int64_t delta);
+    // run a write in its own Transaction, again after a conflict: the
+    // existence check behind the row count is validated at commit
+    void inTransaction(const std::function<void()> &write);
+    // true when table has materialized views: makes sure a WriteScope is
+    // open (own holds a new Batch when the caller had none, to commit after
+    // the write) and holds the view write lock until that scope ends
+    bool beginViewWrite(const std::string &table, std::unique_ptr<Batch> &own);
+    // apply the row change to the table's views, through the open WriteScope
+    void updateViews(const std::string &table,
+                     const std::map<std::string,std::string> *oldRow,
+                     const std::map<std::string,std::string> *newRow);
+
+    std::unique_ptr<rocksdb::DB>                       _db;       // the OptimisticTransactionDB
+    rocksdb::OptimisticTransactionDB*                  _txnDb = nullptr;
     std::map<std::string, rocksdb::ColumnFamilyHandle*> _cfs;
+    rocksdb::ColumnFamilyHandle*                       _countsCf = nullptr; // "__counts", see rowCount()
+    std::mutex                                         _cfMutex;   // cf() may create CFs concurrently
+    std::mutex                                         _verMutex;
+    std::unordered_map<std::string, uint64_t>          _versions;  // see tableVersion()
 };
 
@@ -0,0 +1,70 @@
+// ExternalSorter.h
+#ifndef EXTERNALSORTER_H
+#define EXTERNALSORTER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <cstddef>
+
+/**
+ * ExternalSorter :: sorts result rows under a fixed memory budget.
+ *
+ * Rows are buffered in memory until the budget is exceeded; the buffer is then
+ * sorted and spilled to a run file in the temp directory. finish() k-way merges
+ * all runs (plus whatever is still in memory) and streams rows out in order, so
+ * an ORDER BY over a large table never needs the whole result in RAM. At most
+ * 64 runs are merged at once; beyond that, intermediate passes merge groups of
+ * runs into longer ones first, keeping open file descriptors bounded.
+ *
+ * The sort is stable: rows comparing equal come out in insertion order.
+ */
+class ExternalSorter {
+public:
+    using Row  = std::map<std::string,std::string>;
+    using Less = std::function<bool(const Row&, const Row&)>;
+
+    explicit ExternalSorter(Less less,
+                            size_t memoryBudget = defaultMemoryBudget(),
+                            std::string tempDir = defaultTempDir());
+    ~ExternalSorter();   // removes any run files still on disk
+
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+    // buffer one row, spilling a sorted run when over budget
+    void add(Row row);
+
+    // stream all rows in sorted order; fn returns false to stop early
+    // (e.g. once SKIP/LIMIT is satisfied). Can be called once.
+    void finish(const std::function<bool(Row&)>& fn);
+
+    size_t runCount() const { return _runs.size(); }
+
+    // process-wide defaults (set from main.cpp via environment)
+    static size_t defaultMemoryBudget();
+    static void   setDefaultMemoryBudget(size_t bytes);
+    static std::string defaultTempDir();
+    static void   setDefaultTempDir(const std::string& dir);
+
+    // convenience: order rows by one column, ASC or DESC
+    static Less byField(const std::string& field, bool desc);
+
+private:
+    void spill();
+    std::string newRunPath() const;
+    // k-way merge of _runs[first, last) into fn
+    void mergeRuns(size_t first, size_t last, const std::function<bool(Row&)>& fn);
+    static size_t rowBytes(const Row& row);
+
+    Less                     _less;
+    size_t                   _budget;
+    std::string              _tempDir;
+    std::vector<Row>         _buffer;
+    size_t                   _bufferBytes = 0;
+    std::vector<std::string> _runs;      // run file paths, in spill order
+    bool                     _finished = false;
+};
+
+#endif // EXTERNALSORTER_H
@@ -5,16 +5,55 @@
 #include <string>
 #include <unordered_map>
 #include <map>
+#include <set>
+#include <utility>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
 
 class IndexManager {
 public:
-    // table ? ( field ? multimap<value, key> )
+    // one index entry: (value, key); entries are ordered by value, then key
+    using Entry   = std::pair<std::string,std::string>;
+    using Entries = std::set<Entry>;
+
+    // table ? ( field ? entries )
     static std::unordered_map<
       std::string,
-      std::unordered_map<std::string,
-        std::multimap<std::string,std::string>>
+      std::unordered_map<std::string, Entries>
     > index;
 
+    // guards `index`: queries run concurrently with writes, so readers
+    // take it shared (the lookups below do) and add/remove take it unique
+    static std::shared_mutex mutex;
+
+    // keys whose field equals value / starts with prefix, in value order
+    static std::vector<std::string> lookup(const std::string &table,
+                                           const std::string &field,
+                                           const std::string &value);
+    static std::vector<std::string> lookupPrefix(const std::string &table,
+                                                 const std::string &field,
+                                                 const std::string &prefix);
+    // keys ordered by field (ASC or DESC), after skipping `skip`, at most
+    // `limit` of them (-1 = all)
+    static std::vector<std::string> orderedKeys(const std::string &table,
+                                                const std::string &field,
+                                                bool desc, int skip, int limit);
+
+    // up to n entries strictly after `after` ((value, key) order, reversed
+    // when desc), from the start when after is null: one seek, so reading
+    // the index page by page costs the same at any depth
+    static std::vector<Entry> entriesAfter(const std::string &table,
+                                           const std::string &field,
+                                           bool desc, const Entry *after,
+                                           size_t n);
+    // number of entries in table.field's index (0 if none)
+    static size_t size(const std::string &table, const std::string &field);
+    // number of rows whose field equals value, kept next to the index so
+    // it's O(1) (0 if not indexed; empty values aren't indexed)
+    static size_t count(const std::string &table, const std::string &field,
+                        const std::string &value);
+
     static bool hasIndex(const std::string &table,
                          const std::string &field);
 
@@ -0,0 +1,125 @@
+// IsolatePool.h
+#pragma once
+
+#include <v8.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * IsolatePool :: N independent V8 isolates, each with its own context.
+ *
+ * Every isolate gets the same setup (bindings + auth/sanitize/business
+ * scripts) from the init callback, so any of them can serve any request.
+ * A request checks one out with a Lease and is the only user of that
+ * isolate until the lease ends; requests on different isolates run JS in
+ * parallel. Per-isolate state lives in the Slot, reachable from callbacks
+ * via IsolatePool::slot(isolate).
+ *
+ * Setup can be done once into a V8 startup snapshot (createSnapshot); the
+ * isolates are then deserialized from it with the scripts already
+ * evaluated, instead of each compiling and running them again.
+ *
+ * Nothing is shared between isolates implicitly: JS module variables are
+ * per isolate. State that must be process-wide goes through C++ (the
+ * database, or the `shared` object bound in main.cpp).
+ */
+class IsolatePool {
+public:
+    struct Slot {
+        size_t                                  index = 0;
+        v8::Isolate*                            isolate = nullptr;
+        v8::Global<v8::Context>                 context;
+        std::unique_ptr<v8::ArrayBuffer::Allocator> allocator;
+        bool                                    busy = false;
+
+        // native async work started from this isolate (db.queryAsync ...)
+        std::mutex                              taskMu;
+        std::condition_variable                 taskCv;
+        std::deque<std::function<void()>>       tasks;      // posted completions
+        size_t                                  inflight = 0;
+    };
+
+    // runs with the isolate locked and entered and its context entered;
+    // returns false if setup failed
+    using InitFn = std::function<bool(Slot&)>;
+
+    static IsolatePool& instance();
+
+    // create n isolates and run init on each; false if any init fails.
+    // With a snapshot blob (from createSnapshot, same externalRefs) the
+    // isolates start from the snapshotted context and init is not run.
+    bool init(size_t n, const InitFn& init,
+              std::string snapshot = std::string(),
+              const intptr_t* externalRefs = nullptr);
+
+    // Run init once in a snapshot-creating isolate and serialize the result.
+    // externalRefs: null-terminated list of every native callback the
+    // context references. Empty string if init fails.
+    static std::string createSnapshot(const InitFn& init, const intptr_t* externalRefs);
+
+    // require() cache of a context: a plain object (name -> exports) kept
+    // in the context's embedder data, so it is snapshotted with the modules
+    static v8::Local<v8::Object> moduleRegistry(v8::Isolate* iso, v8::Local<v8::Context> ctx);
+    bool ready() const { return _ready; }
+    size_t size() const { return _slots.size(); }
+
+    // per-isolate slot, stored in the isolate's data slot 0
+    static Slot* slot(v8::Isolate* iso) {
+        return static_cast<Slot*>(iso->GetData(0));
+    }
+
+    // Async native work: beginAsync() when an operation starts (on the
+    // isolate's thread), post() its completion from whatever thread finishes
+    // it. The completion runs later on the thread holding the isolate, inside
+    // a HandleScope with the context entered, when that thread calls
+    // runPosted(). With wait, runPosted() blocks until something arrives
+    // unless nothing is in flight; it returns false if it ran nothing.
+    static void beginAsync(Slot& s);
+    static void post(Slot& s, std::function<void()> task);
+    static bool runPosted(Slot& s, bool wait);
+
+    // Exclusive use of one isolate. The holder still takes a v8::Locker on
+    // its own stack, since isolates move between threads.
+    class Lease {
+    public:
+        explicit Lease(IsolatePool& pool = IsolatePool::instance());
+        Lease(IsolatePool& pool, size_t index);   // a specific isolate
+        ~Lease();
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        Slot&        slot()    { return *_slot; }
+        v8::Isolate* isolate() { return _slot->isolate; }
+        // only valid inside a HandleScope
+        v8::Local<v8::Context> context() { return _slot->context.Get(_slot->isolate); }
+
+    private:
+        IsolatePool& _pool;
+        Slot*        _slot;
+    };
+
+    // run fn on every isolate in turn (waits for each to be free), e.g. to
+    // hot-load a module everywhere
+    void forEach(const std::function<void(Slot&)>& fn);
+
+private:
+    IsolatePool() = default;
+
+    Slot* acquire(size_t index);   // index == size() means any
+    void  release(Slot* s);
+
+    static constexpr int kModuleRegistryIndex = 1;   // context embedder data
+
+    std::vector<std::unique_ptr<Slot>> _slots;
+    std::string                        _snapshot;    // must outlive the isolates
+    v8::StartupData                    _blob{nullptr, 0};
+    std::mutex                         _mu;
+    std::condition_variable            _cv;
+    bool                               _ready = false;
+};
@@ -20,6 +20,7 @@ namespace JsonUtils{
 	
 	/**
 	 * evalPredicate :: compare a fieldValue against an operator and literal
+	 *   - LIKE / ILIKE patterns are compiled once and cached per thread
 	 */
 	bool evalPredicate(const std::string& fieldValue,
 	                   const std::string& op,
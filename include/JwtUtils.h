@@ -1,5 +1,7 @@
 // include/JwtUtils.h
 #pragma once
+#include <cstddef>
+#include <memory>
 #include <string>
 
 /**
@@ -22,3 +24,34 @@ std::string CppSignJwt(const std::string& payloadJson, const std::string& secret
  */
 std::string CppVerifyJwt(const std::string& token, const std::string& secret);
 
+
+/**
+ * JwtVerifier :: HS256 verification with one prebuilt verifier and a bounded
+ * LRU of already-verified tokens.
+ *
+ * Entries are keyed by the SHA-256 of the token and hold the payload JSON;
+ * an entry is dropped once the token's `exp` (top-level or in the data
+ * claim) has passed, and after a few minutes in any case. Safe to call from
+ * any thread; configure() is meant for startup.
+ */
+class JwtVerifier {
+public:
+    static JwtVerifier& instance();
+
+    // server secret (used when CppSignJwt/CppVerifyJwt get no secret) and
+    // cache size; clears the cache
+    void configure(const std::string& secret, size_t capacity);
+    const std::string& secret() const { return _secret; }
+
+    // Returns the payload ("data" claim) as JSON, from the cache when
+    // possible. @throws std::runtime_error if the token is invalid or expired
+    std::string verify(const std::string& token);
+
+    ~JwtVerifier();
+
+private:
+    JwtVerifier();
+    struct Impl;
+    std::string           _secret;
+    std::unique_ptr<Impl> _impl;
+};
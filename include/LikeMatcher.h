@@ -0,0 +1,62 @@
+// LikeMatcher.h
+#ifndef LIKEMATCHER_H
+#define LIKEMATCHER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+/**
+ * LikeMatcher :: SQL LIKE / ILIKE pattern compiled once per query.
+ *
+ *   %  matches any run of characters (including none)
+ *   _  matches exactly one character
+ *   \  escapes a following %, _ or \
+ *
+ * The pattern is classified up front so the common shapes avoid generic
+ * wildcard matching: 'abc' (exact), 'abc%' (prefix), '%abc' (suffix) and
+ * '%abc%' (infix, SIMD substring search). Anything else is matched
+ * segment by segment. ILIKE folds ASCII case on both sides.
+ */
+class LikeMatcher {
+public:
+    enum class Kind { Exact, Prefix, Suffix, Contains, All, General };
+
+    explicit LikeMatcher(const std::string& pattern, bool caseInsensitive = false);
+
+    bool matches(std::string_view s) const;
+
+    Kind kind() const { return _kind; }
+    bool caseInsensitive() const { return _icase; }
+
+    // Literal text before the first wildcard; for Kind::Prefix this is the
+    // whole pattern minus the trailing %, usable as an index range seek
+    const std::string& literalPrefix() const { return _prefix; }
+
+    // Substring search (SSE2 first/last-byte filter, memmem fallback)
+    static size_t find(std::string_view hay, std::string_view needle, size_t from = 0);
+
+private:
+    // one %-delimited piece; '_' positions are wildcards
+    struct Segment {
+        std::string text;
+        std::string mask;             // 1 where text holds a '_' wildcard
+        bool        hasAny = false;   // contains '_'
+    };
+
+    bool matchGeneral(std::string_view s) const;
+    static bool segmentAt(std::string_view s, size_t pos, const Segment& seg);
+    static size_t findSegment(std::string_view s, size_t from, const Segment& seg);
+
+    Kind                 _kind = Kind::Exact;
+    bool                 _icase = false;
+    std::string          _literal;      // Exact/Prefix/Suffix/Contains operand
+    std::string          _prefix;
+    std::vector<Segment> _segments;     // General
+    bool                 _leadingAny  = false;
+    bool                 _trailingAny = false;
+    bool                 _exactLength = false;   // General without any %
+};
+
+#endif // LIKEMATCHER_H
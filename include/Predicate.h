@@ -0,0 +1,71 @@
+// Predicate.h
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <memory>
+#include "Query.h"
+#include "LikeMatcher.h"
+
+// Comparison operators, resolved once from Condition::op
+enum class CmpOp { EQ, NE, LT, GT, LE, GE, LIKE, ILIKE };
+
+// How a column is compared: taken from the table schema when declared,
+// otherwise inferred from the literal
+enum class ValueType { String, Number, Date };
+
+// One WHERE condition compiled for repeated evaluation
+struct CompiledCondition {
+    std::string key;                 // unqualified column name
+    CmpOp       op   = CmpOp::EQ;
+    ValueType   type = ValueType::String;
+    bool        declared = false;    // type came from the schema
+    std::string text;                // literal as written
+    double      num = 0.0;           // pre-parsed literal (Number)
+    int64_t     day = 0;             // pre-parsed literal (Date, days since epoch)
+    std::shared_ptr<const LikeMatcher> like;   // LIKE / ILIKE pattern
+
+    bool matches(const std::string &value) const;
+
+    // true when the condition can be answered from a text index on `key`:
+    // text equality, or a case-sensitive LIKE with a literal prefix
+    bool indexable() const;
+};
+
+/**
+ * Predicate :: a conjunction of WHERE conditions compiled once per query.
+ *
+ * Operators become an enum and literals are parsed up front, so the per-row
+ * cost is a map lookup plus a typed compare. Number columns compare
+ * numerically (`debit > '100'` no longer compares as text) and Date columns
+ * compare by calendar day. Columns without a declared type fall back to
+ * numeric/date ordering only when both sides parse, and keep exact text
+ * equality for = / != so codes like '0100' stay distinct from '100'.
+ * LIKE / ILIKE patterns are compiled once into a LikeMatcher.
+ */
+class Predicate {
+public:
+    Predicate() = default;
+
+    // table is used to look up declared column types; qualified keys
+    // ("table.col") are resolved against their own table
+    static Predicate compile(const std::string &table,
+                             const std::vector<Condition> &conds);
+
+    bool matches(const std::map<std::string,std::string> &row) const;
+
+    bool empty() const { return _conds.empty(); }
+    const std::vector<CompiledCondition>& conditions() const { return _conds; }
+
+    static CmpOp parseOp(const std::string &op);
+    static bool  parseNumber(const std::string &s, double &out);
+    static bool  parseDay(const std::string &s, int64_t &out);   // YYYY-MM-DD[...]
+
+private:
+    std::vector<CompiledCondition> _conds;
+};
+
+#endif // PREDICATE_H
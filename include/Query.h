@@ -8,7 +8,8 @@
 #include <iostream>
 
 // Supported query types
-enum class QueryType { INSERT, UPDATE, DELETE, BATCH, SELECT };
+enum class QueryType { INSERT, UPDATE, DELETE, BATCH, SELECT,
+                       CREATE_VIEW, DROP_VIEW, REFRESH_VIEW };
 inline const char* qt_string(QueryType t) {
     switch (t) {
         case QueryType::INSERT: return "INSERT";
@@ -16,6 +17,9 @@ inline const char* qt_string(QueryType t) {
         case QueryType::DELETE: return "DELETE";
         case QueryType::BATCH:  return "BATCH";
         case QueryType::SELECT: return "SELECT";
+        case QueryType::CREATE_VIEW:  return "CREATE MATERIALIZED VIEW";
+        case QueryType::DROP_VIEW:    return "DROP MATERIALIZED VIEW";
+        case QueryType::REFRESH_VIEW: return "REFRESH MATERIALIZED VIEW";
     }
     return "UNKNOWN";
 }
@@ -23,7 +27,7 @@ inline const char* qt_string(QueryType t) {
 // One condition in a WHERE clause
 struct Condition {
     std::string key;     // column or qualified column (table.column)
-    std::string op;      // =, !=, <, >, <=, >=, LIKE
+    std::string op;      // =, !=, <, >, <=, >=, LIKE, ILIKE
     std::string value;   // right-hand-side value
 };
 
@@ -38,9 +42,22 @@ struct Join {
 
 // Aggregation spec
 struct AggSpec {
-    enum Type { SUM } type = SUM;
+    enum Type { SUM, APPROX_COUNT_DISTINCT, APPROX_PERCENTILE } type = SUM;
     std::string field;   // e.g. debit
     std::string alias;   // e.g. debit (from "AS debit"), optional
+    double param = 0.0;  // APPROX_PERCENTILE: the quantile, 0..1
+};
+
+// Window function: SUM(a [- b ...]) / ROW_NUMBER() / LAG(col[, n[, default]])
+// OVER ([PARTITION BY f, ...] [ORDER BY f [ASC|DESC], ...])
+struct WindowSpec {
+    enum Func { SUM, ROW_NUMBER, LAG } func = SUM;
+    std::vector<std::pair<std::string,int>> terms;    // SUM: column, +1 / -1; LAG: the column
+    int offset = 1;                                   // LAG: rows back
+    std::string defaultValue;                         // LAG: when there's no such row
+    std::vector<std::string> partitionBy;
+    std::vector<std::pair<std::string,bool>> orderBy; // field, DESC
+    std::string alias;
 };
 
 // Parsed query representation
@@ -57,7 +74,8 @@ struct Query {
 
     // For SELECT
     std::vector<std::string> selectCols;
-    std::vector<AggSpec>     aggs;         // e.g. SUM(field) [AS alias]
+    std::vector<AggSpec>     aggs;         // e.g. SUM(field) [AS alias], APPROX_*(...)
+    std::vector<WindowSpec>  windows;      // e.g. SUM(x) OVER (...) [AS alias]
     bool isCount = false;
     std::string groupBy;                 // e.g. "user"
     std::string orderByField;            // e.g. "stock"
@@ -66,6 +84,19 @@ struct Query {
     // Pagination
     int skip  = 0;
     int limit = -1;                      // -1 = no limit
+    bool hasAfter = false;               // AFTER '<cursor>': resume a keyset page
+    std::string after;                   // the cursor ("" = first page)
+    bool keyset = false;                 // db.page: keyset page even without AFTER
+
+    // Scan parallelism (PARALLEL n); 0 = WorkerPool::defaultParallelism()
+    int parallelism = 0;
+
+    // SELECT text with whitespace outside quotes collapsed (QueryCache key)
+    std::string text;
+
+    // For CREATE/DROP/REFRESH MATERIALIZED VIEW (table = view name)
+    std::string viewSelect;              // the defining SELECT
+    bool ifExists = false;               // IF NOT EXISTS / IF EXISTS
 
     // Common
     std::vector<Condition> conditions;
@@ -111,6 +142,10 @@ struct Query {
 	            std::cout << c << " ";
 	        std::cout << "]\n";
 	    }
+	    for (auto &w : windows)
+	        std::cout << "  window      = " << w.alias << " ("
+	                  << w.partitionBy.size() << " partition, "
+	                  << w.orderBy.size() << " order columns)\n";
 	    std::cout << "  isCount     = " << (isCount ? "true" : "false") << "\n";
 	    if (!groupBy.empty())
 	        std::cout << "  groupBy     = " << groupBy << "\n";
@@ -121,6 +156,8 @@ struct Query {
 	    // Pagination
 	    std::cout << "  skip        = " << skip
 	              << ", limit = " << limit << "\n";
+	    if (parallelism > 0)
+	        std::cout << "  parallelism = " << parallelism << "\n";
 	
 	    // WHERE conditions
 	    if (!conditions.empty()) {
@@ -154,6 +191,7 @@ struct QueryResultRow {
 struct QueryResult {
     std::vector<QueryResultRow> rows;
     int affected = 0;  // # of rows returned or modified
+    std::string next;  // keyset pages: cursor for AFTER, "" on the last page
 };
 
 #endif // QUERY_H
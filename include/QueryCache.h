@@ -0,0 +1,63 @@
+// QueryCache.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Query.h"
+
+/**
+ * QueryCache :: results of SELECTs, kept until a table they read is written.
+ *
+ * Entries are keyed by the normalized statement text (Query::text) and hold
+ * the result plus the tables it was read from (base table, joined tables)
+ * with their DBManager::tableVersion() at the time. A lookup whose tables
+ * have moved on drops the entry and misses; nothing has to be invalidated
+ * on the write path beyond the version bump.
+ *
+ * Memory is bounded by an approximate byte size of the cached rows, evicting
+ * least recently used entries; a result larger than a quarter of the budget
+ * isn't cached. Off (capacity 0) unless configured. Safe to call from any
+ * thread; configure() is meant for startup.
+ */
+class QueryCache {
+public:
+    static QueryCache& instance();
+
+    // byte budget (0 = off); clears the cache
+    void configure(size_t capacityBytes);
+    bool enabled() const { return _capacity > 0; }
+
+    // tables q reads, for tagging (see versions())
+    static std::vector<std::string> tables(const Query &q);
+    // their current write versions: take them before running the query
+    static std::vector<uint64_t> versions(const std::vector<std::string> &tables);
+
+    // true and the cached result when key is cached and its tables unchanged
+    bool lookup(const std::string &key, QueryResult &out);
+    // cache r, read at the given versions of tables
+    void store(const std::string &key,
+               const std::vector<std::string> &tables,
+               const std::vector<uint64_t> &versions,
+               const QueryResult &r);
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t invalidations = 0;   // entries found stale on lookup
+        uint64_t evictions = 0;       // entries dropped for space
+        size_t   entries = 0;
+        size_t   bytes = 0;
+        size_t   capacity = 0;
+    };
+    Stats stats() const;
+
+    ~QueryCache();
+
+private:
+    QueryCache();
+    struct Impl;
+    size_t                _capacity = 0;
+    std::unique_ptr<Impl> _impl;
+};
@@ -0,0 +1,80 @@
+// QueryCursor.h
+#ifndef QUERYCURSOR_H
+#define QUERYCURSOR_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <rocksdb/db.h>
+#include "Query.h"
+#include "Predicate.h"
+#include "WorkerPool.h"
+
+/**
+ * QueryCursor :: a SELECT read a batch of rows at a time.
+ *
+ * Plain single-table SELECTs (no JOIN, GROUP BY, COUNT or ORDER BY) are
+ * streamed: the cursor holds a RocksDB snapshot and an iterator (or the key
+ * list of an index seek) and filters and projects rows only as next() asks
+ * for them. While the caller works on one batch, the next one is read ahead
+ * on the WorkerPool. Memory stays bounded by the batch size, and every batch
+ * sees the table as of the cursor's creation.
+ *
+ * Any other SELECT is executed up front by QueryExecutor and its result is
+ * handed out in batches.
+ *
+ * Not thread-safe: one caller at a time.
+ */
+class QueryCursor {
+public:
+    // throws std::runtime_error on parse errors or a non-SELECT statement
+    explicit QueryCursor(const std::string &sql);
+    ~QueryCursor();
+
+    QueryCursor(const QueryCursor&) = delete;
+    QueryCursor& operator=(const QueryCursor&) = delete;
+
+    // up to n more rows into out.rows (replacing its contents); an empty
+    // batch means the cursor is exhausted
+    void next(size_t n, QueryResult &out);
+
+    // release the snapshot early; next() returns nothing afterwards
+    void close();
+
+    bool done() const { return _closed || (_exhausted && _ahead.empty() && !_prefetching); }
+    bool streaming() const { return _streaming; }
+
+private:
+    void fill(size_t n, std::vector<QueryResultRow> &out);   // streaming read
+    bool nextRow(std::map<std::string,std::string> &row);
+    void waitPrefetch();
+
+    Query     _q;
+    bool      _streaming = false;
+    bool      _closed    = false;
+    bool      _exhausted = false;
+
+    // streaming state
+    Predicate                          _pred;
+    bool                               _wild = false;
+    rocksdb::ColumnFamilyHandle*       _cf   = nullptr;
+    const rocksdb::Snapshot*           _snap = nullptr;
+    std::unique_ptr<rocksdb::Iterator> _it;
+    bool                               _seek = false;   // index seek: _keys
+    std::vector<std::string>           _keys;
+    size_t                             _ki      = 0;
+    int                                _skipped = 0;
+    int                                _emitted = 0;
+
+    // materialized fallback
+    QueryResult _result;
+    size_t      _pos = 0;
+
+    // read-ahead
+    std::vector<QueryResultRow> _ahead;
+    std::unique_ptr<TaskGroup>  _prefetch;
+    bool                        _prefetching = false;
+};
+
+#endif // QUERYCURSOR_H
@@ -4,6 +4,9 @@
 
 #include "Query.h"
 
+class Predicate;
+class ExternalSorter;
+
 class QueryExecutor {
 public:
     static void execute(const Query &q, QueryResult &r);
@@ -14,6 +17,12 @@ private:
     static void handleDelete(const Query&, QueryResult&);
     static void handleBatch (const Query&, QueryResult&);
     static void handleSelect(const Query&, QueryResult&);
+    static void cachedSelect(const Query&, QueryResult&);   // through QueryCache
+    static void handleKeyset(const Query&, QueryResult&);   // AFTER / cursor pages
+    static bool keysetPlain (const Query&);
+    static void handleCount (const Query&, const Predicate&, QueryResult&);   // single-table COUNT(*)
+    static void handleWindow(const Query&, ExternalSorter&, QueryResult&);    // ... OVER (...) columns
+    static void handleView  (const Query&, QueryResult&);   // materialized view DDL
 };
 
 #endif // QUERYEXECUTOR_H
@@ -7,6 +7,8 @@
 struct TableSchema {
     // Map of field ? type (as string)
     std::unordered_map<std::string, std::string> indexedFields;
+    // Map of column -> declared type ("string", "number", "date", ...)
+    std::unordered_map<std::string, std::string> columnTypes;
 };
 
 class SchemaManager {
@@ -15,11 +17,16 @@ public:
      * Load schemas from a JSON file at `path`.
      * Expects a top-level object where each key is a table name and its
      * value is an object with an "indexedFields" object inside.
+     * A top-level "tables" object may also declare per-table column
+     * types under "<table>.schema"; these drive typed WHERE comparisons.
      */
     static void loadFromFile(const std::string& path);
 
     /// Get the schema for a given table (throws if missing)
     static const TableSchema& getSchema(const std::string& table);
+
+    /// Declared type of table.column, or "" when the schema doesn't say
+    static std::string columnType(const std::string& table, const std::string& column);
     
     static const std::unordered_map<std::string, TableSchema>& allSchemas() {
     	return schemas_;
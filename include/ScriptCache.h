@@ -0,0 +1,27 @@
+// ScriptCache.h
+#pragma once
+
+#include <v8.h>
+#include <string>
+
+/**
+ * ScriptCache :: persistent V8 code cache for the scripts we compile.
+ *
+ * compile() looks up <dir>/<sha256>.bin, keyed by the SHA-256 of the V8
+ * version plus the exact source text, and compiles with kConsumeCodeCache
+ * when it is there. On a miss (or a cache V8 rejects) the script is
+ * compiled eagerly and its code cache written for next time. A changed
+ * file hashes to a new key, so stale entries are simply never read again.
+ *
+ * Entries are also kept in memory, so the same module compiled in several
+ * isolates (hot reload) reads the disk at most once. Safe to call from
+ * any isolate thread.
+ */
+class ScriptCache {
+public:
+    static v8::MaybeLocal<v8::Script> compile(v8::Local<v8::Context> ctx,
+                                              const std::string& source);
+
+    static void setDirectory(const std::string& dir);   // default ".v8cache"
+    static void setEnabled(bool enabled);               // off: plain compile
+};
@@ -0,0 +1,46 @@
+// V8Convert.h
+#pragma once
+
+#include <v8.h>
+#include <string>
+#include "Query.h"
+
+/**
+ * V8Convert :: native conversion between engine values and V8 values.
+ *
+ * Query results are built directly as V8 values (no JSON text in between).
+ * The caller picks the shape with db.query(sql, shape):
+ *
+ *   "objects"  (default) [{col: "val", ...}, ...]; keys are internalized
+ *              once per query, and rows with the same columns share one
+ *              hidden class
+ *   "rows"     {columns: [...], rows: [[...], ...]}; missing cells are null
+ *   "columns"  {columns: [...], length: n, data: {col: ...}}; a column whose
+ *              every value is numeric becomes a Float64Array (missing cells
+ *              are NaN), the others arrays of strings/null
+ *
+ * Cell values are strings in "objects" and "rows", as before.
+ *
+ * toJson() is the other direction: a native JSON.stringify used for API
+ * responses, writing straight into the response buffer.
+ */
+namespace V8Convert {
+
+enum class Shape { Objects, Rows, Columns };
+
+// "objects" | "rows" | "columns"; false if unknown
+bool parseShape(const std::string& name, Shape& out);
+
+v8::Local<v8::Value> toV8(v8::Isolate* iso, v8::Local<v8::Context> ctx,
+                          const QueryResult& r, Shape shape = Shape::Objects);
+
+// JSON.stringify(value) with sanitize.safeStringify's rules: a cycle, a
+// BigInt or a thrown toJSON/getter yields "[]". Follows JSON.stringify for
+// everything else (toJSON, boxed primitives, undefined/function/symbol
+// members skipped or null in arrays, non-finite numbers as null, lone
+// surrogates escaped). Returns false, out untouched, when the value has no
+// JSON form (undefined, a function, a symbol).
+bool toJson(v8::Isolate* iso, v8::Local<v8::Context> ctx,
+            v8::Local<v8::Value> value, std::string& out);
+
+} // namespace V8Convert
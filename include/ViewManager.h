@@ -0,0 +1,88 @@
+// ViewManager.h
+#ifndef VIEWMANAGER_H
+#define VIEWMANAGER_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * ViewManager :: materialized aggregate views, kept current on every write.
+ *
+ *   CREATE MATERIALIZED VIEW [IF NOT EXISTS] name AS
+ *     SELECT g1[, g2 ...], SUM(f) [AS a], COUNT(*) [AS n],
+ *            APPROX_COUNT_DISTINCT(f) [AS d], APPROX_PERCENTILE(f, p) [AS q] ...
+ *     FROM table [WHERE ...] GROUP BY g1[, g2 ...]
+ *   REFRESH MATERIALIZED VIEW name      rebuild from the table
+ *   DROP MATERIALIZED VIEW [IF EXISTS] name
+ *
+ * A view is a column family called `name` with one JSON row per group: the
+ * group fields, each aggregate and `_rows` (source rows in the group), so
+ * SELECT reads it like a table, in O(groups). DBManager turns every
+ * insert/update/remove on the source table into per-group deltas (the old
+ * row taken out, the new one added) and writes them in the same WriteBatch
+ * or transaction as the row. A group is deleted when its last row goes.
+ *
+ * Approximate aggregates keep their sketch (see Sketch.h) in the row as
+ * `_sketch_<alias>` next to the estimate, so queries on the view can merge
+ * groups again (APPROX_COUNT_DISTINCT(_sketch_d) ... GROUP BY g1). Sketches
+ * can't take a value back out: when a row leaves a group, the group's
+ * sketches are recomputed from the table after the commit (resketch()).
+ *
+ * Definitions live in the "__views" column family and are loaded at startup
+ * (load(), after DBManager::init). Writes to a view itself are rejected.
+ */
+class ViewManager {
+public:
+    // values entering / leaving one approximate aggregate of a group
+    struct SketchDelta {
+        bool                     distinct = true;   // HyperLogLog, else t-digest
+        double                   quantile = 0.5;    // APPROX_PERCENTILE's p
+        std::vector<std::string> added;
+        std::vector<std::string> removed;
+    };
+
+    // change to one group of one view
+    struct Delta {
+        std::string                        view;
+        std::string                        key;     // group values, \x1f-separated
+        std::map<std::string,std::string>  group;   // group field -> value
+        std::map<std::string,double>       sums;    // aggregate alias -> change
+        std::map<std::string,SketchDelta>  sketches;   // aggregate alias -> values
+        long                               rows = 0;
+        bool                               resketch = false;   // a value left a sketch
+    };
+
+    static void load();
+
+    // throw std::runtime_error on a bad definition or an unknown view
+    static void create(const std::string &name, const std::string &selectSql, bool ifNotExists);
+    static void drop(const std::string &name, bool ifExists);
+    static void refresh(const std::string &name);
+
+    static bool isView(const std::string &name);
+    static bool hasViews(const std::string &table);
+
+    // deltas for every view on table when a row changes from oldRow to
+    // newRow (either may be null: insert / delete); groups with no net
+    // change are left out
+    static void deltas(const std::string &table,
+                       const std::map<std::string,std::string> *oldRow,
+                       const std::map<std::string,std::string> *newRow,
+                       std::vector<Delta> &out);
+
+    // the group's view row (JSON) after d, given its current one (null if
+    // the group is new); empty when no rows are left in the group
+    static std::string applyDelta(const std::string *current, const Delta &d);
+
+    // recompute the approximate aggregates of one group (a Delta with
+    // resketch set) from the table; run after the write has committed
+    static void resketch(const std::string &view, const std::string &key);
+
+    // held by a writer from reading view rows until its commit, so two
+    // writers can't both update a group from the same old value
+    static std::mutex& writeMutex();
+};
+
+#endif // VIEWMANAGER_H
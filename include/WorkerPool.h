@@ -0,0 +1,165 @@
+// WorkerPool.h
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Thrown by TaskGroup::wait() (and checked scans) once a query is cancelled
+class QueryCancelled : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * CancellationToken :: shared flag (plus optional deadline) for one query.
+ *
+ * Copies share state, so the token can be handed to every task of a query
+ * and cancelled from anywhere. A Scope installs a token as current() on the
+ * calling thread; TaskGroups and scans pick it up from there, and tasks run
+ * with their group's token installed.
+ */
+class CancellationToken {
+    struct State {
+        std::atomic<bool>    flag{false};
+        std::atomic<int64_t> deadline{0};   // steady_clock ns, 0 = none
+    };
+
+public:
+    CancellationToken();
+
+    void cancel() const { _s->flag.store(true, std::memory_order_relaxed); }
+    void cancelAfter(std::chrono::milliseconds ms) const;
+    bool cancelled() const;
+    void throwIfCancelled() const {
+        if (cancelled()) throw QueryCancelled("query cancelled");
+    }
+
+    // token of the query running on this thread (a fresh one if none)
+    static CancellationToken current();
+
+    class Scope {
+    public:
+        explicit Scope(const CancellationToken& tok);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        std::shared_ptr<State> _prev;
+    };
+
+private:
+    std::shared_ptr<State> _s;
+};
+
+class TaskGroup;
+
+/**
+ * WorkerPool :: work-stealing executor for query operators.
+ *
+ * Each worker owns a deque: tasks spawned from a worker go to the back of its
+ * own deque and are popped LIFO (cache-warm), idle workers steal from the
+ * front of other deques, and tasks submitted from outside land in a shared
+ * injection queue. Work is normally grouped per query with a TaskGroup;
+ * submit() is for fire-and-forget jobs (e.g. API requests handed off by the
+ * HTTP threads).
+ */
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // run a batch as one TaskGroup and wait for it (rethrows first error)
+    void runAll(std::vector<std::function<void()>> tasks);
+
+    // fire-and-forget; exceptions are logged and dropped
+    void submit(std::function<void()> task);
+
+    size_t size() const { return _workers.size(); }
+
+    // process-wide operator pool, sized by defaultParallelism() on first use
+    static WorkerPool& shared();
+
+    // default degree of parallelism for scans (set from main.cpp via
+    // environment); 1 disables parallel scans
+    static size_t defaultParallelism();
+    static void   setDefaultParallelism(size_t dop);
+
+private:
+    friend class TaskGroup;
+    using Job = std::function<void()>;
+
+    struct Worker {
+        std::mutex      mu;
+        std::deque<Job> jobs;
+        std::thread     thread;
+    };
+
+    void schedule(Job job);
+    bool tryPop(size_t self, Job& out);
+    void workerLoop(size_t self);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::deque<Job>                      _inject;   // from non-worker threads
+    std::mutex                           _mu;       // _inject + sleeping
+    std::condition_variable              _cv;
+    std::atomic<size_t>                  _queued{0};
+    bool                                 _stop = false;
+};
+
+/**
+ * TaskGroup :: the tasks of one query operator, waited on together.
+ *
+ * wait() runs not-yet-started tasks of this group on the calling thread
+ * before blocking, so a group always finishes even when every worker is
+ * busy (or when it is waited on from inside another task). The first task
+ * exception cancels the group's token and is rethrown from wait(); a
+ * cancelled group skips its remaining tasks and wait() throws
+ * QueryCancelled.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkerPool& pool = WorkerPool::shared(),
+                       CancellationToken token = CancellationToken::current());
+    ~TaskGroup();   // cancels and drains if wait() was not called
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+    void wait();
+    void cancel() { _st->token.cancel(); }
+
+    const CancellationToken& token() const { return _st->token; }
+
+private:
+    struct State {
+        explicit State(CancellationToken t) : token(std::move(t)) {}
+        CancellationToken                  token;
+        std::mutex                         mu;
+        std::condition_variable            cv;
+        std::deque<std::function<void()>>  pending;   // not yet claimed
+        size_t                             outstanding = 0;
+        std::exception_ptr                 error;
+        bool runOne();   // claim and run one pending task; false if none
+    };
+
+    WorkerPool&            _pool;
+    std::shared_ptr<State> _st;
+    bool                   _waited = false;
+};
+
+#endif // WORKERPOOL_H
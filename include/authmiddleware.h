@@ -2,14 +2,14 @@
 
 #include <crow.h>
 
-#include <v8.h>
-#include <libplatform/libplatform.h>
-
-extern v8::Isolate* g_isolate;
-extern v8::Persistent<v8::Context> persistent_ctx;
+#include "JwtUtils.h"
 
 struct AuthMiddleware {
-    struct context {};
+    // filled in for authenticated requests; read via app.get_context<AuthMiddleware>(req)
+    struct context {
+        std::string token;
+        std::string claims;   // payload JSON of the verified token
+    };
 
     // Controls whether the middleware accepts JWT via `?token=` query param
     // in addition to Authorization or Sec-WebSocket-Protocol.
@@ -17,7 +17,7 @@ struct AuthMiddleware {
     static void SetQueryTokenFallback(bool enabled) { allow_query_token_fallback = enabled; }
     static bool GetQueryTokenFallback() { return allow_query_token_fallback; }
 
-    void before_handle(crow::request& req, crow::response& res, context&) {
+    void before_handle(crow::request& req, crow::response& res, context& ctx) {
         // 1) Allow public endpoints without auth
         if (req.url == "/" || req.url == "/api/login" || req.url == "/api/signup" ||
             req.url.rfind("/public/", 0) == 0 || req.url.rfind("/ask", 0) == 0) {
@@ -65,39 +65,14 @@ struct AuthMiddleware {
         }
         if (token.empty()) { res.code = 401; return res.end("Missing token"); }
 
-        // 3) Verify via JS auth.verify(token) in V8 context
-        v8::Locker        locker(g_isolate);
-        v8::Isolate::Scope iscope(g_isolate);
-        v8::HandleScope   hs(g_isolate);
-        v8::Local<v8::Context> _ctx = persistent_ctx.Get(g_isolate);
-        v8::Context::Scope context_scope(_ctx);
-        v8::TryCatch tc(g_isolate);
-
-        // Lookup global "auth" object
-        v8::Local<v8::Value> authVal;
-        if (!_ctx->Global()->Get(_ctx,
-              v8::String::NewFromUtf8(g_isolate, "auth", v8::NewStringType::kNormal).ToLocalChecked()
-            ).ToLocal(&authVal) || !authVal->IsObject()) {
-            res.code = 500; return res.end("Auth module missing");
-        }
-        v8::Local<v8::Object> authObj = authVal.As<v8::Object>();
-
-        // Lookup auth.verify
-        v8::Local<v8::Value> verifyVal;
-        if (!authObj->Get(_ctx,
-              v8::String::NewFromUtf8(g_isolate, "verify", v8::NewStringType::kNormal).ToLocalChecked()
-            ).ToLocal(&verifyVal) || !verifyVal->IsFunction()) {
-            res.code = 500; return res.end("Auth.verify not a function");
-        }
-        v8::Local<v8::Function> verifyFn = verifyVal.As<v8::Function>();
-
-        // Call verify(token)
-        v8::Local<v8::Value> arg = v8::String::NewFromUtf8(g_isolate, token.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
-        v8::Local<v8::Value> result;
-        if (!verifyFn->Call(_ctx, authObj, 1, &arg).ToLocal(&result)) {
+        // 3) Verify natively (cached; no isolate needed) and keep the claims
+        // for the handler
+        try {
+            ctx.claims = JwtVerifier::instance().verify(token);
+        } catch (const std::exception&) {
             res.code = 401; return res.end("Invalid token");
         }
-        // If needed, inspect `result` for claims
+        ctx.token = token;
     }
 
     void after_handle(crow::request&, crow::response&, context&) {}
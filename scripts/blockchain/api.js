@@ -19,7 +19,7 @@ api.bc_init = {
     sanitize.checkParams(p, this.params);
     requireUser(p.token);
     var st = ledger.ensureInitialized();
-    return { ok: true, blocks: st.chain.length, rules: st.rules.length };
+    return { ok: true, blocks: st.length, rules: st.rules.length };
   }
 };
 
@@ -28,17 +28,18 @@ api.bc_addTransaction = {
   handler: function(p){
     sanitize.checkParams(p, this.params);
     requireUser(p.token);
-    var st = ledger.ensureInitialized();
-    var amount = ledger.createAmount(+p.amount, p.currency || 'USD');
-    var postings = [
-      ledger.createPosting(p.sourceAccount, amount, 'credit'),
-      ledger.createPosting(p.destinationAccount, amount, 'debit')
-    ];
-    var tx = ledger.createTransaction({ notation:p.notation, sourceAccount:p.sourceAccount, destinationAccount:p.destinationAccount, postings });
-    var processed = ledger.processTransactionWithRules(tx, st.rules);
-    var chain = ledger.addBlock(st.chain, [processed]);
-    ledger.saveChain(chain);
-    return { ok: true, blockIndex: chain[chain.length-1].index, transactionId: processed.transactionId, appliedRules: processed.appliedRules||[] };
+    return ledger.withLock(function(){
+      var st = ledger.ensureInitialized();
+      var amount = ledger.createAmount(+p.amount, p.currency || 'USD');
+      var postings = [
+        ledger.createPosting(p.sourceAccount, amount, 'credit'),
+        ledger.createPosting(p.destinationAccount, amount, 'debit')
+      ];
+      var tx = ledger.createTransaction({ notation:p.notation, sourceAccount:p.sourceAccount, destinationAccount:p.destinationAccount, postings });
+      var processed = ledger.processTransactionWithRules(tx, st.rules);
+      var block = ledger.appendBlock([processed]);
+      return { ok: true, blockIndex: block.index, transactionId: processed.transactionId, appliedRules: processed.appliedRules||[] };
+    });
   }
 };
 
@@ -47,20 +48,20 @@ api.bc_getBalance = {
   handler: function(p){
     sanitize.checkParams(p, ['token','account']);
     requireUser(p.token);
-    var st = ledger.ensureInitialized();
-    var bal = ledger.getAccountBalance(st.chain, p.account, p.asOf||null);
+    ledger.ensureInitialized();
+    var bal = ledger.accountBalance(p.account, p.asOf||null);
     return { ok: true, account: p.account, balances: bal };
   }
 };
 
 api.bc_getTransactions = {
-  params: ['token','account'],
+  params: ['token','account','cursor','limit'],
   handler: function(p){
-    sanitize.checkParams(p, this.params);
+    sanitize.checkParams(p, ['token','account']);
     requireUser(p.token);
-    var st = ledger.ensureInitialized();
-    var txs = ledger.getAccountTransactions(st.chain, p.account);
-    return { ok: true, transactions: txs };
+    ledger.ensureInitialized();
+    var page = ledger.accountTransactions(p.account, p.cursor||'', +p.limit||100);
+    return { ok: true, transactions: page.transactions, next: page.next };
   }
 };
 
@@ -79,11 +80,13 @@ api.bc_addRule = {
   handler: function(p){
     sanitize.checkParams(p, this.params);
     requireUser(p.token);
-    var st = ledger.ensureInitialized();
-    var rule = ledger.createRule(p.rule);
-    var rules = st.rules.concat([rule]).sort(function(a,b){ return b.priority - a.priority; });
-    ledger.saveRules(rules);
-    return { ok: true, ruleId: rule.ruleId };
+    return ledger.withLock(function(){
+      var st = ledger.ensureInitialized();
+      var rule = ledger.createRule(p.rule);
+      var rules = st.rules.concat([rule]).sort(function(a,b){ return b.priority - a.priority; });
+      ledger.saveRules(rules);
+      return { ok: true, ruleId: rule.ruleId };
+    });
   }
 };
 
@@ -83,8 +83,9 @@ function createTransaction({ notation, sourceAccount, destinationAccount, ruleId
 
 // Hashing
 function sha256Hex(s) {
-  // minimal JS SHA-256 (reuse from auth if present)
-  try { if (typeof require === 'function') { const a = require('auth'); if (a && a.hashPassword) { return a.hashPassword(s, ''); } } } catch (_) {}
+  // native SHA-256 via auth; the '|' prefix keeps hashes identical to the
+  // old hashPassword(s, '') = sha256('' + '|' + s), so existing chains verify
+  try { if (typeof require === 'function') { const a = require('auth'); if (a && a.sha256) { return a.sha256('|' + s); } } } catch (_) {}
   // fallback: trivial non-crypto (for UI/dev only)
   let h = 0; for (let i=0;i<s.length;i++){ h = (h*31 + s.charCodeAt(i))|0; }
   return ('00000000'+(h>>>0).toString(16)).slice(-8) + ('00000000'+((h^0xabcdef)|0>>>0).toString(16)).slice(-8);
@@ -183,25 +184,54 @@ function processTransactionWithRules(transaction, rules){
   return Object.freeze(t);
 }
 
-// Storage adapters (via V8 db.kv*)
+// Storage adapters (via a V8 db.kvOpen handle, opened on first use since
+// the startup snapshot can't hold it)
 const CF = 'blockchain';
-function kvPut(key, val){ if (typeof db!== 'undefined' && typeof db.kvPut === 'function') return db.kvPut(CF, key, String(val)); }
-function kvGet(key){ if (typeof db!== 'undefined' && typeof db.kvGet === 'function') return db.kvGet(CF, key); return ''; }
-function kvKeys(prefix){ if (typeof db!== 'undefined' && typeof db.kvKeys === 'function') return db.kvKeys(CF, prefix||''); return []; }
+let kvHandle = null;
+function kv(){
+  if (!kvHandle && typeof db !== 'undefined' && typeof db.kvOpen === 'function') kvHandle = db.kvOpen(CF);
+  return kvHandle;
+}
+function kvPut(key, val){ const h = kv(); if (h) return h.put(key, String(val)); }
+function kvGet(key){ const h = kv(); return h ? h.get(key) : ''; }
+function kvKeys(prefix){ const h = kv(); return h ? h.keys(prefix||'') : []; }
+function kvMultiGet(keys){ const h = kv(); return h ? h.multiGet(keys) : keys.map(() => ''); }
+
+// Blocks live in the native append-only log (global `chain`, ChainStore.cpp)
+// when the host provides it; the chain:* kv keys are the older layout, read
+// once to import an existing chain
+const store = (typeof chain !== 'undefined' && chain && typeof chain.append === 'function') ? chain : null;
 
 function saveChain(chain){
   if (!isValidChain(chain)) throw new Error('Chain invalid');
+  if (store){
+    // append-only: write just the blocks the log doesn't have yet
+    for (let i=store.length(); i<chain.length; i++) store.append(chain[i]);
+    return true;
+  }
   kvPut('chain:length', String(chain.length));
   for (let i=0;i<chain.length;i++){ kvPut(`chain:block:${i}`, JSON.stringify(chain[i])); }
   return true;
 }
 
 function loadChain(){
+  if (store){
+    const out = store.blocks(0);   // one scan of the log
+    return out.length ? out : null;
+  }
+  return loadKvChain();
+}
+
+function loadKvChain(){
   const lenStr = kvGet('chain:length');
   const len = parseInt(lenStr||'0',10);
   if (!len || isNaN(len)) return null;
+  // every block in one MultiGet (block keys don't sort numerically, so not a scan)
+  const keys = [];
+  for (let i=0;i<len;i++) keys.push(`chain:block:${i}`);
+  const vals = kvMultiGet(keys);
   const chain = [];
-  for (let i=0;i<len;i++){ const s = kvGet(`chain:block:${i}`); if (!s) return null; chain.push(JSON.parse(s)); }
+  for (const s of vals){ if (!s) return null; chain.push(JSON.parse(s)); }
   return chain;
 }
 
@@ -226,10 +256,58 @@ function getAccountTransactions(chain, account){
   return out;
 }
 
+// Indexed queries: a seek in the native log instead of a walk of the chain
+function accountBalance(account, asOfDate){
+  if (!isType(account,'string')||account.trim()==='') throw new Error('Account must be non-empty string');
+  if (!store) return getAccountBalance(loadChain()||[], account, asOfDate);
+  const cutoff = asOfDate ? new Date(asOfDate) : new Date();
+  if (isNaN(cutoff.getTime())) throw new Error('asOf must be a date');
+  return store.balance(account, cutoff.toISOString());
+}
+
+// one page ({transactions, next}) of an account's transactions, oldest first;
+// pass next back as cursor for the following page
+function accountTransactions(account, cursor, limit){
+  if (!isType(account,'string')||account.trim()==='') throw new Error('Account must be non-empty string');
+  if (!store) return { transactions: getAccountTransactions(loadChain()||[], account), next: null };
+  return store.transactions(account, cursor||'', limit||100);
+}
+
+function lastBlock(){
+  if (store) return store.last();
+  const c = loadChain(); return c ? c[c.length-1] : null;
+}
+
+function chainLength(){ if (store) return store.length(); const c = loadChain(); return c ? c.length : 0; }
+
+// Append a block of transactions to the stored chain; call under withLock
+function appendBlock(transactions){
+  if (!isType(transactions, 'Array') || transactions.length === 0) throw new Error('Provide at least one transaction');
+  if (!store){ const c = addBlock(loadChain(), transactions); saveChain(c); return c[c.length-1]; }
+  const last = store.last();
+  const block = createBlock(last.index+1, last.hash, transactions);
+  store.append(block);   // checks index and previousHash against the log
+  return block;
+}
+
+// Requests run on several V8 isolates; read-modify-write of the chain/rules
+// must hold the process-wide 'ledger' lock (see shared.lock in main.cpp)
+function withLock(fn){ if (typeof shared !== 'undefined' && typeof shared.lock === 'function') return shared.lock('ledger', fn); return fn(); }
+
 // Demo initializer: ensure chain + default rules in DB
-function ensureInitialized(){
-  let chain = loadChain();
-  if (!chain){ chain = [createGenesisBlock()]; saveChain(chain); }
+function ensureInitialized(){ return withLock(ensureInitializedLocked); }
+function ensureInitializedLocked(){
+  let chain = null;
+  if (store){
+    if (!store.length()){
+      // first start on the native log: import a kv-stored chain if there is one
+      const old = loadKvChain();
+      saveChain(old && isValidChain(old) ? old : [createGenesisBlock()]);
+    }
+  } else {
+    chain = loadChain();
+    if (!chain){ chain = [createGenesisBlock()]; saveChain(chain); }
+  }
   let rules = loadRules();
   if (!rules || rules.length===0){
     const r1 = createRule({ ruleId:'RULE_001', name:'Large Transaction Approval', description:'Require approval for transactions over $10,000', type:RULE_TYPES.APPROVAL, conditions:{ amountRange:{min:10000} }, actions:{ requireApproval:true, addNote:'Large transaction requires manual approval' }, priority:100 });
@@ -237,8 +315,10 @@ function ensureInitialized(){
     const r3 = createRule({ ruleId:'RULE_003', name:'USD Only Validation', description:'Ensure all transactions are in USD', type:RULE_TYPES.VALIDATION, conditions:{ currency:'USD' }, actions:{ addTags:['validated-currency'] }, priority:90 });
     rules = [r1,r2,r3]; saveRules(rules);
   }
-  initializeTransactionCounter(chain);
-  return { chain, rules };
+  // ids only grow, so the newest block holds the highest one
+  const last = chain ? chain[chain.length-1] : store.last();
+  initializeTransactionCounter([last]);
+  return { length: chain ? chain.length : store.length(), last, rules };
 }
 
 // Exports
@@ -263,4 +343,10 @@ exports.loadRules = loadRules;
 exports.getRuleById = getRuleById;
 exports.getAccountBalance = getAccountBalance;
 exports.getAccountTransactions = getAccountTransactions;
+exports.accountBalance = accountBalance;
+exports.accountTransactions = accountTransactions;
+exports.lastBlock = lastBlock;
+exports.chainLength = chainLength;
+exports.appendBlock = appendBlock;
 exports.ensureInitialized = ensureInitialized;
+exports.withLock = withLock;
@@ -61,6 +61,25 @@ function assertAccountExists(project_id, account_code){
 
 function toIsoDate(d){ return new Date(d).toISOString().slice(0,10); }
 
+// Per-project account totals, kept current by the engine on every journal
+// line write, so undated reports read one row per account instead of
+// scanning and grouping every line.
+var viewsReady = false;
+function ensureViews(){
+  if (viewsReady) return;
+  var res = db.execute("CREATE MATERIALIZED VIEW IF NOT EXISTS mv_account_totals AS " +
+             "SELECT project_id, account_code, SUM(debit) AS debit, SUM(credit) AS credit, COUNT(*) AS lines " +
+             "FROM journal_lines GROUP BY project_id, account_code;");
+  // not ready: the next report tries again
+  if (!res || !res.success) throw new Error('Failed to create mv_account_totals: ' + (res ? res.error : 'no result'));
+  viewsReady = true;
+}
+
+function accountTotals(project_id){
+  ensureViews();
+  return db.query("SELECT account_code, debit, credit FROM mv_account_totals WHERE project_id = '" + project_id + "' ORDER BY account_code ASC;") || [];
+}
+
 // ---- Auth ----
 
 api.signup = {
@@ -99,8 +118,11 @@ api.createProject = {
     var user = requireUser(p.token);
     var id = uuid();
     var row = { id: id, name: sanitize.nonEmptyString(p.name,'name'), created_by: user, created_at: new Date().toISOString() };
-    db.execute("INSERT INTO projects VALUES " + JSON.stringify(row) + ";");
-    ensureAccountsForProject(id);
+    // project and its seeded chart of accounts commit together
+    db.transaction(function(tx){
+      tx.execute("INSERT INTO projects VALUES " + JSON.stringify(row) + ";");
+      ensureAccountsForProject(id);
+    });
     return { project: row };
   }
 };
@@ -125,9 +147,11 @@ api.seedAccountsGlobal = {
     // Seed a global template once
     var existing = db.query("SELECT * FROM accounts WHERE project_id = 'global';");
     if (existing && existing.length) return { seeded: 0, note: 'Already present' };
-    DEFAULT_ACCOUNTS.forEach(function(acc) {
-      var row = { id: uuid(), project_id: 'global', code: acc.code, name: acc.name, type: acc.type, is_active: true };
-      db.execute("INSERT INTO accounts VALUES " + JSON.stringify(row) + ";");
+    db.transaction(function(tx){
+      DEFAULT_ACCOUNTS.forEach(function(acc) {
+        var row = { id: uuid(), project_id: 'global', code: acc.code, name: acc.name, type: acc.type, is_active: true };
+        tx.execute("INSERT INTO accounts VALUES " + JSON.stringify(row) + ";");
+      });
     });
     return { seeded: DEFAULT_ACCOUNTS.length };
   }
@@ -181,9 +205,9 @@ api.postJournal = {
       created_by: user,
       created_at: new Date().toISOString()
     };
-    // Persist header so reports (which JOIN on entries) can see it
-    db.execute("INSERT INTO journal_entries VALUES " + JSON.stringify(entry) + ";");
-    // Lines
+    // Header (reports JOIN on entries) and lines are written atomically in
+    // one batch
+    var stmts = ["INSERT INTO journal_entries VALUES " + JSON.stringify(entry) + ";"];
     var line_no = 1;
     p.lines.forEach(function(l) {
       var line = {
@@ -195,21 +219,30 @@ api.postJournal = {
         debit: +(l.debit||0),
         credit: +(l.credit||0)
       };
-      db.execute("INSERT INTO journal_lines VALUES " + JSON.stringify(line) + ";");
+      stmts.push("INSERT INTO journal_lines VALUES " + JSON.stringify(line) + ";");
     });
+    var res = db.executeBatch(stmts);
+    if (!res.success) throw new Error('Failed to post journal: ' + res.error);
     return { entry: entry };
   }
 };
 
 api.listJournals = {
-  params: ['token','project_id','skip','limit'],
+  params: ['token','project_id','skip','limit','cursor'],
   handler: function(p){
     sanitize.checkParams(p, ['token','project_id']);
     requireUser(p.token);
     var skip = p.skip ? +p.skip : 0;
     var limit = p.limit ? +p.limit : 100;
-    var rows = db.query("SELECT * FROM journal_entries WHERE project_id = '" + p.project_id + "' ORDER BY date DESC SKIP " + skip + " LIMIT " + limit + ";");
-    return { entries: rows || [] };
+    if (skip > 0 && !p.cursor){
+      // legacy offset paging: cost grows with skip
+      var rows = db.query("SELECT * FROM journal_entries WHERE project_id = '" + p.project_id + "' ORDER BY date DESC SKIP " + skip + " LIMIT " + limit + ";");
+      return { entries: rows || [] };
+    }
+    // keyset paging: pass the returned `next` back as `cursor`
+    var after = p.cursor ? " AFTER '" + String(p.cursor).replace(/[^0-9a-f]/gi, '') + "'" : "";
+    var page = db.page("SELECT * FROM journal_entries WHERE project_id = '" + p.project_id + "' ORDER BY date DESC" + after + " LIMIT " + limit + ";");
+    return { entries: page.rows || [], next: page.next };
   }
 };
 
@@ -234,10 +267,7 @@ api.trialBalance = {
   handler: function(p){
     sanitize.checkParams(p, this.params);
     requireUser(p.token);
-    var sql = "SELECT account_code, SUM(debit) AS debit, SUM(credit) AS credit " +
-              "FROM journal_lines WHERE project_id = '" + p.project_id + "' " +
-              "GROUP BY account_code ORDER BY account_code ASC;";
-    var rows = db.query(sql) || [];
+    var rows = accountTotals(p.project_id);
     var names = db.query("SELECT code,name,type FROM accounts WHERE project_id = '" + p.project_id + "';") || [];
     var nameByCode = {}; names.forEach(function(a){ nameByCode[a.code] = {name:a.name, type:a.type}; });
     rows.forEach(function(r){
@@ -282,16 +312,13 @@ api.overallTrialBalance = {
   handler: function(p){
     sanitize.checkParams(p, this.params);
     requireUser(p.token);
-    // Do aggregation in JS to avoid SQL engine's current single-column GROUP BY limitation
-    var rows = db.query("SELECT * FROM journal_lines;") || [];
+    // One row per project and account, straight from the materialized view
+    ensureViews();
+    var rows = db.query("SELECT project_id, account_code, debit, credit FROM mv_account_totals;") || [];
     var acc = {};
-    for (var i=0;i<rows.length;i++){
-      var r = rows[i];
-      var key = r.project_id + '|' + r.account_code;
-      if (!acc[key]) acc[key] = { project_id: r.project_id, account_code: r.account_code, debit: 0, credit: 0 };
-      acc[key].debit  += +(r.debit || 0);
-      acc[key].credit += +(r.credit|| 0);
-    }
+    rows.forEach(function(r){
+      acc[r.project_id + '|' + r.account_code] = { project_id: r.project_id, account_code: r.account_code, debit: +(r.debit || 0), credit: +(r.credit || 0) };
+    });
     var out = Object.keys(acc).sort().map(function(k){ return acc[k]; });
     return { rows: out };
   }
@@ -312,6 +339,28 @@ api.overallProfitAndLoss = {
   }
 };
 
+// Distinct accounts touched and median / p90 debit line per project,
+// aggregated natively in fixed memory (approximate: about 1-2%)
+api.overallLedgerStats = {
+  params: ['token'],
+  handler: function(p){
+    sanitize.checkParams(p, this.params);
+    requireUser(p.token);
+    var out = {};
+    var row = function(id){ return out[id] || (out[id] = { project_id: id, accounts: 0, median_debit: 0, p90_debit: 0 }); };
+    (db.query("SELECT project_id, APPROX_COUNT_DISTINCT(account_code) AS accounts " +
+              "FROM journal_lines GROUP BY project_id;") || []).forEach(function(r){
+      row(r.project_id).accounts = +r.accounts;
+    });
+    (db.query("SELECT project_id, APPROX_PERCENTILE(debit, 0.5) AS median, APPROX_PERCENTILE(debit, 0.9) AS p90 " +
+              "FROM journal_lines WHERE debit > '0' GROUP BY project_id;") || []).forEach(function(r){
+      row(r.project_id).median_debit = +(+r.median).toFixed(2);
+      row(r.project_id).p90_debit    = +(+r.p90).toFixed(2);
+    });
+    return { rows: Object.keys(out).sort().map(function(k){ return out[k]; }) };
+  }
+};
+
 // ---- Utility ----
 api.list = {
   params: [],
@@ -331,29 +380,34 @@ api.balanceSheet = {
     var sql = "SELECT l.account_code, SUM(l.debit) AS debit, SUM(l.credit) AS credit " +
               "FROM journal_lines l JOIN journal_entries e ON l.entry_id = e.id " +
               "WHERE l.project_id = '" + p.project_id + "'" + asOf + " GROUP BY l.account_code;";
-    var rows = db.query(sql) || [];
-    var names = db.query("SELECT code,name,type FROM accounts WHERE project_id = '" + p.project_id + "';") || [];
-    var nameByCode = {}; names.forEach(function(a){ nameByCode[a.code] = {name:a.name, type:a.type}; });
-    var assets=[], liabilities=[], equity=[];
-    var earnings = 0.0;
-	rows.forEach(function(r){
-      var info = nameByCode[r.account_code] || {name:r.account_code, type:'Unknown'};
-      var bal = +(+(r.debit||0) - +(r.credit||0)).toFixed(2);
-      var row = { code:r.account_code, name:info.name, balance: bal };
-      if (info.type==='Asset') assets.push(row);
-      else if (info.type==='Liability') liabilities.push(row);
-      else if (info.type==='Equity') equity.push(row);
-      else if (info.type==='Revenue') earnings+=bal;
-	  else if (info.type==='Expense') earnings+=bal;
+    // Balances and account names are independent: run both queries at once
+    return Promise.all([
+      db.queryAsync(sql),
+      db.queryAsync("SELECT code,name,type FROM accounts WHERE project_id = '" + p.project_id + "';")
+    ]).then(function(res){
+      var rows = res[0] || [], names = res[1] || [];
+      var nameByCode = {}; names.forEach(function(a){ nameByCode[a.code] = {name:a.name, type:a.type}; });
+      var assets=[], liabilities=[], equity=[];
+      var earnings = 0.0;
+      rows.forEach(function(r){
+        var info = nameByCode[r.account_code] || {name:r.account_code, type:'Unknown'};
+        var bal = +(+(r.debit||0) - +(r.credit||0)).toFixed(2);
+        var row = { code:r.account_code, name:info.name, balance: bal };
+        if (info.type==='Asset') assets.push(row);
+        else if (info.type==='Liability') liabilities.push(row);
+        else if (info.type==='Equity') equity.push(row);
+        else if (info.type==='Revenue') earnings+=bal;
+        else if (info.type==='Expense') earnings+=bal;
+      });
+
+      if(earnings != 0.0){
+        var eRow = { code:'0000', name:'Earnings before closing', balance: earnings };
+        equity.push(eRow);
+      }
+
+      function total(arr){ var s=0; for (var i=0;i<arr.length;i++){ s += +(+arr[i].balance||0); } return +s.toFixed(2); }
+      return { assets: assets, liabilities: liabilities, equity: equity, totals: { assets: total(assets), liabilities: total(liabilities), equity: total(equity) } };
     });
-    
-    if(earnings != 0.0){
-      var eRow = { code:'0000', name:'Earnings before closing', balance: earnings };
-      equity.push(eRow);
-	}
-    
-    function total(arr){ var s=0; for (var i=0;i<arr.length;i++){ s += +(+arr[i].balance||0); } return +s.toFixed(2); }
-    return { assets: assets, liabilities: liabilities, equity: equity, totals: { assets: total(assets), liabilities: total(liabilities), equity: total(equity) } };
   }
 };
 
@@ -366,10 +420,14 @@ api.profitAndLoss = {
     // Always use LEFT JOIN; apply date filters on e.date when provided
     var from = p.from ? " AND e.date >= '" + sanitize.isoDate(p.from,'from') + "'" : "";
     var to   = p.to   ? " AND e.date <= '" + sanitize.isoDate(p.to,'to') + "'"   : "";
-    var sql = "SELECT l.account_code, SUM(l.debit) AS debit, SUM(l.credit) AS credit " +
-              "FROM journal_lines l LEFT JOIN journal_entries e ON l.entry_id = e.id " +
-              "WHERE l.project_id = '" + p.project_id + "'" + from + to + " GROUP BY l.account_code;";
-    var rows = db.query(sql) || [];
+    var rows;
+    if (!from && !to) rows = accountTotals(p.project_id);
+    else {
+      var sql = "SELECT l.account_code, SUM(l.debit) AS debit, SUM(l.credit) AS credit " +
+                "FROM journal_lines l LEFT JOIN journal_entries e ON l.entry_id = e.id " +
+                "WHERE l.project_id = '" + p.project_id + "'" + from + to + " GROUP BY l.account_code;";
+      rows = db.query(sql) || [];
+    }
     var names = db.query("SELECT code,type FROM accounts WHERE project_id = '" + p.project_id + "';") || [];
     var typeByCode = {}; names.forEach(function(a){ typeByCode[a.code] = a.type; });
     var revenue = 0, expense = 0;
@@ -386,40 +444,27 @@ api.profitAndLoss = {
   }
 };
 
+// Ledger lines of one account with their running balance, computed by the
+// engine in one pass (SUM ... OVER) in `order`. LEFT JOIN keeps legacy lines
+// without a header; their date and memo are empty.
+function accountLedgerRows(p, where, order){
+  var sql = "SELECT entry_id, line_no, debit, credit, date, memo, " +
+            "SUM(l.debit - l.credit) OVER (ORDER BY " + order + ") AS balance " +
+            "FROM journal_lines l LEFT JOIN journal_entries e ON l.entry_id = e.id " +
+            "WHERE l.project_id = '" + p.project_id + "' AND l.account_code = '" + p.account_code + "'" + where + ";";
+  return (db.query(sql) || []).map(function(L){
+    return { entry_id: L.entry_id, date: L.date||'', memo: L.memo||'', line_no: L.line_no,
+             debit: L.debit||0, credit: L.credit||0, balance: +(+L.balance).toFixed(2) };
+  });
+}
+
 // Account ledger drill-down
 api.accountLedger = {
   params: ['token','project_id','account_code','from','to'],
   handler: function(p){
     sanitize.checkParams(p, ['token','project_id','account_code']);
     requireUser(p.token);
-    // Start with lines only to ensure we include legacy data without headers
-    var baseSql = "SELECT entry_id, line_no, debit, credit FROM journal_lines WHERE project_id = '" + p.project_id + "' AND account_code = '" + p.account_code + "' ORDER BY entry_id ASC, line_no ASC;";
-    var lines = db.query(baseSql) || [];
-    // Build a cache of headers by entry_id (if present)
-    var headerById = {};
-    function getHeader(id){
-      if (headerById[id] !== undefined) return headerById[id];
-      var h = db.query("SELECT id, date, memo FROM journal_entries WHERE id = '" + id + "';");
-      headerById[id] = (h && h[0]) ? h[0] : null;
-      return headerById[id];
-    }
-    var running = 0;
-    var out = [];
-    for (var i=0;i<lines.length;i++){
-      var L = lines[i];
-      var H = getHeader(L.entry_id);
-      running += +((L.debit||0) - (L.credit||0));
-      out.push({
-        entry_id: L.entry_id,
-        date: H && H.date ? H.date : '',
-        memo: H && H.memo ? H.memo : '',
-        line_no: L.line_no,
-        debit: L.debit||0,
-        credit: L.credit||0,
-        balance: +running.toFixed(2)
-      });
-    }
-    return { ledger: out };
+    return { ledger: accountLedgerRows(p, '', 'l.entry_id, l.line_no') };
   }
 };
 
@@ -432,10 +477,14 @@ api.voiceTrialBalance = {
     requireUser(p.token);
     var from = p.from ? " AND e.date >= '" + sanitize.isoDate(p.from,'from') + "'" : "";
     var to   = p.to   ? " AND e.date <= '" + sanitize.isoDate(p.to,'to') + "'"   : "";
-    var sql = "SELECT l.account_code, SUM(l.debit) AS debit, SUM(l.credit) AS credit " +
-              "FROM journal_lines l LEFT JOIN journal_entries e ON l.entry_id = e.id " +
-              "WHERE l.project_id = '" + p.project_id + "'" + from + to + " GROUP BY l.account_code ORDER BY l.account_code ASC;";
-    var rows = db.query(sql) || [];
+    var rows;
+    if (!from && !to) rows = accountTotals(p.project_id);
+    else {
+      var sql = "SELECT l.account_code, SUM(l.debit) AS debit, SUM(l.credit) AS credit " +
+                "FROM journal_lines l LEFT JOIN journal_entries e ON l.entry_id = e.id " +
+                "WHERE l.project_id = '" + p.project_id + "'" + from + to + " GROUP BY l.account_code ORDER BY l.account_code ASC;";
+      rows = db.query(sql) || [];
+    }
     var names = db.query("SELECT code,name,type FROM accounts WHERE project_id = '" + p.project_id + "';") || [];
     var nameByCode = {}; names.forEach(function(a){ nameByCode[a.code] = {name:a.name, type:a.type}; });
     rows.forEach(function(r){
@@ -454,10 +503,14 @@ api.voiceProfitAndLoss = {
     requireUser(p.token);
     var from = p.from ? " AND e.date >= '" + sanitize.isoDate(p.from,'from') + "'" : "";
     var to   = p.to   ? " AND e.date <= '" + sanitize.isoDate(p.to,'to') + "'"   : "";
-    var sql = "SELECT l.account_code, SUM(l.debit) AS debit, SUM(l.credit) AS credit " +
-              "FROM journal_lines l LEFT JOIN journal_entries e ON l.entry_id = e.id " +
-              "WHERE l.project_id = '" + p.project_id + "'" + from + to + " GROUP BY l.account_code;";
-    var rows = db.query(sql) || [];
+    var rows;
+    if (!from && !to) rows = accountTotals(p.project_id);
+    else {
+      var sql = "SELECT l.account_code, SUM(l.debit) AS debit, SUM(l.credit) AS credit " +
+                "FROM journal_lines l LEFT JOIN journal_entries e ON l.entry_id = e.id " +
+                "WHERE l.project_id = '" + p.project_id + "'" + from + to + " GROUP BY l.account_code;";
+      rows = db.query(sql) || [];
+    }
     var names = db.query("SELECT code,type FROM accounts WHERE project_id = '" + p.project_id + "';") || [];
     var typeByCode = {}; names.forEach(function(a){ typeByCode[a.code] = a.type; });
     var revenue = 0, expense = 0;
@@ -480,10 +533,14 @@ api.voiceBalanceSheet = {
     sanitize.checkParams(p, ['token','project_id']);
     requireUser(p.token);
     var asOf = p.as_of ? " AND e.date <= '" + sanitize.isoDate(p.as_of,'as_of') + "'" : "";
-    var sql = "SELECT l.account_code, SUM(l.debit) AS debit, SUM(l.credit) AS credit " +
-              "FROM journal_lines l LEFT JOIN journal_entries e ON l.entry_id = e.id " +
-              "WHERE l.project_id = '" + p.project_id + "'" + asOf + " GROUP BY l.account_code;";
-    var rows = db.query(sql) || [];
+    var rows;
+    if (!asOf) rows = accountTotals(p.project_id);
+    else {
+      var sql = "SELECT l.account_code, SUM(l.debit) AS debit, SUM(l.credit) AS credit " +
+                "FROM journal_lines l LEFT JOIN journal_entries e ON l.entry_id = e.id " +
+                "WHERE l.project_id = '" + p.project_id + "'" + asOf + " GROUP BY l.account_code;";
+      rows = db.query(sql) || [];
+    }
     var names = db.query("SELECT code,name,type FROM accounts WHERE project_id = '" + p.project_id + "';") || [];
     var nameByCode = {}; names.forEach(function(a){ nameByCode[a.code] = {name:a.name, type:a.type}; });
     var assets=[], liabilities=[], equity=[];
@@ -511,20 +568,7 @@ api.voiceAccountLedger = {
     requireUser(p.token);
     var from = p.from ? " AND e.date >= '" + sanitize.isoDate(p.from,'from') + "'" : "";
     var to   = p.to   ? " AND e.date <= '" + sanitize.isoDate(p.to,'to') + "'"   : "";
-    var sql = "SELECT entry_id, line_no, debit, credit, date, memo " +
-              "FROM journal_lines l LEFT JOIN journal_entries e ON l.entry_id = e.id " +
-              "WHERE l.project_id = '" + p.project_id + "' AND l.account_code = '" + p.account_code + "'" + from + to +
-              " ORDER BY e.date ASC, l.entry_id ASC, l.line_no ASC;";
-              
-              
-    var rows = db.query(sql) || [];
-    var running = 0; var out = [];
-    for (var i=0;i<rows.length;i++){
-      var L = rows[i];
-      running += +((L.debit||0) - (L.credit||0));
-      out.push({ entry_id: L.entry_id, date: L.date||'', memo: L.memo||'', line_no: L.line_no, debit: L.debit||0, credit: L.credit||0, balance: +running.toFixed(2) });
-    }
-    return { ledger: out };
+    return { ledger: accountLedgerRows(p, from + to, 'e.date, l.entry_id, l.line_no') };
   }
 };
 
@@ -0,0 +1,264 @@
+// ChainStore.cpp
+#include "ChainStore.h"
+#include "DBManager.h"
+#include <json.hpp>           // nlohmann::json
+#include <rocksdb/comparator.h>
+#include <rocksdb/utilities/write_batch_with_index.h>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+
+static const char* kFamily = "blockchain_log";
+
+static void putBE(std::string& out, uint64_t v, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) out.push_back((char)((v >> (8 * i)) & 0xff));
+}
+
+static std::string blockKey(uint64_t index) {
+    std::string k("b");
+    putBE(k, index, 8);
+    return k;
+}
+
+static std::string txSeq(uint64_t block, uint32_t tx) {
+    std::string s;
+    putBE(s, block, 8);
+    putBE(s, tx, 4);
+    return s;
+}
+
+static std::string toHex(const std::string& s) {
+    static const char* d = "0123456789abcdef";
+    std::string out;
+    for (unsigned char c : s) { out.push_back(d[c >> 4]); out.push_back(d[c & 15]); }
+    return out;
+}
+
+static bool fromHex(const std::string& h, std::string& out) {
+    auto nib = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    if (h.size() % 2) return false;
+    out.clear();
+    for (size_t i = 0; i < h.size(); i += 2) {
+        int a = nib(h[i]), b = nib(h[i + 1]);
+        if (a < 0 || b < 0) return false;
+        out.push_back((char)(a * 16 + b));
+    }
+    return true;
+}
+
+static std::string accountPrefix(char tag, const std::string& account) {
+    std::string p(1, tag);
+    p += account;
+    p.push_back('\0');
+    return p;
+}
+
+static void addInto(json& balances, const std::map<std::string,double>& delta) {
+    for (auto& [unit, v] : delta)
+        balances[unit] = balances.value(unit, 0.0) + v;
+}
+
+ChainStore& ChainStore::instance() {
+    static ChainStore store;
+    return store;
+}
+
+rocksdb::ColumnFamilyHandle* ChainStore::family() {
+    auto* h = _cf.load();
+    if (!h) {
+        h = DBManager::instance().cf(kFamily);
+        if (!h) throw std::runtime_error(std::string("chain: cannot open column family ") + kFamily);
+        _cf.store(h);
+    }
+    return h;
+}
+
+void ChainStore::loadTail() {
+    if (_loaded) return;
+    auto* db = DBManager::instance().db();
+    std::unique_ptr<rocksdb::Iterator> it(db->NewIterator(rocksdb::ReadOptions(), family()));
+    it->SeekForPrev(rocksdb::Slice("c", 1));   // last "b..." key
+    if (it->Valid() && it->key().starts_with(rocksdb::Slice("b", 1))) {
+        json last = json::parse(it->value().ToString());
+        _length   = last.at("index").get<uint64_t>() + 1;
+        _lastHash = last.at("hash").get<std::string>();
+    }
+    _loaded = true;
+}
+
+uint64_t ChainStore::length() {
+    std::lock_guard<std::mutex> lk(_mu);
+    loadTail();
+    return _length;
+}
+
+bool ChainStore::block(uint64_t index, std::string& out) {
+    return DBManager::instance().db()->Get(rocksdb::ReadOptions(), family(), blockKey(index), &out).ok();
+}
+
+std::string ChainStore::blocks(uint64_t from, size_t limit) {
+    std::unique_ptr<rocksdb::Iterator> it(
+        DBManager::instance().db()->NewIterator(rocksdb::ReadOptions(), family()));
+    std::string out = "[";
+    size_t n = 0;
+    // block keys are big-endian, so they sort by index
+    for (it->Seek(blockKey(from)); it->Valid() && n < limit && it->key().starts_with("b"); it->Next()) {
+        if (n++) out.push_back(',');
+        out.append(it->value().data(), it->value().size());
+    }
+    out.push_back(']');
+    return out;
+}
+
+uint64_t ChainStore::append(const std::string& blockJson) {
+    json b;
+    try {
+        b = json::parse(blockJson);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("chain.append: invalid block JSON: ") + e.what());
+    }
+    if (!b.is_object() || !b.contains("index") || !b["index"].is_number_integer()
+        || !b.contains("previousHash") || !b["previousHash"].is_string()
+        || !b.contains("hash") || !b["hash"].is_string()
+        || !b.contains("transactions") || !b["transactions"].is_array())
+        throw std::runtime_error("chain.append: block needs index, previousHash, hash and transactions");
+
+    std::lock_guard<std::mutex> lk(_mu);
+    loadTail();
+
+    const int64_t index = b["index"].get<int64_t>();
+    if (index < 0 || (uint64_t)index != _length)
+        throw std::runtime_error("chain.append: expected block " + std::to_string(_length)
+                                 + ", got " + std::to_string(index));
+    const std::string prev = _length ? _lastHash : std::string("0");
+    if (b["previousHash"].get<std::string>() != prev)
+        throw std::runtime_error("chain.append: previousHash doesn't match block " + std::to_string(index - 1));
+
+    auto* db = DBManager::instance().db();
+    auto* h  = family();
+    rocksdb::WriteBatchWithIndex wb(rocksdb::BytewiseComparator(), 0, true);
+    wb.Put(h, blockKey((uint64_t)index), blockJson);
+
+    // the genesis block carries no transactions worth indexing
+    const auto& txs = b["transactions"];
+    for (uint32_t t = 0; index > 0 && t < txs.size(); ++t) {
+        const json& tx = txs[t];
+        if (!tx.is_object() || !tx.contains("timestamp") || !tx["timestamp"].is_string()
+            || !tx.contains("postings") || !tx["postings"].is_array())
+            throw std::runtime_error("chain.append: transaction " + std::to_string(t) + " needs timestamp and postings");
+        const std::string ts  = tx["timestamp"].get<std::string>();
+        const std::string seq = txSeq((uint64_t)index, t);
+
+        // net effect of this tx per account and unit (debit +, credit -)
+        std::map<std::string, std::map<std::string,double>> delta;
+        for (const json& p : tx["postings"]) {
+            if (!p.is_object() || !p.contains("account") || !p["account"].is_string()
+                || !p.contains("amount") || !p["amount"].is_object()
+                || !p["amount"].contains("value") || !p["amount"]["value"].is_number()
+                || !p["amount"].contains("unit") || !p["amount"]["unit"].is_string())
+                throw std::runtime_error("chain.append: malformed posting in transaction " + std::to_string(t));
+            std::string account = p["account"].get<std::string>();
+            if (account.find('\0') != std::string::npos)
+                throw std::runtime_error("chain.append: account names can't contain NUL");
+            double v = p["amount"]["value"].get<double>();
+            std::string type = p.value("type", "");
+            delta[account][p["amount"]["unit"].get<std::string>()] += (type == "debit" ? v : -v);
+        }
+
+        json indexed = tx;
+        indexed["blockIndex"]     = b["index"];
+        indexed["blockHash"]      = b["hash"];
+        indexed["blockTimestamp"] = b.value("timestamp", json());
+        const std::string txText = indexed.dump();
+
+        for (auto& [account, d] : delta) {
+            wb.Put(h, accountPrefix('x', account) + seq, txText);
+
+            const std::string pfx = accountPrefix('a', account);
+            std::string key = pfx + ts;
+            key.push_back('\0');
+            key += seq;
+
+            // read through the batch: an earlier tx of this block may have
+            // touched the same account
+            json running = json::object();
+            std::vector<std::pair<std::string,std::string>> later;
+            {
+                std::unique_ptr<rocksdb::Iterator> it(
+                    wb.NewIteratorWithBase(h, db->NewIterator(rocksdb::ReadOptions(), h)));
+                it->SeekForPrev(key);
+                if (it->Valid() && it->key().starts_with(pfx))
+                    running = json::parse(it->value().ToString());
+                for (it->Seek(key); it->Valid() && it->key().starts_with(pfx); it->Next())
+                    later.emplace_back(it->key().ToString(), it->value().ToString());
+            }
+            addInto(running, d);
+            wb.Put(h, key, running.dump());
+            // only when timestamps went backwards
+            for (auto& [k, v] : later) {
+                json r = json::parse(v);
+                addInto(r, d);
+                wb.Put(h, k, r.dump());
+            }
+        }
+    }
+
+    auto s = db->Write(rocksdb::WriteOptions(), wb.GetWriteBatch());
+    if (!s.ok()) throw std::runtime_error("chain.append: " + s.ToString());
+    DBManager::instance().bumpVersion(kFamily);
+    _length   = (uint64_t)index + 1;
+    _lastHash = b["hash"].get<std::string>();
+    return _length;
+}
+
+std::string ChainStore::balance(const std::string& account, const std::string& asOf) {
+    const std::string pfx = accountPrefix('a', account);
+    std::string target = pfx;
+    if (asOf.empty()) target.push_back('\xff');
+    else { target += asOf; target.push_back('\x01'); }   // past every entry at asOf
+
+    std::unique_ptr<rocksdb::Iterator> it(
+        DBManager::instance().db()->NewIterator(rocksdb::ReadOptions(), family()));
+    it->SeekForPrev(target);
+    if (it->Valid() && it->key().starts_with(pfx)) return it->value().ToString();
+    return "{}";
+}
+
+std::string ChainStore::transactions(const std::string& account, const std::string& cursor,
+                                     size_t limit, std::string& next) {
+    next.clear();
+    const std::string pfx = accountPrefix('x', account);
+    std::string from = pfx;
+    if (!cursor.empty()) {
+        std::string seq;
+        if (!fromHex(cursor, seq) || seq.size() != 12)
+            throw std::runtime_error("chain.transactions: invalid cursor");
+        from += seq;
+    }
+
+    std::unique_ptr<rocksdb::Iterator> it(
+        DBManager::instance().db()->NewIterator(rocksdb::ReadOptions(), family()));
+    it->Seek(from);
+    if (!cursor.empty() && it->Valid() && it->key() == rocksdb::Slice(from)) it->Next();
+
+    std::string out = "[";
+    size_t n = 0;
+    std::string lastSeq;
+    for (; it->Valid() && it->key().starts_with(pfx); it->Next()) {
+        if (n == limit) { next = toHex(lastSeq); break; }
+        if (n++) out.push_back(',');
+        out.append(it->value().data(), it->value().size());
+        lastSeq.assign(it->key().data() + pfx.size(), it->key().size() - pfx.size());
+    }
+    out.push_back(']');
+    return out;
+}
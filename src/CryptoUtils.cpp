@@ -0,0 +1,68 @@
+// src/CryptoUtils.cpp
+#include "CryptoUtils.h"
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <stdexcept>
+
+static std::string toHex(const unsigned char* p, size_t n) {
+    static const char* hex = "0123456789abcdef";
+    std::string out;
+    out.reserve(n * 2);
+    for (size_t i = 0; i < n; ++i) {
+        out += hex[p[i] >> 4];
+        out += hex[p[i] & 15];
+    }
+    return out;
+}
+
+std::string CppSha256(const std::string& data) {
+    unsigned char md[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), md);
+    return toHex(md, sizeof md);
+}
+
+std::string CppPbkdf2(const std::string& password, const std::string& salt,
+                      uint32_t iterations) {
+    if (iterations == 0) throw std::runtime_error("PBKDF2: iterations must be > 0");
+    unsigned char key[32];
+    if (PKCS5_PBKDF2_HMAC(password.data(), (int)password.size(),
+                          reinterpret_cast<const unsigned char*>(salt.data()), (int)salt.size(),
+                          (int)iterations, EVP_sha256(), sizeof key, key) != 1) {
+        throw std::runtime_error("PBKDF2 failed");
+    }
+    return toHex(key, sizeof key);
+}
+
+std::string CppScrypt(const std::string& password, const std::string& salt,
+                      uint64_t N, uint64_t r, uint64_t p) {
+    if (N < 2 || (N & (N - 1)) != 0) throw std::runtime_error("scrypt: N must be a power of two");
+    unsigned char key[32];
+    // memory bound: 128 * r * (N + p) bytes, plus slack
+    uint64_t maxmem = 128 * r * (N + p) + (1 << 20);
+    if (EVP_PBE_scrypt(password.data(), password.size(),
+                       reinterpret_cast<const unsigned char*>(salt.data()), salt.size(),
+                       N, r, p, maxmem, key, sizeof key) != 1) {
+        throw std::runtime_error("scrypt failed (parameters out of range?)");
+    }
+    return toHex(key, sizeof key);
+}
+
+std::string CppRandomId(size_t len) {
+    static const char chars[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    const unsigned n = sizeof chars - 1;          // 62
+    const unsigned limit = 256 - (256 % n);       // reject bytes >= 248
+    std::string out;
+    out.reserve(len);
+    unsigned char buf[64];
+    while (out.size() < len) {
+        if (RAND_bytes(buf, sizeof buf) != 1) throw std::runtime_error("RAND_bytes failed");
+        for (unsigned char b : buf) {
+            if (b >= limit) continue;
+            out += chars[b % n];
+            if (out.size() == len) break;
+        }
+    }
+    return out;
+}
@@ -5,9 +5,53 @@
 #include "JsonUtils.h"        // parseToMap()
 
 #include "SchemaManager.h"
+#include "IndexManager.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <stdexcept>
+#include <rocksdb/comparator.h>
+#include <rocksdb/metadata.h>
+#include <rocksdb/merge_operator.h>
 
 using json = nlohmann::json;
 
+// the WriteScope open on this thread (see DBManager::WriteScope)
+static thread_local DBManager::WriteScope* tl_scope = nullptr;
+
+// row counters, keyed by table name (see DBManager::rowCount())
+static const char* kCounts = "__counts";
+
+// counter values: 8-byte little-endian int64
+static std::string encodeCount(int64_t n) {
+    std::string s(8, '\0');
+    for (int i = 0; i < 8; ++i) s[i] = (char)(((uint64_t)n >> (8 * i)) & 0xff);
+    return s;
+}
+static int64_t decodeCount(const rocksdb::Slice &s) {
+    uint64_t n = 0;
+    for (size_t i = 0; i < 8 && i < s.size(); ++i)
+        n |= (uint64_t)(unsigned char)s[i] << (8 * i);
+    return (int64_t)n;
+}
+
+// adds merged deltas to the counter, so a write never reads it first
+class CountAddOperator : public rocksdb::AssociativeMergeOperator {
+public:
+    bool Merge(const rocksdb::Slice&, const rocksdb::Slice* existing,
+               const rocksdb::Slice& value, std::string* newValue,
+               rocksdb::Logger*) const override
+    {
+        *newValue = encodeCount((existing ? decodeCount(*existing) : 0) + decodeCount(value));
+        return true;
+    }
+    const char* Name() const override { return "CountAddOperator"; }
+};
+
+// tables whose rows are counted: the ones schemas.json declares
+static bool countsRows(const std::string &table) {
+    return SchemaManager::allSchemas().count(table) > 0;
+}
+
 DBManager& DBManager::instance() {
     static DBManager mgr;
     return mgr;
@@ -23,33 +67,61 @@ bool DBManager::init(const std::string& path) {
     auto s = rocksdb::DB::ListColumnFamilies(opts, path, &cf_names);
     if (!s.ok()) cf_names.clear();
 
-    // 2) add tables from schema
+    // 2) add tables from schema, and the row counters
     for (auto& [tbl,_] : SchemaManager::allSchemas())
         cf_names.push_back(tbl);
+    if (std::find(cf_names.begin(), cf_names.end(), kCounts) == cf_names.end())
+        cf_names.push_back(kCounts);
 
     // 3) open DB with those CFs
     std::vector<rocksdb::ColumnFamilyDescriptor> descs;
     descs.reserve(cf_names.size());
-    for (auto& name : cf_names)
-        descs.emplace_back(name, rocksdb::ColumnFamilyOptions());
+    for (auto& name : cf_names) {
+        rocksdb::ColumnFamilyOptions co;
+        if (name == kCounts) co.merge_operator = std::make_shared<CountAddOperator>();
+        descs.emplace_back(name, co);
+    }
 
+    // opened as an OptimisticTransactionDB so db.transaction() can check
+    // conflicts at commit; plain reads and writes go through it unchanged
     std::vector<rocksdb::ColumnFamilyHandle*> handles;
-    rocksdb::DB* raw = nullptr;
-    s = rocksdb::DB::Open(opts, path, descs, &handles, &raw);
+    rocksdb::OptimisticTransactionDB* raw = nullptr;
+    s = rocksdb::OptimisticTransactionDB::Open(opts, path, descs, &handles, &raw);
     if (!s.ok()) {
         std::cerr << "RocksDB open error: " << s.ToString() << "\n";
         return false;
     }
     _db.reset(raw);
+    _txnDb = raw;
 
     // 4) map names?handles
     for (size_t i = 0; i < cf_names.size(); ++i)
         _cfs[cf_names[i]] = handles[i];
+    _countsCf = _cfs[kCounts];
+
+    // 5) count the rows of tables that have no counter yet
+    for (auto& [tbl,_] : SchemaManager::allSchemas()) {
+        std::string val;
+        if (_db->Get(rocksdb::ReadOptions(), _countsCf, tbl, &val).ok()) continue;
+        int64_t n = 0;
+        std::unique_ptr<rocksdb::Iterator> it(_db->NewIterator(rocksdb::ReadOptions(), _cfs[tbl]));
+        for (it->SeekToFirst(); it->Valid(); it->Next()) ++n;
+        _db->Put(rocksdb::WriteOptions(), _countsCf, tbl, encodeCount(n));
+        std::cout << "[DBManager] Counted " << n << " rows in " << tbl << std::endl;
+    }
 
     return true;
 }
 
+// true when the schema declares indexed fields for this table
+static bool hasIndexedFields(const std::string &table) {
+    auto &all = SchemaManager::allSchemas();
+    auto it = all.find(table);
+    return it != all.end() && !it->second.indexedFields.empty();
+}
+
 rocksdb::ColumnFamilyHandle* DBManager::cf(const std::string& name) {
+    std::lock_guard<std::mutex> lk(_cfMutex);
     if (auto it = _cfs.find(name); it != _cfs.end())
         return it->second;
     rocksdb::ColumnFamilyHandle* h = nullptr;
@@ -60,6 +132,201 @@ rocksdb::ColumnFamilyHandle* DBManager::cf(const std::string& name) {
     return nullptr;
 }
 
+// --- WriteScope / Batch / Transaction --------------------------------------
+
+DBManager::WriteScope::WriteScope() {
+    if (tl_scope) throw std::runtime_error("DBManager: a batch or transaction is already open");
+    tl_scope = this;
+}
+
+DBManager::WriteScope::~WriteScope() { close(); }
+
+void DBManager::WriteScope::close() {
+    if (tl_scope == this) tl_scope = nullptr;
+}
+
+void DBManager::WriteScope::applyIndexOps() {
+    for (auto &op : _indexOps) op();
+    _indexOps.clear();
+}
+
+void DBManager::WriteScope::addCounts() {
+    auto &mgr = DBManager::instance();
+    for (auto &[table, delta] : _counts)
+        if (delta != 0) merge(mgr._countsCf, table, encodeCount(delta));
+    _counts.clear();
+}
+
+void DBManager::WriteScope::resketchViews() {
+    for (auto &[view, key] : _resketch) ViewManager::resketch(view, key);
+    _resketch.clear();
+}
+
+void DBManager::WriteScope::bumpVersions() {
+    for (auto &t : _written) DBManager::instance().bumpVersion(t);
+    _written.clear();
+}
+
+bool DBManager::inScope() { return tl_scope != nullptr; }
+
+DBManager::Batch::Batch()
+    // overwrite_key: repeated writes to a key within the batch keep only the
+    // last one in the index, so batch reads see the latest version
+    : _wb(rocksdb::BytewiseComparator(), 0, true) {}
+
+bool DBManager::Batch::get(rocksdb::ColumnFamilyHandle* h, const std::string &key, std::string &val) {
+    return _wb.GetFromBatchAndDB(DBManager::instance()._db.get(), rocksdb::ReadOptions(), h, key, &val).ok();
+}
+void DBManager::Batch::put(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) {
+    _wb.Put(h, key, val);
+}
+void DBManager::Batch::del(rocksdb::ColumnFamilyHandle* h, const std::string &key) {
+    _wb.Delete(h, key);
+}
+void DBManager::Batch::merge(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) {
+    _wb.Merge(h, key, val);
+}
+
+void DBManager::Batch::commit() {
+    if (_done) return;
+    _done = true;
+    close();
+    addCounts();
+    if (_wb.GetWriteBatch()->Count() > 0) {
+        auto s = DBManager::instance()._db->Write(rocksdb::WriteOptions(), _wb.GetWriteBatch());
+        if (!s.ok()) throw std::runtime_error("batch write failed: " + s.ToString());
+    }
+    applyIndexOps();
+    resketchViews();
+    bumpVersions();
+}
+
+DBManager::Transaction::Transaction() {
+    rocksdb::OptimisticTransactionOptions to;
+    to.set_snapshot = true;   // conflicts are checked against the start of the transaction
+    _txn.reset(DBManager::instance()._txnDb->BeginTransaction(rocksdb::WriteOptions(), to));
+}
+
+DBManager::Transaction::~Transaction() {
+    if (!_done) _txn->Rollback();
+}
+
+bool DBManager::Transaction::get(rocksdb::ColumnFamilyHandle* h, const std::string &key, std::string &val) {
+    // tracked: validated against the snapshot at commit
+    return _txn->GetForUpdate(rocksdb::ReadOptions(), h, key, &val).ok();
+}
+void DBManager::Transaction::put(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) {
+    _txn->Put(h, key, val);
+}
+void DBManager::Transaction::del(rocksdb::ColumnFamilyHandle* h, const std::string &key) {
+    _txn->Delete(h, key);
+}
+void DBManager::Transaction::merge(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) {
+    // untracked: concurrent writers to a table don't conflict on its counter
+    _txn->MergeUntracked(h, key, val);
+}
+
+bool DBManager::Transaction::commit() {
+    if (_done) return true;
+    _done = true;
+    close();
+    addCounts();
+    auto s = _txn->Commit();
+    if (s.IsBusy() || s.IsTryAgain()) return false;
+    if (!s.ok()) throw std::runtime_error("transaction commit failed: " + s.ToString());
+    applyIndexOps();
+    resketchViews();
+    bumpVersions();
+    return true;
+}
+
+bool DBManager::readRaw(rocksdb::ColumnFamilyHandle* h, const std::string &key, std::string &val) const {
+    if (tl_scope) return tl_scope->get(h, key, val);
+    return _db->Get(rocksdb::ReadOptions(), h, key, &val).ok();
+}
+
+void DBManager::writeRow(rocksdb::ColumnFamilyHandle* h, const std::string &key, const std::string &val) {
+    if (tl_scope) tl_scope->put(h, key, val);
+    else          _db->Put(rocksdb::WriteOptions(), h, key, val);
+}
+
+void DBManager::deleteRow(rocksdb::ColumnFamilyHandle* h, const std::string &key) {
+    if (tl_scope) tl_scope->del(h, key);
+    else          _db->Delete(rocksdb::WriteOptions(), h, key);
+}
+
+void DBManager::indexOp(std::function<void()> op) {
+    if (tl_scope) tl_scope->_indexOps.push_back(std::move(op));
+    else          op();
+}
+
+void DBManager::written(const std::string &table) {
+    if (tl_scope) tl_scope->_written.insert(table);
+    else          bumpVersion(table);
+}
+
+void DBManager::countRow(const std::string &table, int64_t delta) {
+    if (tl_scope) tl_scope->_counts[table] += delta;
+    else          _db->Merge(rocksdb::WriteOptions(), _countsCf, table, encodeCount(delta));
+}
+
+void DBManager::inTransaction(const std::function<void()> &write) {
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        Transaction t;
+        write();
+        if (t.commit()) return;
+    }
+    throw std::runtime_error("DBManager: gave up after repeated write conflicts");
+}
+
+int64_t DBManager::rowCount(const std::string &table) const {
+    std::string val;
+    if (!_countsCf || !countsRows(table)
+        || !_db->Get(rocksdb::ReadOptions(), _countsCf, table, &val).ok())
+        return -1;
+    return decodeCount(val);
+}
+
+uint64_t DBManager::tableVersion(const std::string &table) {
+    std::lock_guard<std::mutex> lk(_verMutex);
+    auto it = _versions.find(table);
+    return it == _versions.end() ? 0 : it->second;
+}
+
+void DBManager::bumpVersion(const std::string &table) {
+    std::lock_guard<std::mutex> lk(_verMutex);
+    ++_versions[table];
+}
+
+bool DBManager::beginViewWrite(const std::string &table, std::unique_ptr<Batch> &own) {
+    if (!ViewManager::hasViews(table)) return false;
+    if (!tl_scope) own.reset(new Batch());
+    if (!tl_scope->_viewLock.owns_lock())
+        tl_scope->_viewLock = std::unique_lock<std::mutex>(ViewManager::writeMutex());
+    return true;
+}
+
+void DBManager::updateViews(const std::string &table,
+                            const std::map<std::string,std::string> *oldRow,
+                            const std::map<std::string,std::string> *newRow)
+{
+    std::vector<ViewManager::Delta> deltas;
+    ViewManager::deltas(table, oldRow, newRow, deltas);
+    for (auto &d : deltas) {
+        auto* h = cf(d.view);
+        std::string cur;
+        bool had = readRaw(h, d.key, cur);
+        std::string row = ViewManager::applyDelta(had ? &cur : nullptr, d);
+        if (!row.empty())  writeRow(h, d.key, row);
+        else if (had)      deleteRow(h, d.key);
+        // sketches can't drop a value: recomputed once the write is in
+        if (d.resketch && !row.empty()) tl_scope->_resketch.insert({ d.view, d.key });
+        written(d.view);
+    }
+}
+
+// --- CRUD --------------------------------------------------------------------
+
 void DBManager::insert(const std::string &table,
                        const std::map<std::string,std::string> &row)
 {
@@ -74,24 +341,78 @@ void DBManager::insert(const std::string &table,
         auto it = row.begin();
         key = (it == row.end()) ? std::string() : it->second;
     }
-    _db->Put(rocksdb::WriteOptions(), cf(table), key, j.dump());
+    bool counted = countsRows(table);
+    // the row and its count change are written together
+    if (counted && !tl_scope) { inTransaction([&] { insert(table, row); }); return; }
+    auto* handle = cf(table);
+    std::unique_ptr<Batch> own;
+    bool views = beginViewWrite(table, own);
+    if (hasIndexedFields(table) || views || counted) {
+        std::map<std::string,std::string> oldRow;
+        std::string val;
+        bool had = readRaw(handle, key, val);
+        if (had)
+            oldRow = JsonUtils::parseToMap(val);
+        else if (counted)
+            countRow(table, 1);
+        if (hasIndexedFields(table))
+            indexOp([table, key, row, oldRow] { IndexManager::add(table, key, row, oldRow); });
+        if (views)
+            updateViews(table, had ? &oldRow : nullptr, &row);
+    }
+    writeRow(handle, key, j.dump());
+    written(table);
+    if (own) own->commit();
 }
 
 void DBManager::update(const std::string &table,
                        const std::string &key,
                        const std::map<std::string,std::string> &row)
 {
-    // merge into existing
-    auto existing = get(table, key);
+    bool counted = countsRows(table);
+    if (counted && !tl_scope) { inTransaction([&] { update(table, key, row); }); return; }
+    std::unique_ptr<Batch> own;
+    bool views = beginViewWrite(table, own);
+    // merge into existing (a missing row is created)
+    std::string val;
+    bool had = readRaw(cf(table), key, val);
+    std::map<std::string,std::string> existing;
+    if (had) existing = JsonUtils::parseToMap(val);
+    if (!had && counted) countRow(table, 1);
+    auto oldRow = existing;
     for (auto &p : row) existing[p.first] = p.second;
     json j(existing);
-    _db->Put(rocksdb::WriteOptions(), cf(table), key, j.dump());
+    if (hasIndexedFields(table))
+        indexOp([table, key, existing, oldRow] { IndexManager::add(table, key, existing, oldRow); });
+    if (views)
+        updateViews(table, had ? &oldRow : nullptr, &existing);
+    writeRow(cf(table), key, j.dump());
+    written(table);
+    if (own) own->commit();
 }
 
 void DBManager::remove(const std::string &table,
                        const std::string &key)
 {
-    _db->Delete(rocksdb::WriteOptions(), cf(table), key);
+    bool counted = countsRows(table);
+    if (counted && !tl_scope) { inTransaction([&] { remove(table, key); }); return; }
+    auto* handle = cf(table);
+    std::unique_ptr<Batch> own;
+    bool views = beginViewWrite(table, own);
+    if (hasIndexedFields(table) || views || counted) {
+        std::string val;
+        if (readRaw(handle, key, val)) {
+            if (counted) countRow(table, -1);
+            auto oldRow = JsonUtils::parseToMap(val);
+            if (views)
+                updateViews(table, &oldRow, nullptr);
+            if (hasIndexedFields(table))
+                indexOp([table, key, oldRow] { IndexManager::remove(table, key, oldRow); });
+        }
+    }
+    deleteRow(handle, key);
+    written(table);
+    if (own) own->commit();
 }
 
 std::vector<std::string>
@@ -101,38 +422,169 @@ DBManager::scan(const std::string &table,
                 int limit) const
 {
     std::vector<std::string> keys;
+    int seen = 0;
+    scanEach(table, conds, [&](const std::string& k, std::map<std::string,std::string>&) {
+        if (seen++ < skip) return true;
+        keys.push_back(k);
+        return !(limit>0 && (int)keys.size() >= limit);
+    });
+    return keys;
+}
+
+void DBManager::scanEach(const std::string &table,
+                         const std::vector<Condition> &conds,
+                         const RowFn &fn) const
+{
+    scanEach(table, Predicate::compile(table, conds), fn);
+}
+
+// first condition that can be answered from an in-memory index, if any
+static const CompiledCondition* seekCondition(const std::string &table,
+                                              const Predicate &pred)
+{
+    for (auto &c : pred.conditions())
+        if (c.indexable() && IndexManager::hasIndex(table, c.key)) return &c;
+    return nullptr;
+}
+
+bool DBManager::seekKeys(const std::string &table,
+                         const Predicate &pred,
+                         std::vector<std::string> &keys) const
+{
+    auto *seek = seekCondition(table, pred);
+    if (!seek) return false;
+    const CompiledCondition &c = *seek;
+    keys = (c.op == CmpOp::EQ)
+        ? IndexManager::lookup(table, c.key, c.text)
+        : IndexManager::lookupPrefix(table, c.key, c.like->literalPrefix());
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return true;
+}
+
+void DBManager::scanEach(const std::string &table,
+                         const Predicate &pred,
+                         const RowFn &fn,
+                         const std::string *after) const
+{
     auto* handle = DBManager::instance().cf(table);
+
+    // Index seek: an equality or prefix-LIKE condition on an indexed field
+    // narrows the scan to the matching keys. Keys are sorted so callers
+    // still see primary-key order; the full predicate is re-checked per row.
+    std::vector<std::string> keys;
+    if (seekKeys(table, pred, keys)) {
+        std::string val;
+        auto from = after ? std::upper_bound(keys.begin(), keys.end(), *after) : keys.begin();
+        for (auto ki = from; ki != keys.end(); ++ki) {
+            const std::string &k = *ki;
+            if (!_db->Get(rocksdb::ReadOptions(), handle, k, &val).ok()) continue;
+            auto row = JsonUtils::parseToMap(val);
+            if (!pred.matches(row)) continue;
+            if (!fn(k, row)) break;
+        }
+        return;
+    }
+
     auto it = std::unique_ptr<rocksdb::Iterator>(
         _db->NewIterator(rocksdb::ReadOptions(), handle)
     );
 
-    int seen = 0;
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    auto tok = CancellationToken::current();
+    size_t n = 0;
+    if (after) {
+        it->Seek(*after);
+        if (it->Valid() && it->key() == rocksdb::Slice(*after)) it->Next();
+    } else {
+        it->SeekToFirst();
+    }
+    for (; it->Valid(); it->Next()) {
+        if ((++n & 1023) == 0) tok.throwIfCancelled();
         auto k = it->key().ToString();
-        auto row = get(table, k);
-
-        bool ok = true;
-        for (auto &c : conds) {
-            auto &lhs = row[c.key];
-            if (!( (c.op=="=")   ? lhs==c.value
-                : (c.op=="!=")  ? lhs!=c.value
-                : (c.op=="<")   ? lhs< c.value
-                : (c.op==">")   ? lhs> c.value
-                : (c.op=="<=")  ? lhs<=c.value
-                : (c.op==">=")  ? lhs>=c.value
-                : (c.op=="LIKE")? lhs.find(c.value)!=std::string::npos
-                                : false ))
-            {
-                ok = false;
-                break;
-            }
+        auto row = JsonUtils::parseToMap(it->value().ToString());
+        if (!pred.matches(row)) continue;
+        if (!fn(k, row)) break;
+    }
+}
+
+std::vector<DBManager::KeyRange>
+DBManager::partition(const std::string &table, size_t n)
+{
+    std::vector<KeyRange> ranges(1);
+    auto* handle = cf(table);
+    if (n <= 1 || !handle) return ranges;
+
+    // SST files give (first key, bytes) samples of the key space
+    rocksdb::ColumnFamilyMetaData meta;
+    _db->GetColumnFamilyMetaData(handle, &meta);
+    std::vector<std::pair<std::string,uint64_t>> files;
+    uint64_t total = 0;
+    for (auto &level : meta.levels)
+        for (auto &f : level.files) {
+            files.emplace_back(f.smallestkey, f.size);
+            total += f.size;
         }
-        if (!ok) continue;
-        if (seen++ < skip) continue;
-        keys.push_back(k);
-        if (limit>0 && (int)keys.size() >= limit) break;
+    if (files.size() < 2 || total == 0) return ranges;
+    std::sort(files.begin(), files.end());
+
+    // cut whenever the running size passes the next 1/n share
+    ranges.clear();
+    std::string begin;
+    uint64_t acc = 0, share = total / n;
+    for (auto &f : files) {
+        if (acc >= share * (ranges.size() + 1) && ranges.size() + 1 < n
+            && f.first > begin)
+        {
+            ranges.push_back({ begin, f.first });
+            begin = f.first;
+        }
+        acc += f.second;
     }
-    return keys;
+    ranges.push_back({ begin, std::string() });
+    return ranges;
+}
+
+void DBManager::scanParallel(const std::string &table,
+                             const Predicate &pred,
+                             const std::vector<KeyRange> &ranges,
+                             const PartRowFn &fn)
+{
+    if (ranges.size() <= 1 || seekCondition(table, pred)) {
+        scanEach(table, pred, [&](const std::string &k, std::map<std::string,std::string> &row) {
+            return fn(0, k, row);
+        });
+        return;
+    }
+
+    auto* handle = cf(table);
+    const rocksdb::Snapshot* snap = _db->GetSnapshot();
+    TaskGroup group;   // inherits the query's cancellation token
+    for (size_t part = 0; part < ranges.size(); ++part) {
+        group.run([&, part] {
+            const KeyRange &kr = ranges[part];
+            const CancellationToken &tok = group.token();
+            rocksdb::Slice upper(kr.end);
+            rocksdb::ReadOptions ro;
+            ro.snapshot = snap;
+            if (!kr.end.empty()) ro.iterate_upper_bound = &upper;
+            std::unique_ptr<rocksdb::Iterator> it(_db->NewIterator(ro, handle));
+            if (kr.begin.empty()) it->SeekToFirst(); else it->Seek(kr.begin);
+            for (size_t n = 0; it->Valid(); it->Next()) {
+                if ((++n & 1023) == 0 && tok.cancelled()) return;
+                auto k = it->key().ToString();
+                auto row = JsonUtils::parseToMap(it->value().ToString());
+                if (!pred.matches(row)) continue;
+                if (!fn(part, k, row)) break;
+            }
+        });
+    }
+    try {
+        group.wait();
+    } catch (...) {
+        _db->ReleaseSnapshot(snap);
+        throw;
+    }
+    _db->ReleaseSnapshot(snap);
 }
 
 std::map<std::string,std::string>
@@ -140,7 +592,7 @@ DBManager::get(const std::string &table,
                const std::string &key) const
 {
     std::string val;
-    _db->Get(rocksdb::ReadOptions(),  DBManager::instance().cf(table), key, &val);
+    readRaw(DBManager::instance().cf(table), key, val);
     // use your JsonUtils to convert JSON?map<string,string>
     return JsonUtils::parseToMap(val);
 }
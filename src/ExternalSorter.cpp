@@ -0,0 +1,203 @@
+// ExternalSorter.cpp
+#include "ExternalSorter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static size_t             g_defaultBudget = 64u * 1024 * 1024;   // 64 MB
+static std::string        g_defaultTempDir;                      // empty = system temp
+static std::atomic<uint64_t> g_sorterSeq{0};
+static const size_t       kMaxFanIn = 64;                        // run files open per merge
+
+size_t ExternalSorter::defaultMemoryBudget()             { return g_defaultBudget; }
+void   ExternalSorter::setDefaultMemoryBudget(size_t b)  { g_defaultBudget = b; }
+void   ExternalSorter::setDefaultTempDir(const std::string& d) { g_defaultTempDir = d; }
+std::string ExternalSorter::defaultTempDir() {
+    if (!g_defaultTempDir.empty()) return g_defaultTempDir;
+    std::error_code ec;
+    auto p = fs::temp_directory_path(ec);
+    return ec ? std::string("/tmp") : p.string();
+}
+
+ExternalSorter::Less ExternalSorter::byField(const std::string& field, bool desc) {
+    return [field, desc](const Row& a, const Row& b) {
+        static const std::string empty;
+        auto ia = a.find(field), ib = b.find(field);
+        const std::string& va = (ia == a.end()) ? empty : ia->second;
+        const std::string& vb = (ib == b.end()) ? empty : ib->second;
+        return desc ? (vb < va) : (va < vb);
+    };
+}
+
+// --- run file format --------------------------------------------------------
+// Each row: u32 column count, then per column u32 len + name, u32 len + value.
+
+static void writeU32(FILE* f, uint32_t v) { fwrite(&v, sizeof(v), 1, f); }
+static void writeStr(FILE* f, const std::string& s) {
+    writeU32(f, (uint32_t)s.size());
+    if (!s.empty()) fwrite(s.data(), 1, s.size(), f);
+}
+static bool readU32(FILE* f, uint32_t& v) { return fread(&v, sizeof(v), 1, f) == 1; }
+static bool readStr(FILE* f, std::string& s) {
+    uint32_t n;
+    if (!readU32(f, n)) return false;
+    s.resize(n);
+    return n == 0 || fread(&s[0], 1, n, f) == n;
+}
+
+namespace {
+struct RunReader {
+    FILE* f = nullptr;
+    ExternalSorter::Row row;
+    explicit RunReader(const std::string& path) : f(fopen(path.c_str(), "rb")) {
+        if (!f) throw std::runtime_error("ExternalSorter: cannot open run " + path);
+        setvbuf(f, nullptr, _IOFBF, 1 << 16);
+    }
+    ~RunReader() { if (f) fclose(f); }
+    // load the next row into `row`; false at end of run
+    bool next() {
+        uint32_t cols;
+        if (!readU32(f, cols)) return false;
+        row.clear();
+        std::string k, v;
+        for (uint32_t i = 0; i < cols; ++i) {
+            if (!readStr(f, k) || !readStr(f, v))
+                throw std::runtime_error("ExternalSorter: truncated run file");
+            row.emplace_hint(row.end(), std::move(k), std::move(v));
+        }
+        return true;
+    }
+};
+
+struct RunWriter {
+    std::string path;
+    FILE* f = nullptr;
+    explicit RunWriter(std::string p) : path(std::move(p)), f(fopen(path.c_str(), "wb")) {
+        if (!f) throw std::runtime_error("ExternalSorter: cannot create run " + path);
+        setvbuf(f, nullptr, _IOFBF, 1 << 16);
+    }
+    ~RunWriter() { if (f) fclose(f); }
+    void put(const ExternalSorter::Row& row) {
+        writeU32(f, (uint32_t)row.size());
+        for (auto& kv : row) { writeStr(f, kv.first); writeStr(f, kv.second); }
+    }
+    void close() {
+        bool ok = !ferror(f);
+        ok = (fclose(f) == 0) && ok;
+        f = nullptr;
+        if (!ok) {
+            std::remove(path.c_str());
+            throw std::runtime_error("ExternalSorter: failed writing run " + path);
+        }
+    }
+};
+}
+
+ExternalSorter::ExternalSorter(Less less, size_t memoryBudget, std::string tempDir)
+    : _less(std::move(less)), _budget(memoryBudget), _tempDir(std::move(tempDir)) {}
+
+ExternalSorter::~ExternalSorter() {
+    for (auto& p : _runs) std::remove(p.c_str());
+}
+
+size_t ExternalSorter::rowBytes(const Row& row) {
+    // rough heap footprint: node + two strings per column
+    size_t n = sizeof(Row);
+    for (auto& kv : row) n += 64 + kv.first.capacity() + kv.second.capacity();
+    return n;
+}
+
+void ExternalSorter::add(Row row) {
+    if (_finished) throw std::logic_error("ExternalSorter::add after finish");
+    _bufferBytes += rowBytes(row);
+    _buffer.push_back(std::move(row));
+    if (_bufferBytes > _budget && _buffer.size() > 1) spill();
+}
+
+std::string ExternalSorter::newRunPath() const {
+    fs::create_directories(_tempDir);
+    return (fs::path(_tempDir) /
+        ("quarksql-sort-" + std::to_string(getpid()) + "-" +
+         std::to_string(g_sorterSeq.fetch_add(1)) + ".run")).string();
+}
+
+void ExternalSorter::spill() {
+    std::stable_sort(_buffer.begin(), _buffer.end(), _less);
+
+    RunWriter w(newRunPath());
+    for (auto& row : _buffer) w.put(row);
+    w.close();
+    _runs.push_back(w.path);
+
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+    _bufferBytes = 0;
+}
+
+void ExternalSorter::mergeRuns(size_t first, size_t last, const std::function<bool(Row&)>& fn) {
+    std::vector<std::unique_ptr<RunReader>> readers;
+    readers.reserve(last - first);
+    for (size_t i = first; i < last; ++i) readers.emplace_back(new RunReader(_runs[i]));
+
+    // min-heap over run heads; ties go to the earlier run to keep the sort stable
+    auto cmp = [&](size_t a, size_t b) {
+        if (_less(readers[b]->row, readers[a]->row)) return true;
+        if (_less(readers[a]->row, readers[b]->row)) return false;
+        return a > b;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(cmp)> heap(cmp);
+    for (size_t i = 0; i < readers.size(); ++i)
+        if (readers[i]->next()) heap.push(i);
+
+    while (!heap.empty()) {
+        size_t i = heap.top(); heap.pop();
+        if (!fn(readers[i]->row)) break;
+        if (readers[i]->next()) heap.push(i);
+    }
+}
+
+void ExternalSorter::finish(const std::function<bool(Row&)>& fn) {
+    if (_finished) throw std::logic_error("ExternalSorter::finish called twice");
+    _finished = true;
+
+    // Fast path: everything fit in memory
+    if (_runs.empty()) {
+        std::stable_sort(_buffer.begin(), _buffer.end(), _less);
+        for (auto& row : _buffer)
+            if (!fn(row)) break;
+        _buffer.clear();
+        return;
+    }
+
+    // Spill the tail too, so every source is a run and merge order is uniform
+    if (!_buffer.empty()) spill();
+
+    // Too many runs to hold open at once: merge adjacent groups into longer
+    // runs until one pass will do. Groups stay in spill order, so ties still
+    // resolve to the earlier row.
+    while (_runs.size() > kMaxFanIn) {
+        size_t n = _runs.size();
+        std::vector<std::string> merged;
+        for (size_t i = 0; i < n; i += kMaxFanIn) {
+            size_t end = std::min(n, i + kMaxFanIn);
+            if (end - i == 1) { merged.push_back(_runs[i]); continue; }
+            RunWriter w(newRunPath());
+            _runs.push_back(w.path);   // the destructor cleans it up if the merge throws
+            mergeRuns(i, end, [&](Row& row) { w.put(row); return true; });
+            w.close();
+            for (size_t j = i; j < end; ++j) std::remove(_runs[j].c_str());
+            merged.push_back(w.path);
+        }
+        _runs = std::move(merged);
+    }
+
+    mergeRuns(0, _runs.size(), fn);
+}
@@ -6,17 +6,54 @@
 #include <rocksdb/db.h>
 #include <rocksdb/iterator.h>
 #include <iostream>
+#include <iterator>
 
 // Define the static member
 std::unordered_map<
     std::string,
-    std::unordered_map<std::string, std::multimap<std::string, std::string>>
+    std::unordered_map<std::string, IndexManager::Entries>
 > IndexManager::index;
+std::shared_mutex IndexManager::mutex;
+
+// table -> field -> value -> number of entries with that value (see count());
+// guarded by IndexManager::mutex like the index itself
+static std::unordered_map<
+    std::string,
+    std::unordered_map<std::string, std::unordered_map<std::string, size_t>>
+> valueCounts;
+
+// add / drop one entry, keeping valueCounts in step; caller holds `mutex`
+// exclusively
+static void insertEntry(const std::string &table, const std::string &field,
+                        const std::string &value, const std::string &key)
+{
+    if (IndexManager::index[table][field].insert({ value, key }).second)
+        ++valueCounts[table][field][value];
+}
+static void eraseEntry(const std::string &table, const std::string &field,
+                       const std::string &value, const std::string &key)
+{
+    if (IndexManager::index[table][field].erase({ value, key }) == 0) return;
+    auto &counts = valueCounts[table][field];
+    if (auto it = counts.find(value); it != counts.end() && --it->second == 0)
+        counts.erase(it);
+}
+
+// entries of table.field, or nullptr; caller holds `mutex`
+static const IndexManager::Entries*
+findIndex(const std::string &table, const std::string &field)
+{
+    auto ti = IndexManager::index.find(table);
+    if (ti == IndexManager::index.end()) return nullptr;
+    auto fi = ti->second.find(field);
+    return fi == ti->second.end() ? nullptr : &fi->second;
+}
 
 // Check whether we have an in-memory index built for table.field
 bool IndexManager::hasIndex(const std::string &table,
                             const std::string &field)
 {
+    std::shared_lock<std::shared_mutex> lk(mutex);
     auto ti = index.find(table);
     if (ti == index.end()) return false;
     auto &fieldMap = ti->second;
@@ -24,12 +61,106 @@ bool IndexManager::hasIndex(const std::string &table,
 }
 
 
+std::vector<std::string> IndexManager::lookup(const std::string &table,
+                                              const std::string &field,
+                                              const std::string &value)
+{
+    std::vector<std::string> keys;
+    std::shared_lock<std::shared_mutex> lk(mutex);
+    if (auto *mm = findIndex(table, field)) {
+        for (auto it = mm->lower_bound({ value, std::string() });
+             it != mm->end() && it->first == value; ++it)
+            keys.push_back(it->second);
+    }
+    return keys;
+}
+
+std::vector<std::string> IndexManager::lookupPrefix(const std::string &table,
+                                                    const std::string &field,
+                                                    const std::string &prefix)
+{
+    std::vector<std::string> keys;
+    std::shared_lock<std::shared_mutex> lk(mutex);
+    if (auto *mm = findIndex(table, field)) {
+        for (auto it = mm->lower_bound({ prefix, std::string() });
+             it != mm->end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+            keys.push_back(it->second);
+    }
+    return keys;
+}
+
+std::vector<std::string> IndexManager::orderedKeys(const std::string &table,
+                                                   const std::string &field,
+                                                   bool desc, int skip, int limit)
+{
+    std::vector<std::string> keys;
+    std::shared_lock<std::shared_mutex> lk(mutex);
+    auto *mm = findIndex(table, field);
+    if (!mm || limit == 0) return keys;
+    int seen = 0;
+    auto take = [&](const std::string &k) {
+        if (seen++ < skip) return true;
+        keys.push_back(k);
+        return !(limit > 0 && (int)keys.size() >= limit);
+    };
+    if (!desc) {
+        for (auto it = mm->begin(); it != mm->end(); ++it)
+            if (!take(it->second)) break;
+    } else {
+        for (auto it = mm->rbegin(); it != mm->rend(); ++it)
+            if (!take(it->second)) break;
+    }
+    return keys;
+}
+
+std::vector<IndexManager::Entry> IndexManager::entriesAfter(const std::string &table,
+                                                           const std::string &field,
+                                                           bool desc, const Entry *after,
+                                                           size_t n)
+{
+    std::vector<Entry> out;
+    std::shared_lock<std::shared_mutex> lk(mutex);
+    auto *mm = findIndex(table, field);
+    if (!mm) return out;
+    if (!desc) {
+        for (auto it = after ? mm->upper_bound(*after) : mm->begin();
+             it != mm->end() && out.size() < n; ++it)
+            out.push_back(*it);
+    } else {
+        for (auto it = std::make_reverse_iterator(after ? mm->lower_bound(*after) : mm->end());
+             it != mm->rend() && out.size() < n; ++it)
+            out.push_back(*it);
+    }
+    return out;
+}
+
+size_t IndexManager::size(const std::string &table, const std::string &field) {
+    std::shared_lock<std::shared_mutex> lk(mutex);
+    auto *mm = findIndex(table, field);
+    return mm ? mm->size() : 0;
+}
+
+size_t IndexManager::count(const std::string &table, const std::string &field,
+                           const std::string &value)
+{
+    std::shared_lock<std::shared_mutex> lk(mutex);
+    auto ti = valueCounts.find(table);
+    if (ti == valueCounts.end()) return 0;
+    auto fi = ti->second.find(field);
+    if (fi == ti->second.end()) return 0;
+    auto vi = fi->second.find(value);
+    return vi == fi->second.end() ? 0 : vi->second;
+}
+
 void IndexManager::rebuildAll() {
+    std::unique_lock<std::shared_mutex> lk(mutex);
     index.clear();
+    valueCounts.clear();
     auto& mgr = DBManager::instance();
 
     // Only rebuild indices for tables defined in your schemas
     for (auto& [table, schema] : SchemaManager::allSchemas()) {
+        if (schema.indexedFields.empty()) continue;   // typed-only schema entry
         std::cout << "[IndexManager] Rebuilding index for table: " << table << std::endl;
 
         // Get-or-create the column-family handle for this table
@@ -58,12 +189,13 @@ void IndexManager::rebuildAll() {
                 continue;
             }
 
-            // For each indexed field in the schema, insert into the multimap
+            // For each indexed field in the schema, add (value, key); empty
+            // values aren't indexed, as in add()
             for (auto& field_pair : schema.indexedFields) {
                 const std::string& field = field_pair.first;
                 auto itr = row.find(field);
-                if (itr != row.end()) {
-                    index[table][field].insert({ itr->second, key });
+                if (itr != row.end() && !itr->second.empty()) {
+                    insertEntry(table, field, itr->second, key);
                 }
             }
         }
@@ -77,6 +209,7 @@ void IndexManager::add(
     const std::map<std::string, std::string>& oldRow
 ) {
     const auto& schema = SchemaManager::getSchema(table);
+    std::unique_lock<std::shared_mutex> lk(mutex);
 
     for (auto& field_pair : schema.indexedFields) {
         const std::string& field = field_pair.first;
@@ -85,16 +218,11 @@ void IndexManager::add(
 
         // Remove stale entries
         if (!oldVal.empty() && oldVal != newVal) {
-            auto& mmap = index[table][field];
-            auto range = mmap.equal_range(oldVal);
-            for (auto it = range.first; it != range.second; /* no increment here */) {
-                if (it->second == key) it = mmap.erase(it);
-                else ++it;
-            }
+            eraseEntry(table, field, oldVal, key);
         }
         // Insert new entries
         if (!newVal.empty() && newVal != oldVal) {
-            index[table][field].insert({ newVal, key });
+            insertEntry(table, field, newVal, key);
         }
     }
 }
@@ -105,19 +233,13 @@ void IndexManager::remove(
     const std::map<std::string, std::string>& oldRow
 ) {
     const auto& schema = SchemaManager::getSchema(table);
+    std::unique_lock<std::shared_mutex> lk(mutex);
 
     for (auto& field_pair : schema.indexedFields) {
         const std::string& field = field_pair.first;
         auto itOld = oldRow.find(field);
         if (itOld == oldRow.end()) continue;
-        const std::string& oldVal = itOld->second;
-
-        auto& mmap = index[table][field];
-        auto range = mmap.equal_range(oldVal);
-        for (auto it = range.first; it != range.second; /* no increment here */) {
-            if (it->second == key) it = mmap.erase(it);
-            else ++it;
-        }
+        eraseEntry(table, field, itOld->second, key);
     }
 }
 
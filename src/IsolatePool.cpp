@@ -0,0 +1,165 @@
+// IsolatePool.cpp
+#include "IsolatePool.h"
+#include <iostream>
+#include <stdexcept>
+
+IsolatePool& IsolatePool::instance() {
+    static IsolatePool pool;
+    return pool;
+}
+
+bool IsolatePool::init(size_t n, const InitFn& init,
+                       std::string snapshot, const intptr_t* externalRefs) {
+    if (n == 0) n = 1;
+    _snapshot = std::move(snapshot);
+    const bool fromSnapshot = !_snapshot.empty();
+    if (fromSnapshot) {
+        _blob.data     = _snapshot.data();
+        _blob.raw_size = (int)_snapshot.size();
+    }
+    for (size_t i = 0; i < n; ++i) {
+        auto s = std::make_unique<Slot>();
+        s->index = i;
+        s->allocator.reset(v8::ArrayBuffer::Allocator::NewDefaultAllocator());
+        v8::Isolate::CreateParams params;
+        params.array_buffer_allocator = s->allocator.get();
+        if (fromSnapshot) {
+            params.snapshot_blob       = &_blob;
+            params.external_references = externalRefs;
+        }
+        s->isolate = v8::Isolate::New(params);
+        s->isolate->SetData(0, s.get());
+
+        {
+            v8::Locker         locker(s->isolate);
+            v8::Isolate::Scope iscope(s->isolate);
+            v8::HandleScope    hs(s->isolate);
+            // from a snapshot this deserializes the default context, with
+            // bindings and modules in place
+            v8::Local<v8::Context> ctx = v8::Context::New(s->isolate);
+            v8::Context::Scope cscope(ctx);
+            s->context.Reset(s->isolate, ctx);
+            if (!fromSnapshot && !init(*s)) {
+                std::cerr << "[IsolatePool] init failed for isolate " << i << std::endl;
+                return false;
+            }
+        }
+        _slots.push_back(std::move(s));
+    }
+    std::cout << "[IsolatePool] " << _slots.size() << " isolates ready"
+              << (fromSnapshot ? " (from snapshot)" : "") << std::endl;
+    _ready = true;
+    return true;
+}
+
+std::string IsolatePool::createSnapshot(const InitFn& init, const intptr_t* externalRefs) {
+    v8::SnapshotCreator creator(externalRefs);
+    v8::Isolate* iso = creator.GetIsolate();   // already entered by the creator
+
+    Slot tmp;
+    tmp.isolate = iso;
+    iso->SetData(0, &tmp);
+    bool ok;
+    {
+        v8::HandleScope hs(iso);
+        v8::Local<v8::Context> ctx = v8::Context::New(iso);
+        {
+            v8::Context::Scope cscope(ctx);
+            tmp.context.Reset(iso, ctx);
+            ok = init(tmp);
+            tmp.context.Reset();   // no live Global handles while serializing
+        }
+        creator.SetDefaultContext(ctx);
+    }
+    iso->SetData(0, nullptr);
+
+    v8::StartupData blob = creator.CreateBlob(v8::SnapshotCreator::FunctionCodeHandling::kKeep);
+    std::string out;
+    if (ok && blob.data && blob.raw_size > 0)
+        out.assign(blob.data, (size_t)blob.raw_size);
+    delete[] blob.data;
+    if (!ok) std::cerr << "[IsolatePool] snapshot init failed" << std::endl;
+    return out;
+}
+
+v8::Local<v8::Object> IsolatePool::moduleRegistry(v8::Isolate* iso, v8::Local<v8::Context> ctx) {
+    if ((int)ctx->GetNumberOfEmbedderDataFields() > kModuleRegistryIndex) {
+        v8::Local<v8::Value> v = ctx->GetEmbedderData(kModuleRegistryIndex);
+        if (v->IsObject()) return v.As<v8::Object>();
+    }
+    v8::Local<v8::Object> reg = v8::Object::New(iso);
+    ctx->SetEmbedderData(kModuleRegistryIndex, reg);
+    return reg;
+}
+
+void IsolatePool::beginAsync(Slot& s) {
+    std::lock_guard<std::mutex> lk(s.taskMu);
+    ++s.inflight;
+}
+
+void IsolatePool::post(Slot& s, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lk(s.taskMu);
+        s.tasks.push_back(std::move(task));
+    }
+    s.taskCv.notify_one();
+}
+
+bool IsolatePool::runPosted(Slot& s, bool wait) {
+    std::deque<std::function<void()>> ready;
+    {
+        std::unique_lock<std::mutex> lk(s.taskMu);
+        if (wait)
+            s.taskCv.wait(lk, [&s] { return !s.tasks.empty() || s.inflight == 0; });
+        ready.swap(s.tasks);
+    }
+    if (ready.empty()) return false;
+    for (auto& t : ready) {
+        v8::HandleScope hs(s.isolate);
+        v8::Context::Scope cscope(s.context.Get(s.isolate));
+        t();
+    }
+    std::lock_guard<std::mutex> lk(s.taskMu);
+    s.inflight -= ready.size();
+    return true;
+}
+
+IsolatePool::Slot* IsolatePool::acquire(size_t index) {
+    std::unique_lock<std::mutex> lk(_mu);
+    if (_slots.empty()) throw std::runtime_error("IsolatePool: not initialized");
+    for (;;) {
+        if (index < _slots.size()) {
+            if (!_slots[index]->busy) {
+                _slots[index]->busy = true;
+                return _slots[index].get();
+            }
+        } else {
+            for (auto& s : _slots)
+                if (!s->busy) { s->busy = true; return s.get(); }
+        }
+        _cv.wait(lk);
+    }
+}
+
+void IsolatePool::release(Slot* s) {
+    {
+        std::lock_guard<std::mutex> lk(_mu);
+        s->busy = false;
+    }
+    _cv.notify_all();
+}
+
+IsolatePool::Lease::Lease(IsolatePool& pool)
+    : _pool(pool), _slot(pool.acquire(pool.size())) {}
+
+IsolatePool::Lease::Lease(IsolatePool& pool, size_t index)
+    : _pool(pool), _slot(pool.acquire(index)) {}
+
+IsolatePool::Lease::~Lease() { _pool.release(_slot); }
+
+void IsolatePool::forEach(const std::function<void(Slot&)>& fn) {
+    for (size_t i = 0; i < _slots.size(); ++i) {
+        Lease lease(*this, i);
+        fn(lease.slot());
+    }
+}
@@ -1,16 +1,20 @@
 // src/JsonUtils.cpp
 #include "JsonUtils.h"
+#include "LikeMatcher.h"
 #include <crow/json.h>
 #include <sstream>
 #include <stdexcept>
 #include <iomanip>
 #include <cmath>
+#include <memory>
+#include <strings.h>
+#include <unordered_map>
 
 using crow::json::rvalue;
 using crow::json::load;
 
 // parseDate implementation
-time_t parseDate(const std::string& s) {
+time_t JsonUtils::parseDate(const std::string& s) {
     std::tm tm = {};
     if (strptime(s.c_str(), "%Y-%m-%d", &tm) == nullptr) {
         throw std::runtime_error("parseDate: invalid date format");
@@ -24,7 +28,7 @@ time_t parseDate(const std::string& s) {
 }
 
 // likeToRegex implementation
-std::regex likeToRegex(const std::string& pattern) {
+std::regex JsonUtils::likeToRegex(const std::string& pattern) {
     std::string re = "^";
     for (char c : pattern) {
         if (c == '%')      re += ".*";
@@ -37,19 +41,26 @@ std::regex likeToRegex(const std::string& pattern) {
 }
 
 // evalPredicate implementation
-bool evalPredicate(const std::string& fieldValue,
-                   const std::string& op,
-                   const std::string& literal) {
+bool JsonUtils::evalPredicate(const std::string& fieldValue,
+                              const std::string& op,
+                              const std::string& literal) {
     if (op == "=")  return fieldValue == literal;
     if (op == "!=") return fieldValue != literal;
     if (op == "<")  return fieldValue <  literal;
     if (op == "<=") return fieldValue <= literal;
     if (op == ">")  return fieldValue >  literal;
     if (op == ">=") return fieldValue >= literal;
-    if (op == "LIKE") {
-        static std::regex cache; // placeholder
-        std::regex re = likeToRegex(literal);
-        return std::regex_match(fieldValue, re);
+    bool ilike = strcasecmp(op.c_str(), "ILIKE") == 0;
+    if (ilike || strcasecmp(op.c_str(), "LIKE") == 0) {
+        // compile each pattern once per thread instead of a regex per call
+        thread_local std::unordered_map<std::string, std::unique_ptr<LikeMatcher>> cache;
+        std::string key = (ilike ? "I:" : "L:") + literal;
+        auto it = cache.find(key);
+        if (it == cache.end()) {
+            if (cache.size() >= 256) cache.clear();
+            it = cache.emplace(key, std::make_unique<LikeMatcher>(literal, ilike)).first;
+        }
+        return it->second->matches(fieldValue);
     }
     throw std::runtime_error("evalPredicate: unknown operator " + op);
 }
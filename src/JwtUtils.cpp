@@ -1,8 +1,14 @@
 // src/JwtUtils.cpp
 #include "JwtUtils.h"
+#include "CryptoUtils.h"
 #include <jwt-cpp/jwt.h>
 #include <picojson/picojson.h>
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_map>
 
 std::string CppSignJwt(const std::string& payloadJson, const std::string& secret) {
     // Parse payloadJson into picojson::value
@@ -12,10 +18,15 @@ std::string CppSignJwt(const std::string& payloadJson, const std::string& secret
         throw std::runtime_error("JSON parse error: " + err);
     }
 
-    // Create and sign JWT with a "data" claim
-    auto token = jwt::create()
-        .set_payload_claim("data", jwt::claim(v))
-        .sign(jwt::algorithm::hs256{secret});
+    // Create and sign JWT with a "data" claim; a numeric "exp" in the
+    // payload also becomes the registered exp claim, so verifiers enforce it
+    auto builder = jwt::create()
+        .set_payload_claim("data", jwt::claim(v));
+    if (v.is<picojson::object>() && v.contains("exp") && v.get("exp").is<double>()) {
+        auto exp = std::chrono::seconds((long long)v.get("exp").get<double>());
+        builder.set_expires_at(std::chrono::system_clock::time_point(exp));
+    }
+    auto token = builder.sign(jwt::algorithm::hs256{secret});
 
     return token;
 }
@@ -36,3 +47,90 @@ std::string CppVerifyJwt(const std::string& token, const std::string& secret) {
 
 }
 
+// --- JwtVerifier -------------------------------------------------------------
+
+namespace {
+using Clock = std::chrono::system_clock;
+// upper bound on how long a verified token is trusted without re-checking
+constexpr std::chrono::minutes kMaxCacheAge{5};
+}
+
+struct JwtVerifier::Impl {
+    using Verifier = decltype(jwt::verify());
+
+    Impl(const std::string& secret, size_t cap)
+        : verifier(jwt::verify().allow_algorithm(jwt::algorithm::hs256{secret})),
+          capacity(cap) {}
+
+    struct Entry {
+        std::string       key;       // SHA-256 of the token
+        std::string       payload;
+        Clock::time_point until;
+    };
+
+    Verifier                 verifier;   // const use only: shared by all threads
+    size_t                   capacity;
+    std::mutex               mu;
+    std::list<Entry>         lru;        // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+};
+
+JwtVerifier& JwtVerifier::instance() {
+    static JwtVerifier v;
+    return v;
+}
+
+JwtVerifier::JwtVerifier() { configure("QuarksSecret", 10000); }
+JwtVerifier::~JwtVerifier() = default;
+
+void JwtVerifier::configure(const std::string& secret, size_t capacity) {
+    _secret = secret;
+    _impl.reset(new Impl(secret, capacity));
+}
+
+std::string JwtVerifier::verify(const std::string& token) {
+    Impl& im = *_impl;
+    const std::string key = CppSha256(token);
+    const auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lk(im.mu);
+        auto it = im.index.find(key);
+        if (it != im.index.end()) {
+            if (now < it->second->until) {
+                im.lru.splice(im.lru.begin(), im.lru, it->second);
+                return it->second->payload;
+            }
+            im.lru.erase(it->second);
+            im.index.erase(it);
+        }
+    }
+
+    picojson::value data;
+    auto until = now + kMaxCacheAge;
+    try {
+        auto decoded = jwt::decode(token);
+        im.verifier.verify(decoded);   // signature, exp, nbf, iat
+        data = decoded.get_payload_claim("data").to_json();
+        if (decoded.has_expires_at())
+            until = std::min(until, decoded.get_expires_at());
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("invalid token: ") + e.what());
+    }
+    // tokens signed before exp was mirrored to the registered claim
+    if (data.is<picojson::object>() && data.contains("exp") && data.get("exp").is<double>()) {
+        auto exp = Clock::time_point(std::chrono::seconds((long long)data.get("exp").get<double>()));
+        if (exp <= now) throw std::runtime_error("invalid token: token expired");
+        until = std::min(until, exp);
+    }
+    std::string payload = data.serialize();
+
+    std::lock_guard<std::mutex> lk(im.mu);
+    if (im.capacity == 0 || im.index.count(key)) return payload;
+    im.lru.push_front(Impl::Entry{key, payload, until});
+    im.index.emplace(key, im.lru.begin());
+    while (im.lru.size() > im.capacity) {
+        im.index.erase(im.lru.back().key);
+        im.lru.pop_back();
+    }
+    return payload;
+}
@@ -0,0 +1,176 @@
+// LikeMatcher.cpp
+#include "LikeMatcher.h"
+#include <cctype>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static inline char lower(char c) {
+    return (char)std::tolower((unsigned char)c);
+}
+
+LikeMatcher::LikeMatcher(const std::string& pattern, bool caseInsensitive)
+    : _icase(caseInsensitive)
+{
+    // 1) split on unescaped %, remembering which characters are '_' wildcards
+    std::vector<Segment> parts(1);
+    bool sawPercent = false;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        bool escaped = false;
+        if (c == '\\' && i + 1 < pattern.size()) {
+            c = pattern[++i];
+            escaped = true;
+        }
+        if (!escaped && c == '%') {
+            sawPercent = true;
+            parts.emplace_back();
+            continue;
+        }
+        Segment& seg = parts.back();
+        if (!escaped && c == '_') {
+            seg.text.push_back('\0');   // placeholder, position marked in mask
+            seg.hasAny = true;
+            seg.mask.resize(seg.text.size(), 0);
+            seg.mask.back() = 1;
+        } else {
+            seg.text.push_back(_icase ? lower(c) : c);
+            if (seg.hasAny) seg.mask.push_back(0);
+        }
+    }
+    _leadingAny  = sawPercent && parts.front().text.empty();
+    _trailingAny = sawPercent && parts.back().text.empty();
+
+    for (auto& p : parts) {
+        if (p.hasAny) p.mask.resize(p.text.size(), 0);
+        if (!p.text.empty()) _segments.push_back(std::move(p));
+    }
+
+    // 2) literal prefix (up to the first wildcard) for index seeks
+    if (!_leadingAny && !_segments.empty()) {
+        const Segment& first = _segments.front();
+        size_t n = first.text.size();
+        if (first.hasAny) n = first.mask.find('\1');
+        _prefix = first.text.substr(0, n);
+    }
+
+    // 3) classify
+    if (_segments.empty()) {
+        _kind = sawPercent ? Kind::All : Kind::Exact;   // '' only matches ''
+        return;
+    }
+    if (_segments.size() == 1 && !_segments[0].hasAny) {
+        _literal = _segments[0].text;
+        if (!sawPercent)                     _kind = Kind::Exact;
+        else if (!_leadingAny && _trailingAny) _kind = Kind::Prefix;
+        else if (_leadingAny && !_trailingAny) _kind = Kind::Suffix;
+        else if (_leadingAny && _trailingAny)  _kind = Kind::Contains;
+        else                                   _kind = Kind::General;
+        if (_kind != Kind::General) { _segments.clear(); return; }
+    }
+    _kind = Kind::General;
+    _exactLength = !sawPercent;
+}
+
+bool LikeMatcher::matches(std::string_view s) const {
+    thread_local std::string folded;
+    if (_icase) {
+        folded.assign(s.data(), s.size());
+        for (char& c : folded) c = lower(c);
+        s = folded;
+    }
+    const size_t n = _literal.size();
+    switch (_kind) {
+        case Kind::Exact:    return s == _literal;
+        case Kind::Prefix:   return s.size() >= n && s.compare(0, n, _literal) == 0;
+        case Kind::Suffix:   return s.size() >= n && s.compare(s.size() - n, n, _literal) == 0;
+        case Kind::Contains: return find(s, _literal) != std::string_view::npos;
+        case Kind::All:      return true;
+        case Kind::General:  return matchGeneral(s);
+    }
+    return false;
+}
+
+bool LikeMatcher::segmentAt(std::string_view s, size_t pos, const Segment& seg) {
+    const size_t len = seg.text.size();
+    if (pos > s.size() || s.size() - pos < len) return false;
+    if (!seg.hasAny) return s.compare(pos, len, seg.text) == 0;
+    for (size_t i = 0; i < len; ++i)
+        if (!seg.mask[i] && s[pos + i] != seg.text[i]) return false;
+    return true;
+}
+
+size_t LikeMatcher::findSegment(std::string_view s, size_t from, const Segment& seg) {
+    if (!seg.hasAny) return find(s, seg.text, from);
+    const size_t len = seg.text.size();
+    for (size_t p = from; p + len <= s.size(); ++p)
+        if (segmentAt(s, p, seg)) return p;
+    return std::string_view::npos;
+}
+
+bool LikeMatcher::matchGeneral(std::string_view s) const {
+    size_t lo = 0, hi = _segments.size();
+    size_t begin = 0, end = s.size();
+
+    // no % at all: single segment with '_' wildcards, anchored both ends
+    if (_exactLength)
+        return s.size() == _segments[0].text.size() && segmentAt(s, 0, _segments[0]);
+
+    if (!_leadingAny) {                      // first piece anchored at start
+        if (!segmentAt(s, 0, _segments[0])) return false;
+        begin = _segments[0].text.size();
+        lo = 1;
+    }
+    if (!_trailingAny && hi > lo) {          // last piece anchored at end
+        const Segment& last = _segments[hi - 1];
+        if (end - begin < last.text.size()) return false;
+        if (!segmentAt(s, end - last.text.size(), last)) return false;
+        end -= last.text.size();
+        --hi;
+    }
+    // middle pieces: leftmost match each, which is optimal for LIKE
+    std::string_view window = s.substr(0, end);
+    for (size_t k = lo; k < hi; ++k) {
+        size_t p = findSegment(window, begin, _segments[k]);
+        if (p == std::string_view::npos) return false;
+        begin = p + _segments[k].text.size();
+    }
+    return true;
+}
+
+size_t LikeMatcher::find(std::string_view hay, std::string_view needle, size_t from) {
+    if (from > hay.size()) return std::string_view::npos;
+    const size_t m = needle.size();
+    const size_t n = hay.size() - from;
+    const char*  h = hay.data() + from;
+    if (m == 0) return from;
+    if (m > n)  return std::string_view::npos;
+    if (m == 1) {
+        const void* p = std::memchr(h, needle[0], n);
+        return p ? (size_t)((const char*)p - hay.data()) : std::string_view::npos;
+    }
+    size_t i = 0;
+#ifdef __SSE2__
+    // Compare 16 candidate positions at once on the first and last needle
+    // byte; only positions where both agree get a full memcmp.
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last  = _mm_set1_epi8(needle[m - 1]);
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i*)(h + i));
+        __m128i bl = _mm_loadu_si128((const __m128i*)(h + i + m - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(first, bf), _mm_cmpeq_epi8(last, bl)));
+        while (mask) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (std::memcmp(h + i + bit + 1, needle.data() + 1, m - 2) == 0)
+                return from + i + bit;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i + m <= n; ++i)
+        if (h[i] == needle[0] && std::memcmp(h + i, needle.data(), m) == 0)
+            return from + i;
+    return std::string_view::npos;
+}
@@ -0,0 +1,165 @@
+// Predicate.cpp
+#include "Predicate.h"
+#include "SchemaManager.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <stdexcept>
+#include <strings.h>
+
+CmpOp Predicate::parseOp(const std::string &op) {
+    if (op == "=")  return CmpOp::EQ;
+    if (op == "!=") return CmpOp::NE;
+    if (op == "<")  return CmpOp::LT;
+    if (op == ">")  return CmpOp::GT;
+    if (op == "<=") return CmpOp::LE;
+    if (op == ">=") return CmpOp::GE;
+    if (strcasecmp(op.c_str(), "LIKE") == 0)  return CmpOp::LIKE;
+    if (strcasecmp(op.c_str(), "ILIKE") == 0) return CmpOp::ILIKE;
+    throw std::runtime_error("Unsupported operator: " + op);
+}
+
+// Whole-string decimal number (no trailing junk, no hex/inf/nan)
+bool Predicate::parseNumber(const std::string &s, double &out) {
+    if (s.empty()) return false;
+    const char *p = s.c_str();
+    char c = *p;
+    if (!(std::isdigit((unsigned char)c) || c == '-' || c == '+' || c == '.')) return false;
+    for (const char *q = p; *q; ++q)
+        if (*q == 'x' || *q == 'X' || *q == 'n' || *q == 'N' || *q == 'i' || *q == 'I') return false;
+    char *end = nullptr;
+    errno = 0;
+    double v = std::strtod(p, &end);
+    if (end == p || *end != '\0' || errno == ERANGE) return false;
+    out = v;
+    return true;
+}
+
+// Days since 1970-01-01 for a string starting with YYYY-MM-DD
+// (anything after the date, e.g. a time part, is ignored)
+bool Predicate::parseDay(const std::string &s, int64_t &out) {
+    if (s.size() < 10 || s[4] != '-' || s[7] != '-') return false;
+    for (int i : {0,1,2,3,5,6,8,9})
+        if (!std::isdigit((unsigned char)s[i])) return false;
+    if (s.size() > 10 && s[10] != 'T' && s[10] != ' ') return false;
+    int64_t y = (s[0]-'0')*1000 + (s[1]-'0')*100 + (s[2]-'0')*10 + (s[3]-'0');
+    unsigned m = (s[5]-'0')*10 + (s[6]-'0');
+    unsigned d = (s[8]-'0')*10 + (s[9]-'0');
+    if (m < 1 || m > 12 || d < 1 || d > 31) return false;
+    // days_from_civil (proleptic Gregorian)
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    out = era * 146097 + (int64_t)doe - 719468;
+    return true;
+}
+
+template <typename T>
+static bool compareAs(CmpOp op, const T &a, const T &b) {
+    switch (op) {
+        case CmpOp::EQ: return a == b;
+        case CmpOp::NE: return a != b;
+        case CmpOp::LT: return a <  b;
+        case CmpOp::GT: return a >  b;
+        case CmpOp::LE: return a <= b;
+        case CmpOp::GE: return a >= b;
+        default:        return false;
+    }
+}
+
+bool CompiledCondition::matches(const std::string &value) const {
+    if (op == CmpOp::LIKE || op == CmpOp::ILIKE)
+        return like->matches(value);
+
+    // undeclared columns keep exact text equality
+    bool equality = (op == CmpOp::EQ || op == CmpOp::NE);
+    if (!declared && equality) return compareAs(op, value, text);
+
+    switch (type) {
+        case ValueType::Number: {
+            double v;
+            if (Predicate::parseNumber(value, v)) return compareAs(op, v, num);
+            break;
+        }
+        case ValueType::Date: {
+            int64_t v;
+            if (Predicate::parseDay(value, v)) return compareAs(op, v, day);
+            break;
+        }
+        case ValueType::String:
+            break;
+    }
+    return compareAs(op, value, text);
+}
+
+bool CompiledCondition::indexable() const {
+    if (op == CmpOp::EQ)
+        return !declared || type == ValueType::String;
+    if (op == CmpOp::LIKE)
+        return !like->literalPrefix().empty();
+    return false;
+}
+
+static ValueType declaredType(const std::string &t, bool &known) {
+    known = true;
+    if (t == "number" || t == "int" || t == "integer" || t == "float" || t == "double" || t == "decimal")
+        return ValueType::Number;
+    if (t == "date" || t == "datetime" || t == "timestamp")
+        return ValueType::Date;
+    if (t == "string" || t == "text")
+        return ValueType::String;
+    known = false;
+    return ValueType::String;
+}
+
+Predicate Predicate::compile(const std::string &table,
+                             const std::vector<Condition> &conds)
+{
+    Predicate p;
+    p._conds.reserve(conds.size());
+    for (auto &c : conds) {
+        CompiledCondition cc;
+        std::string tbl = table;
+        cc.key = c.key;
+        if (auto dot = c.key.find('.'); dot != std::string::npos) {
+            tbl    = c.key.substr(0, dot);
+            cc.key = c.key.substr(dot + 1);
+        }
+        cc.op   = parseOp(c.op);
+        cc.text = c.value;
+        if (cc.op == CmpOp::LIKE || cc.op == CmpOp::ILIKE) {
+            cc.like = std::make_shared<LikeMatcher>(cc.text, cc.op == CmpOp::ILIKE);
+            p._conds.push_back(std::move(cc));
+            continue;
+        }
+
+        bool haveNum  = parseNumber(cc.text, cc.num);
+        bool haveDay  = parseDay(cc.text, cc.day);
+        bool known    = false;
+        ValueType t   = declaredType(SchemaManager::columnType(tbl, cc.key), known);
+        if (known) {
+            cc.declared = true;
+            // a literal that doesn't parse as the declared type compares as text
+            if ((t == ValueType::Number && !haveNum) || (t == ValueType::Date && !haveDay))
+                t = ValueType::String;
+            cc.type = t;
+        } else {
+            cc.type = haveNum ? ValueType::Number
+                    : haveDay ? ValueType::Date
+                              : ValueType::String;
+        }
+        p._conds.push_back(std::move(cc));
+    }
+    return p;
+}
+
+bool Predicate::matches(const std::map<std::string,std::string> &row) const {
+    static const std::string empty;
+    for (auto &c : _conds) {
+        auto it = row.find(c.key);
+        if (!c.matches(it == row.end() ? empty : it->second)) return false;
+    }
+    return true;
+}
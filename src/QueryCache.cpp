@@ -0,0 +1,124 @@
+// QueryCache.cpp
+#include "QueryCache.h"
+#include "DBManager.h"
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+struct QueryCache::Impl {
+    struct Entry {
+        std::string                        key;
+        std::vector<std::string>           tables;
+        std::vector<uint64_t>              versions;
+        std::shared_ptr<const QueryResult> result;
+        size_t                             bytes;
+    };
+
+    std::mutex               mu;
+    std::list<Entry>         lru;        // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t                   bytes = 0;
+    Stats                    stats;
+
+    void erase(std::list<Entry>::iterator it) {
+        bytes -= it->bytes;
+        index.erase(it->key);
+        lru.erase(it);
+    }
+};
+
+// rough heap footprint of a result: strings plus map/vector overhead
+static size_t resultBytes(const QueryResult &r) {
+    size_t n = sizeof(QueryResult) + r.rows.size() * sizeof(QueryResultRow);
+    for (auto &row : r.rows)
+        for (auto &[k, v] : row.vals)
+            n += k.size() + v.size() + 64;
+    return n;
+}
+
+QueryCache& QueryCache::instance() {
+    static QueryCache c;
+    return c;
+}
+
+QueryCache::QueryCache() : _impl(new Impl) {}
+QueryCache::~QueryCache() = default;
+
+void QueryCache::configure(size_t capacityBytes) {
+    _capacity = capacityBytes;
+    _impl.reset(new Impl);
+}
+
+std::vector<std::string> QueryCache::tables(const Query &q) {
+    std::vector<std::string> t{ q.table };
+    for (auto &j : q.joins) {
+        t.push_back(j.leftTable);
+        t.push_back(j.rightTable);
+    }
+    std::sort(t.begin(), t.end());
+    t.erase(std::unique(t.begin(), t.end()), t.end());
+    return t;
+}
+
+std::vector<uint64_t> QueryCache::versions(const std::vector<std::string> &tables) {
+    auto &mgr = DBManager::instance();
+    std::vector<uint64_t> v;
+    v.reserve(tables.size());
+    for (auto &t : tables) v.push_back(mgr.tableVersion(t));
+    return v;
+}
+
+bool QueryCache::lookup(const std::string &key, QueryResult &out) {
+    Impl &im = *_impl;
+    std::shared_ptr<const QueryResult> hit;
+    {
+        std::lock_guard<std::mutex> lk(im.mu);
+        auto it = im.index.find(key);
+        if (it == im.index.end()) { ++im.stats.misses; return false; }
+        if (versions(it->second->tables) != it->second->versions) {
+            im.erase(it->second);
+            ++im.stats.invalidations;
+            ++im.stats.misses;
+            return false;
+        }
+        im.lru.splice(im.lru.begin(), im.lru, it->second);
+        hit = it->second->result;
+        ++im.stats.hits;
+    }
+    out = *hit;   // copied outside the lock
+    return true;
+}
+
+void QueryCache::store(const std::string &key,
+                       const std::vector<std::string> &tables,
+                       const std::vector<uint64_t> &versions,
+                       const QueryResult &r)
+{
+    if (!enabled()) return;
+    size_t bytes = resultBytes(r) + key.size();
+    if (bytes > _capacity / 4) return;
+    auto result = std::make_shared<const QueryResult>(r);
+
+    Impl &im = *_impl;
+    std::lock_guard<std::mutex> lk(im.mu);
+    if (auto it = im.index.find(key); it != im.index.end()) im.erase(it->second);
+    im.lru.push_front(Impl::Entry{key, tables, versions, std::move(result), bytes});
+    im.index.emplace(key, im.lru.begin());
+    im.bytes += bytes;
+    while (im.bytes > _capacity && !im.lru.empty()) {
+        im.erase(std::prev(im.lru.end()));
+        ++im.stats.evictions;
+    }
+}
+
+QueryCache::Stats QueryCache::stats() const {
+    Impl &im = *_impl;
+    std::lock_guard<std::mutex> lk(im.mu);
+    Stats s = im.stats;
+    s.entries  = im.lru.size();
+    s.bytes    = im.bytes;
+    s.capacity = _capacity;
+    return s;
+}
@@ -0,0 +1,153 @@
+// QueryCursor.cpp
+#include "QueryCursor.h"
+#include "QueryExecutor.h"
+#include "SqlParser.h"
+#include "DBManager.h"
+#include "JsonUtils.h"
+#include <algorithm>
+#include <stdexcept>
+
+QueryCursor::QueryCursor(const std::string &sql)
+    : _q(SqlParser::parse(sql))
+{
+    if (_q.type != QueryType::SELECT)
+        throw std::runtime_error("db.cursor: not a SELECT: " + sql);
+
+    // Only base-table conditions can be streamed; anything that reorders,
+    // groups or joins rows needs the whole input first
+    std::vector<Condition> conds;
+    bool simple = _q.joins.empty() && _q.groupBy.empty() && !_q.isCount
+                  && _q.aggs.empty() && _q.windows.empty() && _q.orderByField.empty();
+    for (auto &c : _q.conditions) {
+        if (!simple) break;
+        auto dot = c.key.find('.');
+        if (dot == std::string::npos) { conds.push_back(c); continue; }
+        if (c.key.substr(0, dot) != _q.table) { simple = false; break; }
+        Condition cc = c; cc.key = c.key.substr(dot + 1); conds.push_back(cc);
+    }
+
+    if (!simple) {
+        QueryExecutor::execute(_q, _result);
+        return;
+    }
+
+    auto &mgr  = DBManager::instance();
+    _streaming = true;
+    _pred      = Predicate::compile(_q.table, conds);
+    _wild      = (_q.selectCols.size() == 1 && _q.selectCols[0] == "*");
+    _cf        = mgr.cf(_q.table);
+    _snap      = mgr.db()->GetSnapshot();
+    _exhausted = (_q.limit == 0);
+    _seek      = mgr.seekKeys(_q.table, _pred, _keys);
+    if (!_seek) {
+        rocksdb::ReadOptions ro;
+        ro.snapshot = _snap;
+        _it.reset(mgr.db()->NewIterator(ro, _cf));
+        _it->SeekToFirst();
+    }
+}
+
+QueryCursor::~QueryCursor() {
+    close();
+}
+
+void QueryCursor::close() {
+    if (_closed) return;
+    try { waitPrefetch(); } catch (...) {}
+    _closed = true;
+    _ahead.clear();
+    _it.reset();
+    if (_snap) {
+        DBManager::instance().db()->ReleaseSnapshot(_snap);
+        _snap = nullptr;
+    }
+    _result.rows.clear();
+}
+
+void QueryCursor::waitPrefetch() {
+    if (!_prefetching) return;
+    _prefetching = false;
+    auto group = std::move(_prefetch);
+    group->wait();   // rethrows the read-ahead's error
+}
+
+// next raw row of the snapshot, before filtering; false at the end
+bool QueryCursor::nextRow(std::map<std::string,std::string> &row) {
+    if (_seek) {
+        rocksdb::ReadOptions ro;
+        ro.snapshot = _snap;
+        std::string val;
+        while (_ki < _keys.size()) {
+            if (!DBManager::instance().db()->Get(ro, _cf, _keys[_ki++], &val).ok()) continue;
+            row = JsonUtils::parseToMap(val);
+            return true;
+        }
+        return false;
+    }
+    if (!_it->Valid()) return false;
+    row = JsonUtils::parseToMap(_it->value().ToString());
+    _it->Next();
+    return true;
+}
+
+void QueryCursor::fill(size_t n, std::vector<QueryResultRow> &out) {
+    auto tok = CancellationToken::current();
+    std::map<std::string,std::string> row;
+    size_t read = 0;
+    while (!_exhausted && out.size() < n) {
+        if ((++read & 1023) == 0) tok.throwIfCancelled();
+        if (!nextRow(row)) { _exhausted = true; break; }
+        if (!_pred.matches(row)) continue;
+        if (_skipped < _q.skip) { ++_skipped; continue; }
+
+        QueryResultRow o;
+        if (_wild) {
+            o.vals = std::move(row);
+        } else {
+            for (auto &col : _q.selectCols) {
+                auto fld = col;
+                if (auto p = fld.find('.'); p != std::string::npos)
+                    fld = fld.substr(p + 1);
+                o.vals[col] = row[fld];
+            }
+        }
+        out.push_back(std::move(o));
+        if (_q.limit > 0 && ++_emitted >= _q.limit) _exhausted = true;
+    }
+}
+
+void QueryCursor::next(size_t n, QueryResult &out) {
+    out.rows.clear();
+    out.affected = 0;
+    if (_closed || n == 0) return;
+
+    if (!_streaming) {
+        size_t end = std::min(_result.rows.size(), _pos + n);
+        out.rows.reserve(end - _pos);
+        for (; _pos < end; ++_pos)
+            out.rows.push_back(std::move(_result.rows[_pos]));
+        if (_pos == _result.rows.size()) _result.rows.clear();
+        out.affected = (int)out.rows.size();
+        return;
+    }
+
+    // take what the read-ahead produced, then top up synchronously
+    waitPrefetch();
+    if (_ahead.size() > n) {
+        out.rows.assign(std::make_move_iterator(_ahead.begin()),
+                        std::make_move_iterator(_ahead.begin() + n));
+        _ahead.erase(_ahead.begin(), _ahead.begin() + n);
+    } else {
+        out.rows = std::move(_ahead);
+        _ahead.clear();
+        fill(n, out.rows);
+    }
+    out.affected = (int)out.rows.size();
+
+    // read the next batch while the caller processes this one
+    if (!_exhausted && _ahead.size() < n) {
+        _prefetch.reset(new TaskGroup());
+        _prefetching = true;
+        _prefetch->run([this, n] { fill(n, _ahead); });
+    }
+}
@@ -3,29 +3,41 @@
 #include "SqlParser.h"
 #include "DBManager.h"
 #include "IndexManager.h"
+#include "ExternalSorter.h"
+#include "Predicate.h"
+#include "WorkerPool.h"
+#include "ViewManager.h"
+#include "QueryCache.h"
+#include "JsonUtils.h"
+#include "Sketch.h"
+#include <json.hpp>
 #include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
 
-static bool evalCond(const std::string &lhs,
-                     const std::string &op,
-                     const std::string &rhs)
-{
-    if (op=="=")  return lhs==rhs;
-    if (op=="!=") return lhs!=rhs;
-    if (op=="<")  return lhs<rhs;
-    if (op==">")  return lhs>rhs;
-    if (op=="<=") return lhs<=rhs;
-    if (op==">=") return lhs>=rhs;
-    if (op=="LIKE") return lhs.find(rhs)!=std::string::npos;
-    return false;
-}
+using json = nlohmann::json;
 
 void QueryExecutor::execute(const Query &q, QueryResult &r) {
-	switch (q.type) {
+    // views are written only by their maintenance
+    if (q.type != QueryType::SELECT && q.type != QueryType::CREATE_VIEW
+        && q.type != QueryType::DROP_VIEW && q.type != QueryType::REFRESH_VIEW
+        && ViewManager::isView(q.table))
+        throw std::runtime_error(q.table + " is a materialized view (read-only)");
+
+    switch (q.type) {
       case QueryType::INSERT: handleInsert(q,r); break;
       case QueryType::UPDATE: handleUpdate(q,r); break;
       case QueryType::DELETE: handleDelete(q,r); break;
       case QueryType::BATCH:  handleBatch (q,r); break;
-      case QueryType::SELECT: handleSelect(q,r); break;
+      case QueryType::SELECT: cachedSelect(q,r); break;
+      case QueryType::CREATE_VIEW:
+      case QueryType::DROP_VIEW:
+      case QueryType::REFRESH_VIEW: handleView(q,r); break;
     }
     
     q.print();
@@ -81,32 +93,421 @@ void QueryExecutor::handleBatch(const Query &q, QueryResult &r) {
     r.affected = cnt;
 }
 
+void QueryExecutor::cachedSelect(const Query &q, QueryResult &r) {
+    auto &cache = QueryCache::instance();
+    if (!cache.enabled() || q.text.empty()) { handleSelect(q,r); return; }
+    // a db.page result differs from the plain query's (order of ties, next)
+    const std::string key = q.keyset ? "PAGE " + q.text : q.text;
+    if (cache.lookup(key, r)) return;
+    // versions before the read: a write committed meanwhile makes the
+    // entry stale rather than letting it pass for current
+    auto tables   = QueryCache::tables(q);
+    auto versions = QueryCache::versions(tables);
+    handleSelect(q,r);
+    cache.store(key, tables, versions, r);
+}
+
+void QueryExecutor::handleView(const Query &q, QueryResult &r) {
+    if (q.type == QueryType::CREATE_VIEW)
+        ViewManager::create(q.table, q.viewSelect, q.ifExists);
+    else if (q.type == QueryType::DROP_VIEW)
+        ViewManager::drop(q.table, q.ifExists);
+    else
+        ViewManager::refresh(q.table);
+    r.affected = 0;
+}
+
+// --- keyset pagination -------------------------------------------------------
+// A page of a single-table SELECT in (ORDER BY field, primary key) order is
+// resumed with AFTER '<cursor>' right after the previous page's last row
+// instead of skipping up to it: the key scan or the ORDER BY index walk
+// seeks to the resume point, so page N costs what page 1 does. The cursor
+// (QueryResult::next) is opaque: the hex of [field, direction, value, key]
+// of the last row.
+
+namespace {
+
+using Pos = IndexManager::Entry;   // (ORDER BY value, primary key)
+using Row = std::map<std::string,std::string>;
+
+std::string toHex(const std::string &s) {
+    static const char *d = "0123456789abcdef";
+    std::string out;
+    for (unsigned char c : s) { out.push_back(d[c >> 4]); out.push_back(d[c & 15]); }
+    return out;
+}
+
+bool fromHex(const std::string &h, std::string &out) {
+    auto nib = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    if (h.size() % 2) return false;
+    out.clear();
+    for (size_t i = 0; i < h.size(); i += 2) {
+        int a = nib(h[i]), b = nib(h[i + 1]);
+        if (a < 0 || b < 0) return false;
+        out.push_back((char)(a * 16 + b));
+    }
+    return true;
+}
+
+std::string encodeCursor(const std::string &field, bool desc, const Pos &p) {
+    json j = json::array({ field, desc ? "desc" : "asc", p.first, p.second });
+    return toHex(j.dump());
+}
+
+// false for "" (first page); throws when the cursor isn't one or comes from
+// a different ORDER BY
+bool decodeCursor(const std::string &cursor, const std::string &field, bool desc, Pos &out) {
+    if (cursor.empty()) return false;
+    std::string text;
+    json j;
+    if (!fromHex(cursor, text)
+        || !(j = json::parse(text, nullptr, false)).is_array() || j.size() != 4
+        || !j[0].is_string() || !j[1].is_string() || !j[2].is_string() || !j[3].is_string())
+        throw std::runtime_error("AFTER: invalid cursor");
+    if (j[0].get<std::string>() != field || j[1].get<std::string>() != (desc ? "desc" : "asc"))
+        throw std::runtime_error("AFTER: the cursor is from a query with a different ORDER BY");
+    out = Pos(j[2].get<std::string>(), j[3].get<std::string>());
+    return true;
+}
+
+QueryResultRow projectRow(const Query &q, Row &row) {
+    QueryResultRow o;
+    if (q.selectCols.size()==1 && q.selectCols[0]=="*") {
+        o.vals = std::move(row);
+        return o;
+    }
+    for (auto &col : q.selectCols) {
+        auto fld = col;
+        if (auto p=fld.find('.'); p!=std::string::npos)
+            fld = fld.substr(p+1);
+        o.vals[col] = row[fld];
+    }
+    return o;
+}
+
+std::string unqualified(const std::string &f) {
+    auto p = f.find('.');
+    return p == std::string::npos ? f : f.substr(p + 1);
+}
+
+// window ORDER BY: numbers compare as numbers (line 10 after line 2), the
+// rest as text
+int compareValues(const std::string &a, const std::string &b) {
+    double x, y;
+    if (Predicate::parseNumber(a, x) && Predicate::parseNumber(b, y))
+        return x < y ? -1 : (y < x ? 1 : 0);
+    return a.compare(b);
+}
+
+// rows by PARTITION BY columns, then by the OVER ORDER BY
+ExternalSorter::Less windowOrder(const WindowSpec &w) {
+    std::vector<std::string> part;
+    std::vector<std::pair<std::string,bool>> order;
+    for (auto &f : w.partitionBy) part.push_back(unqualified(f));
+    for (auto &o : w.orderBy) order.push_back({ unqualified(o.first), o.second });
+    return [part, order](const Row &a, const Row &b) {
+        static const std::string none;
+        auto get = [](const Row &r, const std::string &f) -> const std::string& {
+            auto it = r.find(f);
+            return it == r.end() ? none : it->second;
+        };
+        for (auto &f : part) {
+            int c = get(a, f).compare(get(b, f));
+            if (c) return c < 0;
+        }
+        for (auto &o : order) {
+            int c = compareValues(get(a, o.first), get(b, o.first));
+            if (c) return o.second ? c > 0 : c < 0;
+        }
+        return false;
+    };
+}
+
+// ORDER BY value and primary key of a row in the ORDER BY sorter, whether
+// or not the field is selected; no JSON field is named so
+const std::string kOrderColumn = "\x1f" "order";
+const std::string kKeyColumn   = "\x1f" "key";
+
+// (ORDER BY value, primary key), as keyset pages order rows
+ExternalSorter::Less byValueThenKey(bool desc) {
+    return [desc](const Row &a, const Row &b) {
+        static const std::string none;
+        auto get = [](const Row &r, const std::string &f) -> const std::string& {
+            auto it = r.find(f);
+            return it == r.end() ? none : it->second;
+        };
+        Pos pa(get(a, kOrderColumn), get(a, kKeyColumn)), pb(get(b, kOrderColumn), get(b, kKeyColumn));
+        return desc ? pb < pa : pa < pb;
+    };
+}
+
+} // namespace
+
+// one table, every condition on it, rows out as they are stored
+bool QueryExecutor::keysetPlain(const Query &q) {
+    if (!q.joins.empty() || !q.groupBy.empty() || q.isCount || !q.aggs.empty()
+        || !q.windows.empty())
+        return false;
+    for (auto &c : q.conditions)
+        if (c.key.find('.') != std::string::npos) return false;
+    return true;
+}
+
+void QueryExecutor::handleKeyset(const Query &q, QueryResult &r) {
+    if (!keysetPlain(q))
+        throw std::runtime_error("AFTER: only for single-table SELECTs without JOIN, GROUP BY, COUNT or SUM");
+    if (q.skip > 0)
+        throw std::runtime_error("AFTER: can't be combined with SKIP");
+    auto &mgr = DBManager::instance();
+    auto fld = q.orderByField;
+    if (auto p=fld.find('.'); p!=std::string::npos)
+        fld = fld.substr(p+1);
+    const bool desc = !fld.empty() && q.orderDesc;
+    Pos after;
+    const bool resume = q.hasAfter && decodeCursor(q.after, fld, desc, after);
+    const auto pred  = Predicate::compile(q.table, q.conditions);
+    const size_t limit = q.limit < 0 ? SIZE_MAX : (size_t)q.limit;
+    // a before b in page order
+    auto inOrder = [desc](const Pos &a, const Pos &b) { return desc ? b < a : a < b; };
+
+    std::vector<std::pair<Pos, QueryResultRow>> page;
+    // the index holds the rows with a non-empty value only: walk it just when
+    // that is every row, so rows without the field aren't left out
+    const bool indexed = !fld.empty() && IndexManager::hasIndex(q.table, fld)
+                         && (int64_t)IndexManager::size(q.table, fld) == mgr.rowCount(q.table);
+    bool walk = indexed;
+    if (indexed) {
+        // with a seekable = / LIKE condition matching m of the index's n
+        // rows, reading those m beats walking ~limit*n/m index entries to
+        // fill the page when m*m < limit*n
+        std::vector<std::string> cand;
+        if (mgr.seekKeys(q.table, pred, cand))
+            walk = limit != SIZE_MAX
+                   && (double)cand.size() * cand.size() > (double)limit * IndexManager::size(q.table, fld);
+    }
+
+    if (limit == 0) {
+    } else if (fld.empty()) {
+        // primary-key order: the scan seeks past the cursor's key
+        mgr.scanEach(q.table, pred, [&](const std::string &k, Row &row) {
+            page.push_back({ Pos(std::string(), k), projectRow(q, row) });
+            return page.size() < limit;
+        }, resume ? &after.second : nullptr);
+    } else if (walk) {
+        // ORDER BY index from the cursor on, checking each row
+        auto *h  = mgr.cf(q.table);
+        auto tok = CancellationToken::current();
+        const size_t chunk = std::min(limit, (size_t)256);
+        Pos from = after;
+        const Pos *fromp = resume ? &from : nullptr;
+        std::string val;
+        while (page.size() < limit) {
+            auto entries = IndexManager::entriesAfter(q.table, fld, desc, fromp, chunk);
+            for (auto &e : entries) {
+                if (!mgr.db()->Get(rocksdb::ReadOptions(), h, e.second, &val).ok()) continue;
+                auto row = JsonUtils::parseToMap(val);
+                // the index lags a just-committed write: skip it until it catches up
+                if (row[fld] != e.first || !pred.matches(row)) continue;
+                page.push_back({ e, projectRow(q, row) });
+                if (page.size() >= limit) break;
+            }
+            if (entries.size() < chunk) break;
+            from  = entries.back();
+            fromp = &from;
+            tok.throwIfCancelled();
+        }
+    } else {
+        // the `limit` first rows past the cursor, in a bounded heap whose top
+        // is the last of them in page order
+        using Item = std::pair<Pos, QueryResultRow>;
+        auto later = [&](const Item &a, const Item &b) { return inOrder(a.first, b.first); };
+        std::priority_queue<Item, std::vector<Item>, decltype(later)> heap(later);
+        mgr.scanEach(q.table, pred, [&](const std::string &k, Row &row) {
+            auto it = row.find(fld);
+            Pos p(it == row.end() ? std::string() : it->second, k);
+            if (resume && !inOrder(after, p)) return true;
+            if (heap.size() == limit) {
+                if (!inOrder(p, heap.top().first)) return true;
+                heap.pop();
+            }
+            heap.push({ std::move(p), projectRow(q, row) });
+            return true;
+        });
+        page.resize(heap.size());
+        for (size_t i = page.size(); i-- > 0; heap.pop()) page[i] = heap.top();
+    }
+
+    for (auto &e : page) r.rows.push_back(std::move(e.second));
+    r.affected = (int)r.rows.size();
+    if (limit != SIZE_MAX && page.size() == limit)
+        r.next = encodeCursor(fld, desc, page.back().first);
+}
+
+// --- COUNT(*) ----------------------------------------------------------------
+// COUNT(*) over one table is a single {count} row. Without WHERE it is the
+// table's row counter, with one = on an indexed field the index's count for
+// that value, both O(1). Other filters count matching rows as the (parallel)
+// scan passes them, keeping none.
+
+void QueryExecutor::handleCount(const Query &q, const Predicate &pred, QueryResult &r) {
+    auto& mgr = DBManager::instance();
+    auto &cs = pred.conditions();
+    int64_t n = -1;
+    if (cs.empty())
+        n = mgr.rowCount(q.table);
+    else if (cs.size() == 1 && cs[0].op == CmpOp::EQ && cs[0].indexable()
+             && IndexManager::hasIndex(q.table, cs[0].key))
+        n = (int64_t)IndexManager::count(q.table, cs[0].key, cs[0].text);
+
+    if (n < 0) {
+        int dop = q.parallelism > 0 ? q.parallelism
+                                    : (int)WorkerPool::defaultParallelism();
+        auto ranges = mgr.partition(q.table, (size_t)std::max(dop, 1));
+        std::vector<int64_t> parts(ranges.size(), 0);
+        mgr.scanParallel(q.table, pred, ranges,
+            [&](size_t part, const std::string&, std::map<std::string,std::string>&) {
+                ++parts[part];
+                return true;
+            });
+        n = 0;
+        for (auto c : parts) n += c;
+    }
+
+    if (q.skip == 0 && q.limit != 0) {
+        QueryResultRow o;
+        o.vals["count"] = std::to_string(n);
+        r.rows.push_back(o);
+    }
+    r.affected = (int)r.rows.size();
+}
+
+// --- window functions --------------------------------------------------------
+// The rows come out of `in` sorted by PARTITION BY, then the OVER ORDER BY,
+// so one pass evaluates every window: a running sum, a row number and the
+// last `offset` values per LAG, all reset when the partition changes. SUM
+// uses the standard RANGE frame: peers (rows with equal OVER ORDER BY values)
+// all get the sum through the last of them, so a peer group is held until
+// the next one starts. Memory is that state plus the sorter's budget. A query
+// ORDER BY then re-sorts the output; SKIP/LIMIT apply last.
+
+void QueryExecutor::handleWindow(const Query &q, ExternalSorter &in, QueryResult &r) {
+    const auto &ws = q.windows;
+    std::vector<std::string> part, peerFields;
+    for (auto &f : ws[0].partitionBy) part.push_back(unqualified(f));
+    peerFields = part;
+    for (auto &o : ws[0].orderBy) peerFields.push_back(unqualified(o.first));
+
+    bool running = false;   // a SUM, whose value waits for the end of the peer group
+    for (auto &w : ws) running = running || w.func == WindowSpec::SUM;
+    auto order = windowOrder(ws[0]);
+    Row peerOf;             // partition and OVER ORDER BY values of `peers`
+    std::vector<Row> peers;
+
+    std::vector<double> sums(ws.size(), 0.0);
+    std::vector<std::deque<std::string>> lags(ws.size());
+    int64_t rowNumber = 0;
+    std::vector<std::string> current;   // partition of the previous row
+    bool first = true;
+
+    std::unique_ptr<ExternalSorter> out;
+    if (!q.orderByField.empty())
+        out.reset(new ExternalSorter(ExternalSorter::byField(unqualified(q.orderByField), q.orderDesc)));
+    int seen = 0;
+    auto emit = [&](Row &row) {
+        if (q.limit == 0) return false;
+        if (seen++ < q.skip) return true;
+        r.rows.push_back({ std::move(row) });
+        return !(q.limit > 0 && (int)r.rows.size() >= q.limit);
+    };
+
+    bool more = true;
+    auto flush = [&]() {
+        for (auto &o : peers) {
+            for (size_t i = 0; i < ws.size(); ++i)
+                if (ws[i].func == WindowSpec::SUM) o[ws[i].alias] = std::to_string(sums[i]);
+            if (out) out->add(std::move(o));
+            else if (more) more = emit(o);
+        }
+        peers.clear();
+    };
+
+    in.finish([&](Row &row) {
+        if (!peers.empty() && order(peerOf, row)) flush();
+        if (!more) return false;
+
+        std::vector<std::string> key;
+        for (auto &f : part) key.push_back(row[f]);
+        if (first || key != current) {
+            std::fill(sums.begin(), sums.end(), 0.0);
+            for (auto &l : lags) l.clear();
+            rowNumber = 0;
+            current.swap(key);
+            first = false;
+        }
+        ++rowNumber;
+
+        std::vector<std::string> vals(ws.size());
+        for (size_t i = 0; i < ws.size(); ++i) {
+            const auto &w = ws[i];
+            if (w.func == WindowSpec::ROW_NUMBER) {
+                vals[i] = std::to_string(rowNumber);
+            } else if (w.func == WindowSpec::SUM) {
+                for (auto &t : w.terms) {
+                    double v = 0.0; try { v = std::stod(row[unqualified(t.first)]); } catch (...) { v = 0.0; }
+                    sums[i] += t.second * v;
+                }
+            } else {
+                auto &l = lags[i];
+                vals[i] = (int)l.size() >= w.offset ? l[l.size() - w.offset] : w.defaultValue;
+                l.push_back(row[unqualified(w.terms[0].first)]);
+                if ((int)l.size() > w.offset) l.pop_front();
+            }
+        }
+
+        auto o = projectRow(q, row).vals;
+        for (size_t i = 0; i < ws.size(); ++i) o[ws[i].alias] = std::move(vals[i]);
+        if (running) {
+            if (peers.empty()) {
+                peerOf.clear();
+                for (auto &f : peerFields) peerOf[f] = row[f];
+            }
+            peers.push_back(std::move(o));
+            return true;
+        }
+        if (out) { out->add(std::move(o)); return true; }
+        return emit(o);
+    });
+    flush();
+    if (out) out->finish(emit);
+    r.affected = (int)r.rows.size();
+}
+
 void QueryExecutor::handleSelect(const Query &q, QueryResult &r) {
     auto& mgr = DBManager::instance();
+    // AFTER, and first pages (LIMIT without SKIP) from db.page of plain
+    // single-table SELECTs: keyset pages, which also hand out the cursor of
+    // the next one
+    if (q.hasAfter || (q.keyset && q.limit > 0 && q.skip == 0 && keysetPlain(q))) {
+        handleKeyset(q, r);
+        return;
+    }
 	// If we can push ORDER BY into an index (no joins/group/count):
-    if (q.joins.empty() && q.groupBy.empty() && !q.isCount
-        && !q.orderByField.empty()
+    if (q.joins.empty() && q.groupBy.empty() && !q.isCount && q.aggs.empty()
+        && q.windows.empty() && !q.orderByField.empty()
         && IndexManager::hasIndex(q.table,q.orderByField)
-        && q.conditions.empty())
+        && q.conditions.empty()
+        // every row is in the index (it skips empty values)
+        && (int64_t)IndexManager::size(q.table,q.orderByField) == mgr.rowCount(q.table))
     {
-        auto &mmap = IndexManager::index[q.table][q.orderByField];
-        int seen=0, taken=0;
-        if (!q.orderDesc) {
-            for (auto it=mmap.begin(); it!=mmap.end(); ++it) {
-                if (seen++ < q.skip) continue;
-                r.rows.push_back({ { } });
-                r.rows.back().vals =
-                   mgr.get(q.table, it->second);
-                if (++taken==q.limit) break;
-            }
-        } else {
-            for (auto it=mmap.rbegin(); it!=mmap.rend(); ++it) {
-                if (seen++ < q.skip) continue;
-                r.rows.push_back({ { } });
-                r.rows.back().vals =
-                   mgr.get(q.table, it->second);
-                if (++taken==q.limit) break;
-            }
+        for (auto &k : IndexManager::orderedKeys(q.table, q.orderByField,
+                                                 q.orderDesc, q.skip, q.limit)) {
+            r.rows.push_back({ { } });
+            r.rows.back().vals = mgr.get(q.table, k);
         }
         r.affected = (int)r.rows.size();
         return;
@@ -129,38 +530,240 @@ void QueryExecutor::handleSelect(const Query &q, QueryResult &r) {
             }
         }
     }
+    auto basePred = Predicate::compile(q.table, baseConds);
+
+    if (q.isCount && q.joins.empty() && q.groupBy.empty() && postConds.empty()) {
+        handleCount(q, basePred, r);
+        return;
+    }
+
+    // GROUP BY, or aggregates over the whole result (one group)
+    bool aggregate  = !q.groupBy.empty() || !q.aggs.empty();
+
+    // window functions: the sorter orders rows for handleWindow
+    bool windowed   = !q.windows.empty();
+    if (windowed) {
+        if (aggregate || q.isCount)
+            throw std::runtime_error("window functions can't be combined with GROUP BY, COUNT or aggregates");
+        for (auto &w : q.windows)
+            if (w.partitionBy != q.windows[0].partitionBy || w.orderBy != q.windows[0].orderBy)
+                throw std::runtime_error("window functions in one SELECT must share one OVER (...)");
+    }
+
+    // ORDER BY without GROUP BY goes through the external sorter, which
+    // applies SKIP/LIMIT while merging. SKIP/LIMIT can only be pushed into
+    // the scan when nothing downstream reorders, multiplies or drops rows.
+    bool sorted     = (!q.orderByField.empty() || windowed) && !aggregate;
+    bool pushPaging = q.joins.empty() && postConds.empty()
+                      && !aggregate && !q.isCount && !sorted;
+
+    bool wild = (q.selectCols.size()==1 && q.selectCols[0]=="*");
+    auto project = [&](std::map<std::string,std::string> &r0) {
+        QueryResultRow o;
+        if (wild) {
+            o.vals = std::move(r0);
+        } else {
+            for (auto &col:q.selectCols) {
+                auto fld = col;
+                if (auto p=fld.find('.'); p!=std::string::npos)
+                    fld = fld.substr(p+1);
+                o.vals[col] = r0[fld];
+            }
+        }
+        return o;
+    };
+
+    // Single-table rows carry their ORDER BY value and primary key through
+    // the sorter, so ties come out in (value, key) order in the ORDER BY
+    // direction, as keyset pages and the ORDER BY index give them.
+    bool keyed = sorted && !windowed && q.joins.empty() && postConds.empty();
+    const std::string orderField = unqualified(q.orderByField);
+    std::unique_ptr<ExternalSorter> sorter;
+    if (windowed) {
+        sorter.reset(new ExternalSorter(windowOrder(q.windows[0])));
+    } else if (keyed) {
+        sorter.reset(new ExternalSorter(byValueThenKey(q.orderDesc)));
+    } else if (sorted) {
+        sorter.reset(new ExternalSorter(ExternalSorter::byField(unqualified(q.orderByField), q.orderDesc)));
+    }
+    auto emitSorted = [&]() {
+        if (windowed) { handleWindow(q, *sorter, r); return; }
+        int seen = 0;
+        sorter->finish([&](ExternalSorter::Row &row) {
+            if (q.limit == 0) return false;
+            if (seen++ < q.skip) return true;
+            if (keyed) { row.erase(kOrderColumn); row.erase(kKeyColumn); }
+            r.rows.push_back({ std::move(row) });
+            return !(q.limit > 0 && (int)r.rows.size() >= q.limit);
+        });
+        r.affected = (int)r.rows.size();
+    };
+
+    // Single-table ORDER BY (or window): stream straight from the scan into
+    // the sorter, so the unsorted result is never held in memory.
+    if (sorted && q.joins.empty() && postConds.empty()) {
+        mgr.scanEach(q.table, basePred,
+            [&](const std::string &k, std::map<std::string,std::string> &row) {
+                if (windowed) { sorter->add(std::move(row)); return true; }
+                auto it = row.find(orderField);
+                std::string v = it == row.end() ? std::string() : it->second;
+                auto o = project(row).vals;
+                o[kOrderColumn] = std::move(v);
+                o[kKeyColumn] = k;
+                sorter->add(std::move(o));
+                return true;
+            });
+        emitSorted();
+        return;
+    }
+
+    // GROUP BY state: per-group SUMs and sketches (approximate aggregates)
+    // when aggregates are requested, row counts otherwise. Without GROUP BY
+    // everything is one group, "". Parallel scan parts each fill their own
+    // and are merged afterwards.
+    std::string gb = q.groupBy;
+    if (auto p=gb.find('.'); p!=std::string::npos)
+        gb = gb.substr(p+1);
+    struct GroupAcc {
+        std::map<std::string, std::unordered_map<std::string,double>> sums;
+        std::map<std::string, std::unordered_map<std::string,HyperLogLog>> distinct;
+        std::map<std::string, std::unordered_map<std::string,TDigest>> digests;
+        std::map<std::string,int> counts;
+    };
+    // Only a view's _sketch_ columns hold stored sketches; in any other column
+    // "hll1:..." or "tdigest1:..." is just data
+    bool viewSource = ViewManager::isView(q.table);
+    for (auto &j : q.joins)
+        viewSource = viewSource || ViewManager::isView(j.rightTable);
+    auto storedSketch = [&](const std::string &fld) {
+        return viewSource && fld.rfind("_sketch_", 0) == 0;
+    };
+    auto accumulate = [&](GroupAcc &acc, std::map<std::string,std::string> &r0) {
+        std::string key = gb.empty() ? std::string() : r0[gb];
+        if (q.aggs.empty()) { acc.counts[key]++; return; }
+        auto &sums = acc.sums[key];
+        for (auto &a : q.aggs) {
+            // Support qualified names in aggregates (e.g., l.debit)
+            auto fld = a.field;
+            if (auto p=fld.find('.'); p!=std::string::npos) fld = fld.substr(p+1);
+            auto name = a.alias.empty()? a.field : a.alias;
+            static const std::string none;
+            auto it = r0.find(fld);
+            const std::string &val = it == r0.end() ? none : it->second;
+            if (a.type == AggSpec::APPROX_COUNT_DISTINCT) {
+                // missing / empty values aren't counted; a stored sketch
+                // (a view's _sketch_ column) is merged
+                if (val.empty()) continue;
+                auto &h = acc.distinct[key][name];
+                if (storedSketch(fld) && HyperLogLog::isSerialized(val)) h.merge(HyperLogLog::parse(val));
+                else h.add(val);
+            } else if (a.type == AggSpec::APPROX_PERCENTILE) {
+                auto &d = acc.digests[key][name];
+                double x;
+                if (storedSketch(fld) && TDigest::isSerialized(val)) d.merge(TDigest::parse(val));
+                else if (Predicate::parseNumber(val, x)) d.add(x);
+            } else {
+                double v = 0.0; try { v = std::stod(val); } catch (...) { v = 0.0; }
+                sums[name] += v;
+            }
+        }
+    };
+    auto mergeAcc = [](GroupAcc &dst, GroupAcc &src) {
+        for (auto &g : src.sums) {
+            auto &d = dst.sums[g.first];
+            for (auto &s : g.second) d[s.first] += s.second;
+        }
+        for (auto &g : src.distinct)
+            for (auto &h : g.second) dst.distinct[g.first][h.first].merge(h.second);
+        for (auto &g : src.digests)
+            for (auto &t : g.second) dst.digests[g.first][t.first].merge(t.second);
+        for (auto &c : src.counts) dst.counts[c.first] += c.second;
+    };
+    GroupAcc groups;
+    bool grouped = false;   // base rows already folded into `groups`
+
+    // Full scans (no early stop on SKIP/LIMIT) are split into key ranges
+    // and run on the worker pool. Ungrouped single-table ORDER BY keeps
+    // streaming into the sorter above instead.
+    int dop = q.parallelism > 0 ? q.parallelism
+                                : (int)WorkerPool::defaultParallelism();
+    bool earlyStop = pushPaging && (q.skip > 0 || q.limit >= 0);
+    std::vector<DBManager::KeyRange> ranges;
+    if (dop > 1 && !earlyStop)
+        ranges = mgr.partition(q.table, (size_t)dop);
+
     // Scan base table with only base conditions
-    auto keys = mgr.scan(q.table, baseConds, q.skip, q.limit);
     // 1) fetch rows
     std::vector<std::map<std::string,std::string>> rows;
-    rows.reserve(keys.size());
-    for (auto &k:keys)
-        rows.push_back(mgr.get(q.table,k));
+    if (ranges.size() > 1 && aggregate && q.joins.empty() && postConds.empty()) {
+        // partial aggregates per range, combined in range order
+        std::vector<GroupAcc> parts(ranges.size());
+        mgr.scanParallel(q.table, basePred, ranges,
+            [&](size_t part, const std::string&, std::map<std::string,std::string> &row) {
+                accumulate(parts[part], row);
+                return true;
+            });
+        for (auto &pa : parts) mergeAcc(groups, pa);
+        grouped = true;
+    } else if (ranges.size() > 1) {
+        // per-range buffers, concatenated so rows stay in key order
+        std::vector<decltype(rows)> parts(ranges.size());
+        mgr.scanParallel(q.table, basePred, ranges,
+            [&](size_t part, const std::string&, std::map<std::string,std::string> &row) {
+                parts[part].push_back(std::move(row));
+                return true;
+            });
+        for (auto &pa : parts)
+            std::move(pa.begin(), pa.end(), std::back_inserter(rows));
+    } else {
+        int seen = 0;
+        mgr.scanEach(q.table, basePred,
+            [&](const std::string&, std::map<std::string,std::string> &row) {
+                if (pushPaging && seen++ < q.skip) return true;
+                rows.push_back(std::move(row));
+                return !(pushPaging && q.limit > 0 && (int)rows.size() >= q.limit);
+            });
+    }
 
     // 2) JOINs
     for (auto &j:q.joins) {
+        bool indexed = IndexManager::hasIndex(j.rightTable,j.rightField);
+
+        // Without an index, build a hash table over the right table once
+        // (partitioned scan on the worker pool) instead of rescanning it
+        // for every left row. Matches keep right-table key order.
+        std::vector<std::map<std::string,std::string>> build;
+        std::unordered_map<std::string, std::vector<size_t>> hash;
+        if (!indexed && !rows.empty()) {
+            auto ranges = mgr.partition(j.rightTable, (size_t)std::max(dop, 1));
+            std::vector<decltype(build)> parts(ranges.size());
+            mgr.scanParallel(j.rightTable, Predicate(), ranges,
+                [&](size_t part, const std::string&, std::map<std::string,std::string> &rd) {
+                    parts[part].push_back(std::move(rd));
+                    return true;
+                });
+            for (auto &pa : parts)
+                std::move(pa.begin(), pa.end(), std::back_inserter(build));
+            for (size_t i = 0; i < build.size(); ++i)
+                hash[build[i][j.rightField]].push_back(i);
+        }
+
         std::vector<std::map<std::string,std::string>> merged;
         for (auto &row:rows) {
             auto lval = row.count(j.leftField) ? row.at(j.leftField) : std::string();
             bool matched = false;
-            if (IndexManager::hasIndex(j.rightTable,j.rightField)) {
-                auto &mm = IndexManager::index[j.rightTable][j.rightField];
-                auto range = mm.equal_range(lval);
-                for (auto it=range.first; it!=range.second; ++it) {
-                    auto rd = mgr.get(j.rightTable,it->second);
+            if (indexed) {
+                for (auto &rk : IndexManager::lookup(j.rightTable, j.rightField, lval)) {
+                    auto rd = mgr.get(j.rightTable,rk);
                     auto mrow = row; mrow.insert(rd.begin(),rd.end());
                     merged.push_back(mrow);
                     matched = true;
                 }
-            } else {
-                auto all = mgr.scan(j.rightTable,{},0,-1);
-                for (auto &rk:all) {
-                    auto rd = mgr.get(j.rightTable,rk);
-                    if (rd[j.rightField]==lval) {
-                        auto mrow=row; mrow.insert(rd.begin(),rd.end());
-                        merged.push_back(mrow);
-                        matched = true;
-                    }
+            } else if (auto hit = hash.find(lval); hit != hash.end()) {
+                for (size_t i : hit->second) {
+                    auto mrow=row; mrow.insert(build[i].begin(),build[i].end());
+                    merged.push_back(mrow);
+                    matched = true;
                 }
             }
             if (!matched && j.type==Join::LEFT) {
@@ -173,49 +776,36 @@ void QueryExecutor::handleSelect(const Query &q, QueryResult &r) {
 
     // 3) reapply WHERE (for joins and any qualified conditions)
     if (!postConds.empty()) {
+        auto post = Predicate::compile(q.table, postConds);
         std::vector<decltype(rows)::value_type> filt;
         for (auto &row:rows) {
-            bool ok=true;
-            for (auto &c:postConds) {
-                auto key = c.key;
-                if (auto p=key.find('.'); p!=std::string::npos)
-                    key = key.substr(p+1);
-                if (!evalCond(row[key], c.op, c.value)) {
-                    ok=false; break;
-                }
-            }
-            if (ok) filt.push_back(row);
+            if (post.matches(row)) filt.push_back(std::move(row));
         }
         rows.swap(filt);
     }
 
     // 4) GROUP BY with aggregates or COUNT or projection
-    if (!q.groupBy.empty()) {
-        auto gb = q.groupBy;
-        if (auto p=gb.find('.'); p!=std::string::npos)
-            gb = gb.substr(p+1);
+    if (aggregate) {
+        if (!grouped)
+            for (auto &r0:rows) accumulate(groups, r0);
+        // aggregates without GROUP BY give one row, even over no rows
+        if (q.groupBy.empty()) groups.sums[""];
 
-        // If SUM aggregates are requested, compute them per group
+        // If aggregates are requested, compute them per group
         if (!q.aggs.empty()) {
-            struct AggAcc { std::unordered_map<std::string,double> sums; };
-            std::map<std::string, AggAcc> accs;
-            for (auto &r0:rows) {
-                std::string key = r0[gb];
-                auto &acc = accs[key];
-                for (auto &a : q.aggs) {
-                    // Support qualified names in aggregates (e.g., l.debit)
-                    auto fld = a.field;
-                    if (auto p=fld.find('.'); p!=std::string::npos) fld = fld.substr(p+1);
-                    double v = 0.0; try { v = std::stod(r0.count(fld)? r0.at(fld) : std::string()); } catch (...) { v = 0.0; }
-                    acc.sums[a.alias.empty()? a.field : a.alias] += v;
-                }
-            }
-            for (auto &kv : accs) {
+            for (auto &kv : groups.sums) {
                 QueryResultRow o;
-                o.vals[gb] = kv.first;
-                for (auto &s : kv.second.sums) {
+                if (!gb.empty()) o.vals[gb] = kv.first;
+                for (auto &s : kv.second) {
                     o.vals[s.first] = std::to_string(s.second);
                 }
+                for (auto &a : q.aggs) {
+                    auto name = a.alias.empty()? a.field : a.alias;
+                    if (a.type == AggSpec::APPROX_COUNT_DISTINCT)
+                        o.vals[name] = std::to_string(std::llround(groups.distinct[kv.first][name].estimate()));
+                    else if (a.type == AggSpec::APPROX_PERCENTILE)
+                        o.vals[name] = std::to_string(groups.digests[kv.first][name].quantile(a.param));
+                }
                 r.rows.push_back(o);
             }
             if (!q.orderByField.empty()) {
@@ -229,9 +819,7 @@ void QueryExecutor::handleSelect(const Query &q, QueryResult &r) {
                 });
             }
         } else {
-            std::map<std::string,int> grp;
-            for (auto &r0:rows) grp[r0[gb]]++;
-            for (auto &p:grp) {
+            for (auto &p:groups.counts) {
                 QueryResultRow o;
                 o.vals[gb] = p.first;
                 o.vals["count"] = std::to_string(p.second);
@@ -240,25 +828,24 @@ void QueryExecutor::handleSelect(const Query &q, QueryResult &r) {
         }
     }
 
+    else if (q.isCount) {
+        QueryResultRow o;
+        o.vals["count"] = std::to_string(rows.size());
+        r.rows.push_back(o);
+    }
+    else if (sorted) {
+        for (auto &r0:rows)
+            sorter->add(windowed ? std::move(r0) : project(r0).vals);
+        rows.clear();
+        emitSorted();
+        return;
+    }
     else {
-        bool wild = (q.selectCols.size()==1 && q.selectCols[0]=="*");
-        for (auto &r0:rows) {
-            QueryResultRow o;
-            if (wild) {
-                for (auto &kv:r0) o.vals[kv.first]=kv.second;
-            } else {
-                for (auto &col:q.selectCols) {
-                    auto fld = col;
-                    if (auto p=fld.find('.'); p!=std::string::npos)
-                        fld = fld.substr(p+1);
-                    o.vals[col] = r0[fld];
-                }
-            }
-            r.rows.push_back(o);
-        }
+        for (auto &r0:rows)
+            r.rows.push_back(project(r0));
     }
 
-    // 5) ORDER BY (if not optimized above)
+    // 5) ORDER BY of grouped rows (ungrouped ORDER BY was sorted above)
     if (!q.orderByField.empty()) {
         auto fld=q.orderByField;
         if (auto p=fld.find('.'); p!=std::string::npos)
@@ -272,7 +859,7 @@ void QueryExecutor::handleSelect(const Query &q, QueryResult &r) {
     }
 
     // 6) SKIP/LIMIT if not already applied
-    if (!q.joins.empty() || !q.groupBy.empty() || q.isCount) {
+    if (!pushPaging) {
         auto &v = r.rows;
         int start = std::min((int)v.size(), q.skip);
         int end   = (q.limit>=0)
@@ -22,9 +22,7 @@
 #include <v8.h>
 #include <json.hpp>
 
-// Externs from main.cpp to hot-load modules into V8
-extern v8::Isolate* g_isolate;
-extern v8::Persistent<v8::Context> persistent_ctx;
+#include "IsolatePool.h"
 
 namespace fs = std::filesystem;
 
@@ -277,30 +275,35 @@ static std::string genStyleCss() {
            "button{margin:4px;padding:6px 10px;border-radius:6px;border:1px solid #bbb;background:#f1f1f1;cursor:pointer}";
 }
 
+// Every isolate has its own require() cache, so the module is loaded into
+// each of them in turn
 static void hotLoadModuleIntoV8(const std::string& slug) {
-    if (!g_isolate) return;
-    v8::Locker locker(g_isolate);
-    v8::Isolate::Scope iscope(g_isolate);
-    v8::HandleScope hs(g_isolate);
-    auto ctx = persistent_ctx.Get(g_isolate);
-    v8::Context::Scope cs(ctx);
-
-    v8::Local<v8::Value> require_val;
-    if (!ctx->Global()->Get(ctx, v8::String::NewFromUtf8(g_isolate, "require", v8::NewStringType::kNormal).ToLocalChecked()).ToLocal(&require_val)
-        || !require_val->IsFunction()) {
-        std::cerr << "[Watcher] require() not available in V8 context\n";
-        return;
-    }
-    auto requireFn = require_val.As<v8::Function>();
-    v8::Local<v8::Value> argv[] = { v8::String::NewFromUtf8(g_isolate, slug.c_str(), v8::NewStringType::kNormal).ToLocalChecked() };
-    v8::TryCatch tc(g_isolate);
-    (void)requireFn->Call(ctx, ctx->Global(), 1, argv);
-    if (tc.HasCaught()) {
-        v8::String::Utf8Value err(g_isolate, tc.Exception());
-        std::cerr << "[Watcher] Error requiring module '" << slug << "': " << (*err?*err:"unknown") << "\n";
-    } else {
-        std::cout << "[Watcher] Loaded module '" << slug << "' into V8" << std::endl;
-    }
+    if (!IsolatePool::instance().ready()) return;
+    IsolatePool::instance().forEach([&](IsolatePool::Slot& slot) {
+        v8::Isolate* iso = slot.isolate;
+        v8::Locker locker(iso);
+        v8::Isolate::Scope iscope(iso);
+        v8::HandleScope hs(iso);
+        auto ctx = slot.context.Get(iso);
+        v8::Context::Scope cs(ctx);
+
+        v8::Local<v8::Value> require_val;
+        if (!ctx->Global()->Get(ctx, v8::String::NewFromUtf8(iso, "require", v8::NewStringType::kNormal).ToLocalChecked()).ToLocal(&require_val)
+            || !require_val->IsFunction()) {
+            std::cerr << "[Watcher] require() not available in V8 context\n";
+            return;
+        }
+        auto requireFn = require_val.As<v8::Function>();
+        v8::Local<v8::Value> argv[] = { v8::String::NewFromUtf8(iso, slug.c_str(), v8::NewStringType::kNormal).ToLocalChecked() };
+        v8::TryCatch tc(iso);
+        (void)requireFn->Call(ctx, ctx->Global(), 1, argv);
+        if (tc.HasCaught()) {
+            v8::String::Utf8Value err(iso, tc.Exception());
+            std::cerr << "[Watcher] Error requiring module '" << slug << "' (isolate " << slot.index << "): " << (*err?*err:"unknown") << "\n";
+        } else if (slot.index == 0) {
+            std::cout << "[Watcher] Loaded module '" << slug << "' into V8" << std::endl;
+        }
+    });
 }
 
 static void generateFromMd(const fs::path& mdPath) {
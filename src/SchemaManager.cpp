@@ -24,6 +24,22 @@ void SchemaManager::loadFromFile(const std::string& path) {
     for (auto it = root.begin(); it != root.end(); ++it) {
         const std::string tableName = it->key();
         const rvalue& tblObj = *it;
+
+        // "tables": { "<name>": { "schema": { col: type, ... } } }
+        if (tableName == "tables" && tblObj.t() == crow::json::type::Object) {
+            for (auto tit = tblObj.begin(); tit != tblObj.end(); ++tit) {
+                if (tit->t() != crow::json::type::Object || !tit->has("schema")) continue;
+                const rvalue& cols = (*tit)["schema"];
+                if (cols.t() != crow::json::type::Object) continue;
+                auto& ts = schemas_[tit->key()];
+                for (auto cit = cols.begin(); cit != cols.end(); ++cit) {
+                    if (cit->t() == crow::json::type::String)
+                        ts.columnTypes[cit->key()] = std::string(cit->s());
+                }
+            }
+            continue;
+        }
+
         if (!tblObj.has("indexedFields")) continue;
 
         const rvalue& idx = tblObj["indexedFields"];
@@ -42,7 +58,7 @@ void SchemaManager::loadFromFile(const std::string& path) {
             ts.indexedFields[fieldName] = std::string(typeVal.s());
         }
 
-        schemas_.emplace(tableName, std::move(ts));
+        schemas_[tableName].indexedFields = std::move(ts.indexedFields);
     }
 }
 
@@ -60,3 +76,10 @@ const TableSchema& SchemaManager::getSchema(const std::string& table) {
     return it->second;
 }
 
+
+std::string SchemaManager::columnType(const std::string& table, const std::string& column) {
+    auto it = schemas_.find(table);
+    if (it == schemas_.end()) return "";
+    auto ct = it->second.columnTypes.find(column);
+    return ct == it->second.columnTypes.end() ? std::string() : ct->second;
+}
@@ -0,0 +1,127 @@
+// ScriptCache.cpp
+#include "ScriptCache.h"
+#include "CryptoUtils.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+static std::mutex  g_mu;
+static std::string g_dir = ".v8cache";
+static bool        g_enabled = true;
+static std::unordered_map<std::string, std::string> g_mem;   // key -> cache bytes
+
+void ScriptCache::setDirectory(const std::string& dir) {
+    std::lock_guard<std::mutex> lk(g_mu);
+    g_dir = dir;
+}
+
+void ScriptCache::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lk(g_mu);
+    g_enabled = enabled;
+}
+
+static std::string cacheKey(const std::string& source) {
+    // V8 version (incl. its NUL) then the source, as one SHA-256
+    std::string data = v8::V8::GetVersion();
+    data.push_back('\0');
+    data += source;
+    return CppSha256(data);
+}
+
+// cached bytes for key (memory, then disk); empty if none
+static std::string lookup(const std::string& key, const fs::path& file) {
+    {
+        std::lock_guard<std::mutex> lk(g_mu);
+        auto it = g_mem.find(key);
+        if (it != g_mem.end()) return it->second;
+    }
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return std::string();
+    std::string bytes{ std::istreambuf_iterator<char>(in), {} };
+    if (!bytes.empty()) {
+        std::lock_guard<std::mutex> lk(g_mu);
+        g_mem.emplace(key, bytes);
+    }
+    return bytes;
+}
+
+static void store(const std::string& key, const fs::path& file, std::string bytes) {
+    std::error_code ec;
+    fs::create_directories(file.parent_path(), ec);
+    // unique temp name + rename: concurrent writers of one key never
+    // interleave, and readers never see a partial file
+    std::ostringstream tmpName;
+    tmpName << file.string() << ".tmp" << std::this_thread::get_id();
+    const fs::path tmp = tmpName.str();
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), (std::streamsize)bytes.size());
+        if (!out) {
+            std::cerr << "[ScriptCache] cannot write " << tmp.string() << std::endl;
+            fs::remove(tmp, ec);
+            return;
+        }
+    }
+    fs::rename(tmp, file, ec);
+    if (ec) fs::remove(tmp, ec);
+    std::lock_guard<std::mutex> lk(g_mu);
+    g_mem[key] = std::move(bytes);
+}
+
+v8::MaybeLocal<v8::Script> ScriptCache::compile(v8::Local<v8::Context> ctx,
+                                                const std::string& source) {
+    v8::Isolate* iso = ctx->GetIsolate();
+    v8::Local<v8::String> code;
+    if (!v8::String::NewFromUtf8(iso, source.c_str(), v8::NewStringType::kNormal,
+                                 (int)source.size()).ToLocal(&code))
+        return v8::MaybeLocal<v8::Script>();
+
+    bool enabled;
+    fs::path dir;
+    {
+        std::lock_guard<std::mutex> lk(g_mu);
+        enabled = g_enabled;
+        dir = g_dir;
+    }
+    if (!enabled) return v8::Script::Compile(ctx, code);
+
+    const std::string key = cacheKey(source);
+    const fs::path file = dir / (key + ".bin");
+
+    std::string bytes = lookup(key, file);
+    if (!bytes.empty()) {
+        // Source takes ownership of the CachedData; the buffer stays ours
+        auto* cached = new v8::ScriptCompiler::CachedData(
+            reinterpret_cast<const uint8_t*>(bytes.data()), (int)bytes.size());
+        v8::ScriptCompiler::Source src(code, cached);
+        v8::MaybeLocal<v8::Script> script =
+            v8::ScriptCompiler::Compile(ctx, &src, v8::ScriptCompiler::kConsumeCodeCache);
+        if (!src.GetCachedData()->rejected) return script;
+        // wrong V8 flags/build, or a damaged file: drop it and rebuild below
+        std::cerr << "[ScriptCache] cache rejected, recompiling " << key << std::endl;
+        std::lock_guard<std::mutex> lk(g_mu);
+        g_mem.erase(key);
+    }
+
+    // eager compile so the cache covers every function, not only the
+    // top-level code
+    v8::ScriptCompiler::Source src(code);
+    v8::Local<v8::Script> script;
+    if (!v8::ScriptCompiler::Compile(ctx, &src, v8::ScriptCompiler::kEagerCompile).ToLocal(&script))
+        return v8::MaybeLocal<v8::Script>();
+
+    std::unique_ptr<v8::ScriptCompiler::CachedData> data(
+        v8::ScriptCompiler::CreateCodeCache(script->GetUnboundScript()));
+    if (data && data->length > 0)
+        store(key, file, std::string(reinterpret_cast<const char*>(data->data), (size_t)data->length));
+    return script;
+}
@@ -0,0 +1,244 @@
+// Sketch.cpp
+#include "Sketch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+static const char* kHllTag    = "hll1:";
+static const char* kDigestTag = "tdigest1:";
+
+static bool hasTag(const std::string &s, const char *tag) {
+    return s.compare(0, std::char_traits<char>::length(tag), tag) == 0;
+}
+
+static const char* kHex = "0123456789abcdef";
+
+static int hexVal(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    throw std::runtime_error("sketch: bad hex digit");
+}
+
+static unsigned readHex(const std::string &s, size_t at, size_t digits) {
+    if (at + digits > s.size()) throw std::runtime_error("sketch: truncated");
+    unsigned v = 0;
+    for (size_t i = 0; i < digits; ++i) v = (v << 4) | (unsigned)hexVal(s[at + i]);
+    return v;
+}
+
+// --- HyperLogLog -------------------------------------------------------------
+
+// stable 64-bit hash: FNV-1a, then the splitmix64 finalizer to spread the
+// low-entropy FNV output over all bits
+static uint64_t hash64(const std::string &s) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : s) { h ^= c; h *= 1099511628211ULL; }
+    h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+void HyperLogLog::add(const std::string &value) {
+    if (_reg.empty()) _reg.assign(kRegisters, 0);
+    uint64_t h   = hash64(value);
+    size_t   idx = (size_t)(h >> (64 - kPrecision));
+    uint64_t w   = h << kPrecision;
+    uint8_t  rank = 1;
+    while (rank <= 64 - kPrecision && !(w & (1ULL << 63))) { ++rank; w <<= 1; }
+    if (rank > _reg[idx]) _reg[idx] = rank;
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+    if (other._reg.empty()) return;
+    if (_reg.empty()) { _reg = other._reg; return; }
+    for (size_t i = 0; i < kRegisters; ++i)
+        _reg[i] = std::max(_reg[i], other._reg[i]);
+}
+
+double HyperLogLog::estimate() const {
+    if (_reg.empty()) return 0.0;
+    const double m = (double)kRegisters;
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t r : _reg) {
+        sum += std::ldexp(1.0, -r);
+        if (r == 0) ++zeros;
+    }
+    double e = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+    // small cardinalities: linear counting over the empty registers
+    if (e <= 2.5 * m && zeros > 0) e = m * std::log(m / (double)zeros);
+    return e;
+}
+
+std::string HyperLogLog::serialize() const {
+    std::string out = kHllTag;
+    size_t used = 0;
+    for (uint8_t r : _reg) if (r) ++used;
+    if (used * 5 < kRegisters * 2) {
+        // sparse: 3 hex digits of index, 2 of rank per used register
+        out += 's';
+        for (size_t i = 0; i < _reg.size(); ++i) {
+            if (!_reg[i]) continue;
+            out += kHex[(i >> 8) & 0xf]; out += kHex[(i >> 4) & 0xf]; out += kHex[i & 0xf];
+            out += kHex[_reg[i] >> 4];   out += kHex[_reg[i] & 0xf];
+        }
+    } else {
+        out += 'd';
+        for (uint8_t r : _reg) { out += kHex[r >> 4]; out += kHex[r & 0xf]; }
+    }
+    return out;
+}
+
+bool HyperLogLog::isSerialized(const std::string &s) { return hasTag(s, kHllTag); }
+
+HyperLogLog HyperLogLog::parse(const std::string &s) {
+    HyperLogLog h;
+    size_t at = std::char_traits<char>::length(kHllTag);
+    if (!isSerialized(s) || s.size() <= at) throw std::runtime_error("sketch: not a HyperLogLog");
+    char form = s[at++];
+    h._reg.assign(kRegisters, 0);
+    if (form == 's') {
+        for (; at < s.size(); at += 5)
+            h._reg[readHex(s, at, 3)] = (uint8_t)readHex(s, at + 3, 2);
+    } else if (form == 'd') {
+        if (s.size() - at != kRegisters * 2) throw std::runtime_error("sketch: truncated");
+        for (size_t i = 0; i < kRegisters; ++i) h._reg[i] = (uint8_t)readHex(s, at + 2 * i, 2);
+    } else {
+        throw std::runtime_error("sketch: not a HyperLogLog");
+    }
+    return h;
+}
+
+// --- TDigest -----------------------------------------------------------------
+
+void TDigest::add(double x, double weight) {
+    if (!(weight > 0.0) || std::isnan(x)) return;
+    if (empty()) { _min = _max = x; }
+    else { _min = std::min(_min, x); _max = std::max(_max, x); }
+    _buffer.push_back({ x, weight });
+    _bufWeight += weight;
+    if (_buffer.size() >= (size_t)(_compression * 5)) compress();
+}
+
+void TDigest::merge(const TDigest &other) {
+    if (other.empty()) return;
+    other.compress();
+    if (empty()) { _min = other._min; _max = other._max; }
+    else { _min = std::min(_min, other._min); _max = std::max(_max, other._max); }
+    for (auto &c : other._centroids) {
+        _buffer.push_back(c);
+        _bufWeight += c.weight;
+    }
+    if (_buffer.size() >= (size_t)(_compression * 5)) compress();
+}
+
+// fold the buffer in: sort everything by mean, then merge neighbours while
+// a centroid stays under 4·W·q(1-q)/compression, so centroids are small
+// near q = 0 and q = 1 and the extreme quantiles stay accurate
+void TDigest::compress() const {
+    if (_buffer.empty()) return;
+    std::vector<Centroid> all;
+    all.reserve(_centroids.size() + _buffer.size());
+    all.insert(all.end(), _centroids.begin(), _centroids.end());
+    all.insert(all.end(), _buffer.begin(), _buffer.end());
+    std::sort(all.begin(), all.end(),
+              [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; });
+    _total += _bufWeight;
+    _buffer.clear();
+    _bufWeight = 0.0;
+
+    std::vector<Centroid> out;
+    out.reserve((size_t)(_compression * 2));
+    double done = 0.0;   // weight of the centroids before out.back()
+    for (auto &c : all) {
+        if (out.empty()) { out.push_back(c); continue; }
+        Centroid &cur = out.back();
+        double proposed = cur.weight + c.weight;
+        double q0 = done / _total;
+        double q1 = (done + proposed) / _total;
+        double bound = 4.0 * _total * std::min(q0 * (1 - q0), q1 * (1 - q1)) / _compression;
+        if (proposed <= bound) {
+            cur.mean  += (c.mean - cur.mean) * c.weight / proposed;
+            cur.weight = proposed;
+        } else {
+            done += cur.weight;
+            out.push_back(c);
+        }
+    }
+    _centroids.swap(out);
+}
+
+double TDigest::quantile(double q) const {
+    compress();
+    if (_centroids.empty()) return 0.0;
+    if (q <= 0.0) return _min;
+    if (q >= 1.0) return _max;
+    if (_centroids.size() == 1) return _centroids[0].mean;
+
+    // each centroid's mean sits at the middle of its weight; interpolate
+    // between neighbouring middles (and the min / max at the ends)
+    double target = q * _total;
+    double cum = 0.0;
+    for (size_t i = 0; i < _centroids.size(); ++i) {
+        const Centroid &c = _centroids[i];
+        double mid = cum + c.weight / 2.0;
+        if (target < mid) {
+            if (i == 0) {
+                double t = c.weight > 0 ? target / mid : 0.0;
+                return _min + (c.mean - _min) * t;
+            }
+            const Centroid &p = _centroids[i - 1];
+            double pmid = cum - p.weight / 2.0;
+            double t = (target - pmid) / (mid - pmid);
+            return p.mean + (c.mean - p.mean) * t;
+        }
+        cum += c.weight;
+    }
+    const Centroid &last = _centroids.back();
+    double lmid = _total - last.weight / 2.0;
+    double t = (target - lmid) / (_total - lmid);
+    return last.mean + (_max - last.mean) * std::min(1.0, std::max(0.0, t));
+}
+
+std::string TDigest::serialize() const {
+    compress();
+    std::string out = kDigestTag;
+    char buf[64];
+    std::snprintf(buf, sizeof buf, "%.17g,%.17g", _min, _max);
+    out += buf;
+    for (auto &c : _centroids) {
+        std::snprintf(buf, sizeof buf, ";%.10g:%.10g", c.mean, c.weight);
+        out += buf;
+    }
+    return out;
+}
+
+bool TDigest::isSerialized(const std::string &s) { return hasTag(s, kDigestTag); }
+
+TDigest TDigest::parse(const std::string &s) {
+    if (!isSerialized(s)) throw std::runtime_error("sketch: not a t-digest");
+    TDigest d;
+    const char *p = s.c_str() + std::char_traits<char>::length(kDigestTag);
+    char *end = nullptr;
+    d._min = std::strtod(p, &end);
+    if (end == p || *end != ',') throw std::runtime_error("sketch: malformed t-digest");
+    p = end + 1;
+    d._max = std::strtod(p, &end);
+    if (end == p) throw std::runtime_error("sketch: malformed t-digest");
+    p = end;
+    while (*p == ';') {
+        Centroid c;
+        c.mean = std::strtod(p + 1, &end);
+        if (*end != ':') throw std::runtime_error("sketch: malformed t-digest");
+        c.weight = std::strtod(end + 1, &end);
+        if (!(c.weight > 0.0)) throw std::runtime_error("sketch: malformed t-digest");
+        d._centroids.push_back(c);
+        d._total += c.weight;
+        p = end;
+    }
+    if (*p) throw std::runtime_error("sketch: malformed t-digest");
+    return d;
+}
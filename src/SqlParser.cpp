@@ -23,10 +23,17 @@ static const std::regex delete_re(
   R"(^DELETE\s+FROM\s+(\w+)(?:\s+WHERE\s+(.+))?$)", std::regex::icase);
 static const std::regex batch_re(
   R"(^BATCH\s+(\w+)\s*(\{.+\})$)", std::regex::icase);
+static const std::regex create_view_re(
+  R"(^CREATE\s+MATERIALIZED\s+VIEW\s+(IF\s+NOT\s+EXISTS\s+)?(\w+)\s+AS\s+(SELECT\s+.+)$)",
+  std::regex::icase);
+static const std::regex drop_view_re(
+  R"(^DROP\s+MATERIALIZED\s+VIEW\s+(IF\s+EXISTS\s+)?(\w+)$)", std::regex::icase);
+static const std::regex refresh_view_re(
+  R"(^REFRESH\s+MATERIALIZED\s+VIEW\s+(\w+)$)", std::regex::icase);
 static const std::regex select_re(
   R"(^SELECT\s+(.+?)\s+FROM\s+(\w+)(?:\s+(\w+))?)", std::regex::icase);
 static const std::regex cond_re(
-  R"((\w+(?:\.\w+)?)\s*(=|!=|<=|>=|<|>|LIKE)\s*'([^']+)')",
+  R"((\w+(?:\.\w+)?)\s*(=|!=|<=|>=|<|>|ILIKE|LIKE)\s*'([^']+)')",
   std::regex::icase);
 static const std::regex join_re(
   R"(\s+(LEFT\s+)?JOIN\s+(\w+)(?:\s+(\w+))?\s+ON\s+(\w+)\.(\w+)\s*=\s*(\w+)\.(\w+))",
@@ -40,6 +47,10 @@ static const std::regex skip_re(
   R"(\s+SKIP\s+(\d+))", std::regex::icase);
 static const std::regex limit_re(
   R"(\s+LIMIT\s+(\d+))", std::regex::icase);
+static const std::regex after_re(
+  R"(\s+AFTER\s+'([^']*)')", std::regex::icase);
+static const std::regex parallel_re(
+  R"(\s+PARALLEL\s+(\d+))", std::regex::icase);
 
 // Helpers
 static inline std::vector<std::string> split(const std::string &s, char d) {
@@ -49,11 +60,100 @@ static inline std::vector<std::string> split(const std::string &s, char d) {
     while (std::getline(ss, itm, d)) v.push_back(itm);
     return v;
 }
+// select list: commas inside (...) don't separate columns
+static std::vector<std::string> splitColumns(const std::string &s) {
+    std::vector<std::string> v(1);
+    int depth = 0;
+    for (char c : s) {
+        if (c == '(') ++depth;
+        else if (c == ')') --depth;
+        else if (c == ',' && depth == 0) { v.emplace_back(); continue; }
+        v.back().push_back(c);
+    }
+    return v;
+}
 static inline std::string trim(const std::string &s) {
     auto a = s.find_first_not_of(" \t\r\n");
     auto b = s.find_last_not_of (" \t\r\n");
     return (a==std::string::npos) ? "" : s.substr(a, b-a+1);
 }
+// SUM(a - b) / ROW_NUMBER() / LAG(col[, n[, 'default']]) OVER (...) [AS alias]
+static bool parseWindow(const std::string &col, WindowSpec &w) {
+    static const std::regex window_re(
+      R"(^(SUM|ROW_NUMBER|LAG)\s*\(\s*([^)]*?)\s*\)\s+OVER\s*\(\s*(.*?)\s*\)(?:\s+AS\s+(\w+))?$)",
+      std::regex::icase);
+    static const std::regex over_re(
+      R"(^(?:PARTITION\s+BY\s+(.+?))?\s*(?:ORDER\s+BY\s+(.+))?$)", std::regex::icase);
+    static const std::regex term_re(R"(^\s*([+-])?\s*(\w+(?:\.\w+)?)\s*)");
+    static const std::regex lag_re(
+      R"(^(\w+(?:\.\w+)?)(?:\s*,\s*(\d+)(?:\s*,\s*'([^']*)')?)?$)");
+    static const std::regex col_re(R"(^\w+(?:\.\w+)?$)");
+    static const std::regex key_re(R"(^(\w+(?:\.\w+)?)(?:\s+(ASC|DESC))?$)", std::regex::icase);
+    std::smatch m;
+    if (!std::regex_match(col, m, window_re)) return false;
+    std::string fn = m[1], args = m[2], over = m[3], name = fn;
+    for (auto &c : fn)   c = (char)toupper((unsigned char)c);
+    for (auto &c : name) c = (char)tolower((unsigned char)c);
+    w.alias = m[4].matched ? m[4].str() : name;   // default: sum, row_number, lag
+
+    if (fn == "SUM") {
+        w.func = WindowSpec::SUM;
+        // terms joined by + / -, e.g. SUM(debit - credit)
+        std::smatch tm;
+        std::string rest = args;
+        while (std::regex_search(rest, tm, term_re)) {
+            if (!w.terms.empty() && !tm[1].matched) break;
+            w.terms.push_back({ tm[2], tm[1] == "-" ? -1 : 1 });
+            rest = tm.suffix();
+        }
+        if (w.terms.empty() || !trim(rest).empty())
+            throw std::runtime_error("SUM() OVER: expected columns joined by + or -: " + col);
+    } else if (fn == "LAG") {
+        w.func = WindowSpec::LAG;
+        std::smatch lm;
+        if (!std::regex_match(args, lm, lag_re))
+            throw std::runtime_error("LAG() OVER: expected LAG(col[, n[, 'default']]): " + col);
+        w.terms.push_back({ lm[1], 1 });
+        if (lm[2].matched) w.offset = std::stoi(lm[2]);
+        if (lm[3].matched) w.defaultValue = lm[3];
+        if (w.offset < 1) throw std::runtime_error("LAG() OVER: offset must be at least 1: " + col);
+    } else {
+        w.func = WindowSpec::ROW_NUMBER;
+        if (!args.empty()) throw std::runtime_error("ROW_NUMBER() takes no arguments: " + col);
+    }
+
+    std::smatch om;
+    if (!std::regex_match(over, om, over_re))
+        throw std::runtime_error("OVER: expected ([PARTITION BY ...] [ORDER BY ...]): " + col);
+    if (om[1].matched)
+        for (auto &f : split(om[1], ',')) {
+            if (!std::regex_match(trim(f), col_re))
+                throw std::runtime_error("OVER: bad PARTITION BY column: " + trim(f));
+            w.partitionBy.push_back(trim(f));
+        }
+    if (om[2].matched)
+        for (auto &f : split(om[2], ',')) {
+            std::smatch km;
+            std::string k = trim(f);
+            if (!std::regex_match(k, km, key_re))
+                throw std::runtime_error("OVER: bad ORDER BY column: " + k);
+            w.orderBy.push_back({ km[1], km[2].matched && strcasecmp(km[2].str().c_str(), "DESC") == 0 });
+        }
+    return true;
+}
+// runs of whitespace outside '...' literals become one space
+static std::string normalize(const std::string &s) {
+    std::string out;
+    out.reserve(s.size());
+    bool quoted = false, space = false;
+    for (char c : s) {
+        if (!quoted && (c==' ' || c=='\t' || c=='\r' || c=='\n')) { space = true; continue; }
+        if (space) { out.push_back(' '); space = false; }
+        if (c == '\'') quoted = !quoted;
+        out.push_back(c);
+    }
+    return out;
+}
 
 Query SqlParser::parse(const std::string &sql) {
     std::string s = trim(sql);
@@ -163,29 +263,71 @@ Query SqlParser::parse(const std::string &sql) {
         }
         return q;
     }
+    // CREATE MATERIALIZED VIEW [IF NOT EXISTS] name AS SELECT ...
+    // (the SELECT is checked by ViewManager when the view is created)
+    if (std::regex_match(s, m, create_view_re)) {
+        q.type       = QueryType::CREATE_VIEW;
+        q.ifExists   = m[1].matched;
+        q.table      = m[2];
+        q.viewSelect = m[3];
+        return q;
+    }
+    // DROP MATERIALIZED VIEW [IF EXISTS] name
+    if (std::regex_match(s, m, drop_view_re)) {
+        q.type     = QueryType::DROP_VIEW;
+        q.ifExists = m[1].matched;
+        q.table    = m[2];
+        return q;
+    }
+    // REFRESH MATERIALIZED VIEW name
+    if (std::regex_match(s, m, refresh_view_re)) {
+        q.type  = QueryType::REFRESH_VIEW;
+        q.table = m[1];
+        return q;
+    }
     // SELECT ... FROM table ...
     if (std::regex_search(s, m, select_re)) {
         q.type = QueryType::SELECT;
         // columns (support SUM(col) [AS alias] and COUNT(*))
         // Support qualified fields in SUM, e.g., SUM(l.debit) AS debit
         static const std::regex sum_re(R"(^SUM\(\s*(\w+(?:\.\w+)?)\s*\)(?:\s+AS\s+(\w+))?$)", std::regex::icase);
-        for (auto &c : split(m[1], ',')) {
+        // approximate aggregates: APPROX_COUNT_DISTINCT(col), APPROX_PERCENTILE(col, p)
+        static const std::regex distinct_re(R"(^APPROX_COUNT_DISTINCT\(\s*(\w+(?:\.\w+)?)\s*\)(?:\s+AS\s+(\w+))?$)", std::regex::icase);
+        static const std::regex pct_re(R"(^APPROX_PERCENTILE\(\s*(\w+(?:\.\w+)?)\s*,\s*([0-9]*\.?[0-9]+)\s*\)(?:\s+AS\s+(\w+))?$)", std::regex::icase);
+        for (auto &c : splitColumns(m[1])) {
             auto col = trim(c);
             std::smatch mm;
-            if (std::regex_match(col, mm, sum_re)) {
+            WindowSpec w;
+            if (parseWindow(col, w)) {
+                q.windows.push_back(w);
+            } else if (std::regex_match(col, mm, sum_re)) {
                 AggSpec a; a.type = AggSpec::SUM; a.field = mm[1];
                 if (mm.size()>2 && mm[2].matched) a.alias = mm[2];
                 q.aggs.push_back(a);
+            } else if (std::regex_match(col, mm, distinct_re)) {
+                AggSpec a; a.type = AggSpec::APPROX_COUNT_DISTINCT; a.field = mm[1];
+                if (mm[2].matched) a.alias = mm[2];
+                q.aggs.push_back(a);
+            } else if (std::regex_match(col, mm, pct_re)) {
+                AggSpec a; a.type = AggSpec::APPROX_PERCENTILE; a.field = mm[1];
+                a.param = std::stod(mm[2]);
+                if (a.param > 1.0)
+                    throw std::runtime_error("APPROX_PERCENTILE: p must be between 0 and 1: " + col);
+                if (mm[3].matched) a.alias = mm[3];
+                q.aggs.push_back(a);
             } else {
                 q.selectCols.push_back(col);
             }
         }
-        if (q.selectCols.size()==1 && q.aggs.empty() &&
+        if (q.selectCols.size()==1 && q.aggs.empty() && q.windows.empty() &&
             std::regex_match(q.selectCols[0],
               std::regex(R"(^COUNT\(\*\)$)",std::regex::icase)))
         {
             q.isCount = true;
         }
+        // the rest of the clauses are read after the select list, so an
+        // ORDER BY inside OVER (...) isn't the query's
+        const std::string tail = s.substr(m.position(2));
         // table + optional alias mapping
         q.table = m[2];
         std::map<std::string,std::string> aliasToTable;
@@ -195,7 +337,7 @@ Query SqlParser::parse(const std::string &sql) {
         }
 
         // JOINs (supports optional aliases and LEFT JOIN)
-        for (auto it = std::sregex_iterator(s.begin(), s.end(), join_re);
+        for (auto it = std::sregex_iterator(tail.begin(), tail.end(), join_re);
              it != std::sregex_iterator(); ++it)
         {
             auto &jm = *it;
@@ -221,7 +363,7 @@ Query SqlParser::parse(const std::string &sql) {
             q.joins.push_back(j);
         }
         // WHEREs
-        for (auto wit = std::sregex_iterator(s.begin(), s.end(), cond_re);
+        for (auto wit = std::sregex_iterator(tail.begin(), tail.end(), cond_re);
              wit!=std::sregex_iterator(); ++wit)
         {
             auto &cm = *wit;
@@ -241,20 +383,29 @@ Query SqlParser::parse(const std::string &sql) {
             q.conditions.push_back({ key, cm[2], cm[3] });
         }
         // GROUP BY
-        if (std::regex_search(s, m, group_re))
+        if (std::regex_search(tail, m, group_re))
             q.groupBy = trim(m[1]);
         // ORDER BY
-        if (std::regex_search(s, m, order_re)) {
+        if (std::regex_search(tail, m, order_re)) {
             q.orderByField = trim(m[1]);
             if (m.size()>2 && m[2].matched &&
                 strcasecmp(m[2].str().c_str(),"DESC")==0)
                 q.orderDesc = true;
         }
         // SKIP/LIMIT
-        if (std::regex_search(s, m, skip_re))
+        if (std::regex_search(tail, m, skip_re))
             q.skip = std::stoi(m[1]);
-        if (std::regex_search(s, m, limit_re))
+        if (std::regex_search(tail, m, limit_re))
             q.limit = std::stoi(m[1]);
+        // AFTER '<cursor>' (keyset pagination, see QueryExecutor)
+        if (std::regex_search(tail, m, after_re)) {
+            q.hasAfter = true;
+            q.after    = m[1];
+        }
+        // PARALLEL n (degree of parallelism for the base-table scan)
+        if (std::regex_search(tail, m, parallel_re))
+            q.parallelism = std::stoi(m[1]);
+        q.text = normalize(s);
         return q;
     }
 
@@ -0,0 +1,357 @@
+// V8Convert.cpp
+#include "V8Convert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+namespace V8Convert {
+
+bool parseShape(const std::string& name, Shape& out) {
+    if (name == "objects") { out = Shape::Objects; return true; }
+    if (name == "rows")    { out = Shape::Rows;    return true; }
+    if (name == "columns") { out = Shape::Columns; return true; }
+    return false;
+}
+
+static v8::Local<v8::String> str(v8::Isolate* iso, const std::string& s) {
+    return v8::String::NewFromUtf8(iso, s.data(), v8::NewStringType::kNormal,
+                                   (int)s.size()).ToLocalChecked();
+}
+
+// Column names in first-seen order, each internalized once
+struct Columns {
+    std::vector<std::string>                  names;
+    std::vector<v8::Local<v8::String>>        keys;
+    std::unordered_map<std::string, size_t>   index;
+
+    size_t add(v8::Isolate* iso, const std::string& name) {
+        auto it = index.find(name);
+        if (it != index.end()) return it->second;
+        size_t i = names.size();
+        index.emplace(name, i);
+        names.push_back(name);
+        keys.push_back(v8::String::NewFromUtf8(iso, name.data(), v8::NewStringType::kInternalized,
+                                               (int)name.size()).ToLocalChecked());
+        return i;
+    }
+
+    v8::Local<v8::Array> toArray(v8::Isolate* iso) const {
+        std::vector<v8::Local<v8::Value>> v(keys.begin(), keys.end());
+        return v8::Array::New(iso, v.data(), v.size());
+    }
+};
+
+static void collect(v8::Isolate* iso, const QueryResult& r, Columns& cols) {
+    for (const auto& row : r.rows)
+        for (const auto& kv : row.vals) cols.add(iso, kv.first);
+}
+
+// whole string is a decimal number (no hex, inf or nan spellings)
+static bool parseNumber(const std::string& s, double& out) {
+    if (s.empty()) return false;
+    for (char c : s) {
+        if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'))
+            return false;
+    }
+    char* end = nullptr;
+    out = std::strtod(s.c_str(), &end);
+    return end == s.c_str() + s.size();
+}
+
+static v8::Local<v8::Value> toObjects(v8::Isolate* iso, v8::Local<v8::Context> ctx,
+                                      const QueryResult& r) {
+    Columns cols;
+    std::vector<v8::Local<v8::Value>> items;
+    items.reserve(r.rows.size());
+    for (const auto& row : r.rows) {
+        v8::Local<v8::Object> obj = v8::Object::New(iso);
+        // same keys in the same order => same map transitions for every row
+        for (const auto& kv : row.vals)
+            obj->CreateDataProperty(ctx, cols.keys[cols.add(iso, kv.first)], str(iso, kv.second)).FromJust();
+        items.push_back(obj);
+    }
+    return v8::Array::New(iso, items.data(), items.size());
+}
+
+static v8::Local<v8::Value> toRows(v8::Isolate* iso, v8::Local<v8::Context> ctx,
+                                   const QueryResult& r) {
+    Columns cols;
+    collect(iso, r, cols);
+    const size_t n = cols.names.size();
+
+    std::vector<v8::Local<v8::Value>> rows;
+    rows.reserve(r.rows.size());
+    std::vector<v8::Local<v8::Value>> cells(n);
+    for (const auto& row : r.rows) {
+        std::fill(cells.begin(), cells.end(), v8::Null(iso));
+        for (const auto& kv : row.vals)
+            cells[cols.index[kv.first]] = str(iso, kv.second);
+        rows.push_back(v8::Array::New(iso, cells.data(), n));
+    }
+
+    v8::Local<v8::Object> out = v8::Object::New(iso);
+    out->CreateDataProperty(ctx, str(iso, "columns"), cols.toArray(iso)).FromJust();
+    out->CreateDataProperty(ctx, str(iso, "rows"), v8::Array::New(iso, rows.data(), rows.size())).FromJust();
+    return out;
+}
+
+static v8::Local<v8::Value> toColumns(v8::Isolate* iso, v8::Local<v8::Context> ctx,
+                                      const QueryResult& r) {
+    Columns cols;
+    collect(iso, r, cols);
+    const size_t n = cols.names.size();
+    const size_t len = r.rows.size();
+
+    // which columns are numeric in every row that has them
+    std::vector<char> numeric(n, 1);
+    double d;
+    for (const auto& row : r.rows)
+        for (const auto& kv : row.vals) {
+            size_t c = cols.index[kv.first];
+            if (numeric[c] && !parseNumber(kv.second, d)) numeric[c] = 0;
+        }
+
+    v8::Local<v8::Object> data = v8::Object::New(iso);
+    for (size_t c = 0; c < n; ++c) {
+        const std::string& name = cols.names[c];
+        v8::Local<v8::Value> column;
+        if (numeric[c]) {
+            auto buf = v8::ArrayBuffer::New(iso, len * sizeof(double));
+            auto arr = v8::Float64Array::New(buf, 0, len);
+            double* p = static_cast<double*>(buf->GetBackingStore()->Data());
+            for (size_t i = 0; i < len; ++i) {
+                auto it = r.rows[i].vals.find(name);
+                p[i] = (it != r.rows[i].vals.end() && parseNumber(it->second, d)) ? d : NAN;
+            }
+            column = arr;
+        } else {
+            std::vector<v8::Local<v8::Value>> vals(len);
+            for (size_t i = 0; i < len; ++i) {
+                auto it = r.rows[i].vals.find(name);
+                vals[i] = (it != r.rows[i].vals.end()) ? v8::Local<v8::Value>(str(iso, it->second))
+                                                       : v8::Local<v8::Value>(v8::Null(iso));
+            }
+            column = v8::Array::New(iso, vals.data(), len);
+        }
+        data->CreateDataProperty(ctx, cols.keys[c], column).FromJust();
+    }
+
+    v8::Local<v8::Object> out = v8::Object::New(iso);
+    out->CreateDataProperty(ctx, str(iso, "columns"), cols.toArray(iso)).FromJust();
+    out->CreateDataProperty(ctx, str(iso, "length"), v8::Number::New(iso, (double)len)).FromJust();
+    out->CreateDataProperty(ctx, str(iso, "data"), data).FromJust();
+    return out;
+}
+
+v8::Local<v8::Value> toV8(v8::Isolate* iso, v8::Local<v8::Context> ctx,
+                          const QueryResult& r, Shape shape) {
+    v8::EscapableHandleScope hs(iso);
+    v8::Local<v8::Value> v;
+    switch (shape) {
+        case Shape::Rows:    v = toRows(iso, ctx, r);    break;
+        case Shape::Columns: v = toColumns(iso, ctx, r); break;
+        default:             v = toObjects(iso, ctx, r); break;
+    }
+    return hs.Escape(v);
+}
+
+// --- JSON writer -------------------------------------------------------------
+
+namespace {
+
+struct JsonFail {};   // unwinds to toJson(): cycle, BigInt, JS exception
+
+class JsonWriter {
+public:
+    JsonWriter(v8::Isolate* iso, v8::Local<v8::Context> ctx, std::string& out)
+        : _iso(iso), _ctx(ctx), _out(out),
+          _toJSON(v8::String::NewFromUtf8(iso, "toJSON", v8::NewStringType::kInternalized).ToLocalChecked()) {}
+
+    // false if v has no JSON form (caller skips it / writes null)
+    bool value(v8::Local<v8::Value> v, v8::Local<v8::Value> key) {
+        if (v->IsObject() && !v->IsFunction()) {
+            v8::Local<v8::Value> fn;
+            if (!v.As<v8::Object>()->Get(_ctx, _toJSON).ToLocal(&fn)) throw JsonFail();
+            if (fn->IsFunction()) {
+                v8::Local<v8::Value> arg[1] = { key };
+                if (!fn.As<v8::Function>()->Call(_ctx, v, 1, arg).ToLocal(&v)) throw JsonFail();
+            }
+        }
+        return primitive(v);
+    }
+
+private:
+    static constexpr int kMaxDepth = 1000;   // JSON.stringify would overflow around here
+
+    bool primitive(v8::Local<v8::Value> v) {
+        if (v->IsNull())      { _out += "null"; return true; }
+        if (v->IsTrue())      { _out += "true"; return true; }
+        if (v->IsFalse())     { _out += "false"; return true; }
+        if (v->IsString())    { string(v.As<v8::String>()); return true; }
+        if (v->IsNumber())    { number(v.As<v8::Number>()->Value()); return true; }
+        if (v->IsBigInt() || v->IsBigIntObject()) throw JsonFail();   // TypeError in JS
+        if (v->IsUndefined() || v->IsFunction() || v->IsSymbol()) return false;
+        if (v->IsNumberObject()) { number(v.As<v8::NumberObject>()->ValueOf()); return true; }
+        if (v->IsStringObject()) { string(v.As<v8::StringObject>()->ValueOf()); return true; }
+        if (v->IsBooleanObject()) { _out += v.As<v8::BooleanObject>()->ValueOf() ? "true" : "false"; return true; }
+        if (v->IsSymbolObject()) { _out += "{}"; return true; }
+
+        v8::Local<v8::Object> obj = v.As<v8::Object>();
+        for (const auto& seen : _stack)
+            if (seen == obj) throw JsonFail();          // cycle
+        if ((int)_stack.size() >= kMaxDepth) throw JsonFail();
+        _stack.push_back(obj);
+        v8::HandleScope hs(_iso);
+        if (v->IsArray()) array(obj.As<v8::Array>());
+        else              object(obj);
+        _stack.pop_back();
+        return true;
+    }
+
+    void array(v8::Local<v8::Array> arr) {
+        _out += '[';
+        const uint32_t n = arr->Length();
+        for (uint32_t i = 0; i < n; ++i) {
+            v8::HandleScope item_scope(_iso);
+            if (i) _out += ',';
+            v8::Local<v8::Value> item;
+            if (!arr->Get(_ctx, i).ToLocal(&item)) throw JsonFail();
+            if (!value(item, v8::Integer::NewFromUnsigned(_iso, i)->ToString(_ctx).ToLocalChecked()))
+                _out += "null";
+        }
+        _out += ']';
+    }
+
+    void object(v8::Local<v8::Object> obj) {
+        v8::Local<v8::Array> keys;
+        if (!obj->GetOwnPropertyNames(_ctx,
+                static_cast<v8::PropertyFilter>(v8::ONLY_ENUMERABLE | v8::SKIP_SYMBOLS),
+                v8::KeyConversionMode::kConvertToString).ToLocal(&keys))
+            throw JsonFail();
+        _out += '{';
+        bool first = true;
+        const uint32_t n = keys->Length();
+        for (uint32_t i = 0; i < n; ++i) {
+            v8::HandleScope item_scope(_iso);
+            v8::Local<v8::Value> k, item;
+            if (!keys->Get(_ctx, i).ToLocal(&k) || !obj->Get(_ctx, k).ToLocal(&item)) throw JsonFail();
+            // write the key, then drop it again if the value has no JSON form
+            const size_t mark = _out.size();
+            if (!first) _out += ',';
+            string(k.As<v8::String>());
+            _out += ':';
+            if (value(item, k)) first = false;
+            else                _out.resize(mark);
+        }
+        _out += '}';
+    }
+
+    void number(double d) {
+        if (!std::isfinite(d)) { _out += "null"; return; }
+        if (d == std::floor(d) && std::fabs(d) < 9007199254740992.0) {   // 2^53
+            char buf[24];
+            std::snprintf(buf, sizeof buf, "%lld", (long long)d);   // -0 prints as 0, like JS
+            _out += buf;
+            return;
+        }
+        // shortest round-trip form, exactly as JS prints it
+        v8::String::Utf8Value s(_iso, v8::Number::New(_iso, d));
+        _out += *s;
+    }
+
+    void string(v8::Local<v8::String> s) {
+        const int len = s->Length();
+        _out += '"';
+        if (s->IsOneByte()) {
+            _latin1.resize(len);
+            s->WriteOneByte(_iso, _latin1.data(), 0, len, v8::String::NO_NULL_TERMINATION);
+            for (uint8_t c : _latin1) {
+                if (c >= 0x80) { _out += char(0xC0 | (c >> 6)); _out += char(0x80 | (c & 0x3F)); }
+                else escape(c);
+            }
+        } else {
+            _utf16.resize(len);
+            s->Write(_iso, _utf16.data(), 0, len, v8::String::NO_NULL_TERMINATION);
+            for (int i = 0; i < len; ++i) {
+                uint32_t c = _utf16[i];
+                if (c < 0x80) { escape((char)c); continue; }
+                if (c >= 0xD800 && c <= 0xDBFF && i + 1 < len &&
+                    _utf16[i + 1] >= 0xDC00 && _utf16[i + 1] <= 0xDFFF) {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (_utf16[++i] - 0xDC00);
+                } else if (c >= 0xD800 && c <= 0xDFFF) {
+                    hexEscape(c);   // lone surrogate, as JSON.stringify does
+                    continue;
+                }
+                utf8(c);
+            }
+        }
+        _out += '"';
+    }
+
+    void escape(char c) {
+        switch (c) {
+            case '"':  _out += "\\\""; break;
+            case '\\': _out += "\\\\"; break;
+            case '\b': _out += "\\b"; break;
+            case '\f': _out += "\\f"; break;
+            case '\n': _out += "\\n"; break;
+            case '\r': _out += "\\r"; break;
+            case '\t': _out += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) hexEscape((unsigned char)c);
+                else _out += c;
+        }
+    }
+
+    void hexEscape(uint32_t c) {
+        char buf[8];
+        std::snprintf(buf, sizeof buf, "\\u%04x", c);
+        _out += buf;
+    }
+
+    void utf8(uint32_t c) {
+        if (c < 0x800) {
+            _out += char(0xC0 | (c >> 6));
+        } else if (c < 0x10000) {
+            _out += char(0xE0 | (c >> 12));
+            _out += char(0x80 | ((c >> 6) & 0x3F));
+        } else {
+            _out += char(0xF0 | (c >> 18));
+            _out += char(0x80 | ((c >> 12) & 0x3F));
+            _out += char(0x80 | ((c >> 6) & 0x3F));
+        }
+        _out += char(0x80 | (c & 0x3F));
+    }
+
+    v8::Isolate*                        _iso;
+    v8::Local<v8::Context>              _ctx;
+    std::string&                        _out;
+    v8::Local<v8::String>               _toJSON;
+    std::vector<v8::Local<v8::Object>>  _stack;    // open objects, for cycles
+    std::vector<uint8_t>                _latin1;
+    std::vector<uint16_t>               _utf16;
+};
+
+} // namespace
+
+bool toJson(v8::Isolate* iso, v8::Local<v8::Context> ctx,
+            v8::Local<v8::Value> value, std::string& out) {
+    v8::HandleScope hs(iso);
+    v8::TryCatch tc(iso);   // toJSON/getters may throw; same outcome as a cycle
+    std::string buf;
+    try {
+        JsonWriter w(iso, ctx, buf);
+        if (!w.value(value, v8::String::Empty(iso))) return false;
+    } catch (const JsonFail&) {
+        buf = "[]";
+    }
+    out = std::move(buf);
+    return true;
+}
+
+} // namespace V8Convert
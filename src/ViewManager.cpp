@@ -0,0 +1,443 @@
+// ViewManager.cpp
+#include "ViewManager.h"
+#include "DBManager.h"
+#include "SchemaManager.h"
+#include "SqlParser.h"
+#include "Predicate.h"
+#include "Sketch.h"
+#include <json.hpp>           // nlohmann::json
+#include <rocksdb/write_batch.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <regex>
+#include <shared_mutex>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace {
+
+struct ViewAgg {
+    enum Kind { SUM, COUNT, DISTINCT, PERCENTILE } kind = SUM;
+    std::string field;
+    std::string alias;
+    double      quantile = 0.0;  // PERCENTILE
+    bool sketch() const { return kind == DISTINCT || kind == PERCENTILE; }
+};
+
+struct ViewDef {
+    std::string              name;
+    std::string              table;
+    std::string              sql;
+    std::vector<std::string> groupBy;
+    std::vector<ViewAgg>     aggs;
+    std::vector<Condition>   conds;
+    Predicate                pred;
+};
+
+const char* kDefs = "__views";   // view name -> {"table", "sql"}
+
+std::shared_mutex                                      g_mu;      // guards g_views
+std::map<std::string, std::shared_ptr<const ViewDef>> g_views;
+std::mutex                                             g_writeMu;
+
+std::string unqualified(const std::string &f) {
+    auto p = f.find('.');
+    return p == std::string::npos ? f : f.substr(p + 1);
+}
+
+std::string trim(const std::string &s) {
+    auto a = s.find_first_not_of(" \t\r\n");
+    auto b = s.find_last_not_of(" \t\r\n");
+    return a == std::string::npos ? std::string() : s.substr(a, b - a + 1);
+}
+
+// the defining SELECT, restricted to what can be maintained by deltas
+ViewDef parseDef(const std::string &name, const std::string &sql) {
+    static const std::regex group_list_re(
+        R"(\s+GROUP\s+BY\s+(\w+(?:\.\w+)?(?:\s*,\s*\w+(?:\.\w+)?)*))", std::regex::icase);
+    static const std::regex count_re(R"(^COUNT\(\s*\*\s*\)(?:\s+AS\s+(\w+))?$)", std::regex::icase);
+
+    Query q = SqlParser::parse(sql);
+    if (q.type != QueryType::SELECT)
+        throw std::runtime_error("materialized view " + name + ": definition must be a SELECT");
+    if (!q.joins.empty())
+        throw std::runtime_error("materialized view " + name + ": JOIN is not supported");
+    if (!q.orderByField.empty() || q.skip > 0 || q.limit >= 0)
+        throw std::runtime_error("materialized view " + name + ": ORDER BY/SKIP/LIMIT go in queries on the view");
+    if (!q.windows.empty())
+        throw std::runtime_error("materialized view " + name + ": window functions go in queries on the view");
+
+    ViewDef v;
+    v.name  = name;
+    v.table = q.table;
+    v.sql   = sql;
+
+    std::smatch m;
+    if (!std::regex_search(sql, m, group_list_re))
+        throw std::runtime_error("materialized view " + name + ": GROUP BY is required");
+    std::string list = m[1];
+    for (size_t at = 0; at <= list.size();) {
+        size_t comma = list.find(',', at);
+        if (comma == std::string::npos) comma = list.size();
+        v.groupBy.push_back(unqualified(trim(list.substr(at, comma - at))));
+        at = comma + 1;
+    }
+
+    auto isGroup = [&v](const std::string &f) {
+        for (auto &g : v.groupBy) if (g == f) return true;
+        return false;
+    };
+    for (auto &col : q.selectCols) {
+        std::smatch cm;
+        if (std::regex_match(col, cm, count_re)) {
+            ViewAgg a;
+            a.kind  = ViewAgg::COUNT;
+            a.alias = cm[1].matched ? cm[1].str() : std::string("count");
+            v.aggs.push_back(a);
+        } else if (!isGroup(unqualified(col))) {
+            throw std::runtime_error("materialized view " + name + ": " + col
+                                     + " is neither grouped nor aggregated");
+        }
+    }
+    for (auto &a : q.aggs) {
+        ViewAgg va;
+        va.kind  = a.type == AggSpec::APPROX_COUNT_DISTINCT ? ViewAgg::DISTINCT
+                 : a.type == AggSpec::APPROX_PERCENTILE     ? ViewAgg::PERCENTILE
+                 : ViewAgg::SUM;
+        va.field = unqualified(a.field);
+        va.alias = a.alias.empty() ? va.field : a.alias;
+        va.quantile = a.param;
+        v.aggs.push_back(va);
+    }
+    for (auto &a : v.aggs)
+        if (a.alias == "_rows" || isGroup(a.alias))
+            throw std::runtime_error("materialized view " + name + ": column " + a.alias + " is used twice");
+
+    for (auto &c : q.conditions)
+        if (c.key.find('.') != std::string::npos)
+            throw std::runtime_error("materialized view " + name + ": condition on another table: " + c.key);
+    v.conds = q.conditions;
+    v.pred  = Predicate::compile(q.table, q.conditions);
+    return v;
+}
+
+// adds row's contribution (sign +1 / -1) to its group's delta
+void contribute(const ViewDef &v, const std::map<std::string,std::string> &row, int sign,
+                std::map<std::string, ViewManager::Delta> &acc)
+{
+    if (!v.pred.matches(row)) return;
+    std::string key;
+    std::map<std::string,std::string> group;
+    for (size_t i = 0; i < v.groupBy.size(); ++i) {
+        auto it = row.find(v.groupBy[i]);
+        std::string val = it == row.end() ? std::string() : it->second;
+        if (i) key.push_back('\x1f');
+        key += val;
+        group[v.groupBy[i]] = std::move(val);
+    }
+    auto &d = acc[v.name + '\0' + key];
+    if (d.view.empty()) {
+        d.view  = v.name;
+        d.key   = key;
+        d.group = std::move(group);
+    }
+    d.rows += sign;
+    for (auto &a : v.aggs) {
+        if (a.sketch()) {
+            // as in queries: empty values aren't counted, non-numbers have
+            // no percentile
+            auto it = row.find(a.field);
+            if (it == row.end() || it->second.empty()) continue;
+            double x;
+            if (a.kind == ViewAgg::PERCENTILE && !Predicate::parseNumber(it->second, x)) continue;
+            auto &sd = d.sketches[a.alias];
+            sd.distinct = a.kind == ViewAgg::DISTINCT;
+            sd.quantile = a.quantile;
+            (sign > 0 ? sd.added : sd.removed).push_back(it->second);
+            continue;
+        }
+        double x = 1.0;
+        if (a.kind == ViewAgg::SUM) {
+            // same leniency as GROUP BY in QueryExecutor: non-numbers count as 0
+            auto it = row.find(a.field);
+            try { x = std::stod(it == row.end() ? std::string() : it->second); } catch (...) { x = 0.0; }
+        }
+        d.sums[a.alias] += sign * x;
+    }
+}
+
+std::shared_ptr<const ViewDef> findView(const std::string &name) {
+    std::shared_lock<std::shared_mutex> lk(g_mu);
+    auto it = g_views.find(name);
+    return it == g_views.end() ? nullptr : it->second;
+}
+
+// drop every row of the view's column family; caller holds g_writeMu
+void clearRows(const std::string &name) {
+    auto &mgr = DBManager::instance();
+    auto *h = mgr.cf(name);
+    if (!h) return;
+    rocksdb::WriteBatch wb;
+    std::unique_ptr<rocksdb::Iterator> it(mgr.db()->NewIterator(rocksdb::ReadOptions(), h));
+    for (it->SeekToFirst(); it->Valid(); it->Next()) wb.Delete(h, it->key());
+    auto s = mgr.db()->Write(rocksdb::WriteOptions(), &wb);
+    if (!s.ok()) throw std::runtime_error("materialized view " + name + ": " + s.ToString());
+    mgr.bumpVersion(name);
+}
+
+// rows scanned between folds of the pending sketch values into the group
+// rows (rebuild, resketch), so the values held stay bounded
+constexpr size_t kFoldRows = 65536;
+
+// recompute the view from its table; caller holds g_writeMu, so writers to
+// the table wait until it is done. The old rows are replaced in the same
+// write as the new ones: readers never see the view empty or half built.
+void rebuild(const ViewDef &v) {
+    auto &mgr = DBManager::instance();
+    // deltas are folded into the group rows every so often, so the values
+    // held for sketches stay bounded
+    std::map<std::string, ViewManager::Delta> acc;
+    std::map<std::string, std::string> groups;   // view key -> row
+    auto fold = [&] {
+        for (auto &[_, d] : acc) {
+            auto g = groups.find(d.key);
+            groups[d.key] = ViewManager::applyDelta(g == groups.end() ? nullptr : &g->second, d);
+        }
+        acc.clear();
+    };
+    size_t n = 0;
+    mgr.scanEach(v.table, v.pred, [&](const std::string&, std::map<std::string,std::string> &row) {
+        contribute(v, row, +1, acc);
+        if (++n % kFoldRows == 0) fold();
+        return true;
+    });
+    fold();
+    auto *h = mgr.cf(v.name);
+    rocksdb::WriteBatch wb;
+    std::unique_ptr<rocksdb::Iterator> it(mgr.db()->NewIterator(rocksdb::ReadOptions(), h));
+    for (it->SeekToFirst(); it->Valid(); it->Next())
+        if (!groups.count(it->key().ToString())) wb.Delete(h, it->key());
+    for (auto &[key, row] : groups) wb.Put(h, key, row);
+    auto s = mgr.db()->Write(rocksdb::WriteOptions(), &wb);
+    if (!s.ok()) throw std::runtime_error("materialized view " + v.name + ": " + s.ToString());
+    mgr.bumpVersion(v.name);
+    std::cout << "[ViewManager] " << v.name << ": " << groups.size() << " groups from " << v.table << std::endl;
+}
+
+} // namespace
+
+std::mutex& ViewManager::writeMutex() { return g_writeMu; }
+
+bool ViewManager::isView(const std::string &name) {
+    return findView(name) != nullptr;
+}
+
+bool ViewManager::hasViews(const std::string &table) {
+    std::shared_lock<std::shared_mutex> lk(g_mu);
+    for (auto &[_, v] : g_views)
+        if (v->table == table) return true;
+    return false;
+}
+
+void ViewManager::load() {
+    auto &mgr = DBManager::instance();
+    auto *h = mgr.cf(kDefs);
+    if (!h) return;
+    std::unique_ptr<rocksdb::Iterator> it(mgr.db()->NewIterator(rocksdb::ReadOptions(), h));
+    std::unique_lock<std::shared_mutex> lk(g_mu);
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        std::string name = it->key().ToString();
+        try {
+            auto j = json::parse(it->value().ToString());
+            g_views[name] = std::make_shared<ViewDef>(parseDef(name, j.at("sql").get<std::string>()));
+        } catch (const std::exception &e) {
+            std::cerr << "[ViewManager] Skipping view " << name << ": " << e.what() << std::endl;
+        }
+    }
+    if (!g_views.empty())
+        std::cout << "[ViewManager] " << g_views.size() << " materialized views" << std::endl;
+}
+
+void ViewManager::create(const std::string &name, const std::string &selectSql, bool ifNotExists) {
+    if (DBManager::inScope())
+        throw std::runtime_error("CREATE MATERIALIZED VIEW can't run inside a batch or transaction");
+    auto &mgr = DBManager::instance();
+    std::lock_guard<std::mutex> wl(g_writeMu);
+    if (isView(name)) {
+        if (ifNotExists) return;
+        throw std::runtime_error("materialized view " + name + " already exists");
+    }
+    auto def = std::make_shared<ViewDef>(parseDef(name, selectSql));
+    if (def->table == name || isView(def->table))
+        throw std::runtime_error("materialized view " + name + ": must be defined over a table");
+    // the name becomes a column family: don't take over a table's (an
+    // empty one, e.g. of a dropped view, is fine)
+    if (SchemaManager::allSchemas().count(name))
+        throw std::runtime_error(name + " is already a table");
+    if (auto *h = mgr.cf(name)) {
+        std::unique_ptr<rocksdb::Iterator> it(mgr.db()->NewIterator(rocksdb::ReadOptions(), h));
+        it->SeekToFirst();
+        if (it->Valid()) throw std::runtime_error(name + " is already a table");
+    }
+
+    json j = { {"table", def->table}, {"sql", selectSql} };
+    auto s = mgr.db()->Put(rocksdb::WriteOptions(), mgr.cf(kDefs), name, j.dump());
+    if (!s.ok()) throw std::runtime_error("materialized view " + name + ": " + s.ToString());
+    {
+        std::unique_lock<std::shared_mutex> lk(g_mu);
+        g_views[name] = def;
+    }
+    rebuild(*def);
+}
+
+void ViewManager::drop(const std::string &name, bool ifExists) {
+    if (DBManager::inScope())
+        throw std::runtime_error("DROP MATERIALIZED VIEW can't run inside a batch or transaction");
+    auto &mgr = DBManager::instance();
+    std::lock_guard<std::mutex> wl(g_writeMu);
+    if (!isView(name)) {
+        if (ifExists) return;
+        throw std::runtime_error("no materialized view " + name);
+    }
+    {
+        std::unique_lock<std::shared_mutex> lk(g_mu);
+        g_views.erase(name);
+    }
+    mgr.db()->Delete(rocksdb::WriteOptions(), mgr.cf(kDefs), name);
+    // the column family stays (readers may hold its handle), empty
+    clearRows(name);
+    std::cout << "[ViewManager] dropped " << name << std::endl;
+}
+
+void ViewManager::refresh(const std::string &name) {
+    if (DBManager::inScope())
+        throw std::runtime_error("REFRESH MATERIALIZED VIEW can't run inside a batch or transaction");
+    std::lock_guard<std::mutex> wl(g_writeMu);
+    auto def = findView(name);
+    if (!def) throw std::runtime_error("no materialized view " + name);
+    rebuild(*def);
+}
+
+void ViewManager::deltas(const std::string &table,
+                         const std::map<std::string,std::string> *oldRow,
+                         const std::map<std::string,std::string> *newRow,
+                         std::vector<Delta> &out)
+{
+    std::vector<std::shared_ptr<const ViewDef>> views;
+    {
+        std::shared_lock<std::shared_mutex> lk(g_mu);
+        for (auto &[_, v] : g_views)
+            if (v->table == table) views.push_back(v);
+    }
+    std::map<std::string, Delta> acc;
+    for (auto &v : views) {
+        if (oldRow) contribute(*v, *oldRow, -1, acc);
+        if (newRow) contribute(*v, *newRow, +1, acc);
+    }
+    for (auto &[_, d] : acc) {
+        bool changed = d.rows != 0;
+        for (auto &[__, x] : d.sums) changed = changed || x != 0.0;
+        // a value both removed and added (the old and new row agree) is no
+        // change; any other removal needs the group's sketches recomputed
+        for (auto &[__, sd] : d.sketches) {
+            for (auto &val : sd.removed) {
+                auto hit = std::find(sd.added.begin(), sd.added.end(), val);
+                if (hit != sd.added.end()) sd.added.erase(hit);
+                else d.resketch = true;
+            }
+            sd.removed.clear();
+            changed = changed || !sd.added.empty();
+        }
+        changed = changed || d.resketch;
+        if (changed) out.push_back(std::move(d));
+    }
+}
+
+std::string ViewManager::applyDelta(const std::string *current, const Delta &d) {
+    json row = json::object();
+    if (current) row = json::parse(*current);
+    else for (auto &[f, v] : d.group) row[f] = v;
+    long n = row.value("_rows", 0L) + d.rows;
+    if (n <= 0) return std::string();
+    row["_rows"] = n;
+    for (auto &[a, x] : d.sums) row[a] = row.value(a, 0.0) + x;
+    for (auto &[a, sd] : d.sketches) {
+        if (sd.added.empty()) continue;
+        std::string state = row.value("_sketch_" + a, std::string());
+        if (sd.distinct) {
+            HyperLogLog h;
+            if (!state.empty()) h = HyperLogLog::parse(state);
+            for (auto &val : sd.added) h.add(val);
+            row["_sketch_" + a] = h.serialize();
+            row[a] = std::llround(h.estimate());
+        } else {
+            TDigest t;
+            if (!state.empty()) t = TDigest::parse(state);
+            for (auto &val : sd.added) {
+                double x;
+                if (Predicate::parseNumber(val, x)) t.add(x);
+            }
+            row["_sketch_" + a] = t.serialize();
+            row[a] = t.quantile(sd.quantile);
+        }
+    }
+    return row.dump();
+}
+
+void ViewManager::resketch(const std::string &view, const std::string &key) {
+    auto def = findView(view);
+    if (!def) return;
+    const ViewDef &v = *def;
+    auto &mgr = DBManager::instance();
+    auto *h = mgr.cf(v.name);
+    try {
+        std::string cur;
+        if (!mgr.db()->Get(rocksdb::ReadOptions(), h, key, &cur).ok()) return;   // group is gone
+        json row = json::parse(cur);
+
+        // the group's rows: narrowed by its first group value (an index
+        // seek when that field is indexed), then matched on the whole key
+        std::vector<Condition> conds = v.conds;
+        std::string first = row.value(v.groupBy[0], std::string());
+        if (!first.empty()) conds.push_back({ v.groupBy[0], "=", first });
+        const std::string mine = v.name + '\0' + key;
+
+        // start the sketches over, then fold the group's current values in
+        // as the scan goes, every kFoldRows rows
+        for (auto &a : v.aggs) {
+            if (!a.sketch()) continue;
+            row.erase("_sketch_" + a.alias);
+            row[a.alias] = 0;
+        }
+        std::string out = row.dump();
+        std::map<std::string, Delta> acc;
+        auto fold = [&] {
+            if (auto it = acc.find(mine); it != acc.end()) {
+                Delta &d = it->second;
+                d.rows = 0;
+                d.sums.clear();
+                out = applyDelta(&out, d);
+            }
+            acc.clear();
+        };
+        size_t n = 0;
+        mgr.scanEach(v.table, Predicate::compile(v.table, conds),
+            [&](const std::string&, std::map<std::string,std::string> &r0) {
+                contribute(v, r0, +1, acc);
+                for (auto it = acc.begin(); it != acc.end();)
+                    it = it->first == mine ? std::next(it) : acc.erase(it);
+                if (++n % kFoldRows == 0) fold();
+                return true;
+            });
+        fold();
+        auto s = mgr.db()->Put(rocksdb::WriteOptions(), h, key, out);
+        if (!s.ok()) throw std::runtime_error(s.ToString());
+    } catch (const std::exception &e) {
+        std::cerr << "[ViewManager] " << v.name << ": can't recompute a group ("
+                  << e.what() << "); REFRESH MATERIALIZED VIEW " << v.name << std::endl;
+    }
+}
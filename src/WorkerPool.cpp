@@ -0,0 +1,226 @@
+// WorkerPool.cpp
+#include "WorkerPool.h"
+#include <algorithm>
+#include <iostream>
+
+// --- CancellationToken -------------------------------------------------------
+
+static thread_local std::shared_ptr<void> tl_currentToken;   // holds a State
+
+static int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CancellationToken::CancellationToken() : _s(std::make_shared<State>()) {}
+
+void CancellationToken::cancelAfter(std::chrono::milliseconds ms) const {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(ms).count();
+    _s->deadline.store(steadyNowNs() + ns, std::memory_order_relaxed);
+}
+
+bool CancellationToken::cancelled() const {
+    if (_s->flag.load(std::memory_order_relaxed)) return true;
+    int64_t dl = _s->deadline.load(std::memory_order_relaxed);
+    if (dl != 0 && steadyNowNs() >= dl) {
+        _s->flag.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+CancellationToken CancellationToken::current() {
+    CancellationToken tok;
+    if (tl_currentToken)
+        tok._s = std::static_pointer_cast<State>(tl_currentToken);
+    return tok;
+}
+
+CancellationToken::Scope::Scope(const CancellationToken& tok)
+    : _prev(std::static_pointer_cast<State>(tl_currentToken))
+{
+    tl_currentToken = tok._s;
+}
+
+CancellationToken::Scope::~Scope() {
+    tl_currentToken = _prev;
+}
+
+// --- WorkerPool --------------------------------------------------------------
+
+static size_t g_defaultDop = 0;   // 0 = hardware concurrency
+
+// set on pool threads so nested tasks go to the worker's own deque
+static thread_local WorkerPool* tl_pool  = nullptr;
+static thread_local size_t      tl_index = 0;
+
+size_t WorkerPool::defaultParallelism() {
+    if (g_defaultDop) return g_defaultDop;
+    size_t hw = std::thread::hardware_concurrency();
+    return hw ? hw : 1;
+}
+void WorkerPool::setDefaultParallelism(size_t dop) { g_defaultDop = dop; }
+
+WorkerPool& WorkerPool::shared() {
+    // a TaskGroup's waiter runs tasks too, so one thread fewer is enough
+    static WorkerPool pool(defaultParallelism() > 1 ? defaultParallelism() - 1 : 1);
+    return pool;
+}
+
+WorkerPool::WorkerPool(size_t threads) {
+    _workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        _workers.emplace_back(new Worker);
+    for (size_t i = 0; i < threads; ++i)
+        _workers[i]->thread = std::thread([this, i] { workerLoop(i); });
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lk(_mu);
+        _stop = true;
+    }
+    _cv.notify_all();
+    for (auto& w : _workers) w->thread.join();
+}
+
+void WorkerPool::schedule(Job job) {
+    if (tl_pool == this) {
+        Worker& w = *_workers[tl_index];
+        std::lock_guard<std::mutex> lk(w.mu);
+        w.jobs.push_back(std::move(job));
+    } else {
+        std::lock_guard<std::mutex> lk(_mu);
+        _inject.push_back(std::move(job));
+    }
+    _queued.fetch_add(1);
+    // take _mu so a worker between its empty check and wait() can't miss this
+    { std::lock_guard<std::mutex> lk(_mu); }
+    _cv.notify_one();
+}
+
+bool WorkerPool::tryPop(size_t self, Job& out) {
+    if (_queued.load() == 0) return false;
+    // 1) own deque, newest first
+    {
+        Worker& w = *_workers[self];
+        std::lock_guard<std::mutex> lk(w.mu);
+        if (!w.jobs.empty()) {
+            out = std::move(w.jobs.back());
+            w.jobs.pop_back();
+            _queued.fetch_sub(1);
+            return true;
+        }
+    }
+    // 2) injection queue
+    {
+        std::lock_guard<std::mutex> lk(_mu);
+        if (!_inject.empty()) {
+            out = std::move(_inject.front());
+            _inject.pop_front();
+            _queued.fetch_sub(1);
+            return true;
+        }
+    }
+    // 3) steal the oldest job from another worker
+    const size_t n = _workers.size();
+    for (size_t k = 1; k < n; ++k) {
+        Worker& v = *_workers[(self + k) % n];
+        std::lock_guard<std::mutex> lk(v.mu);
+        if (!v.jobs.empty()) {
+            out = std::move(v.jobs.front());
+            v.jobs.pop_front();
+            _queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::workerLoop(size_t self) {
+    tl_pool  = this;
+    tl_index = self;
+    for (;;) {
+        Job job;
+        if (tryPop(self, job)) {
+            job();
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(_mu);
+        _cv.wait(lk, [this] { return _stop || _queued.load() > 0; });
+        if (_stop && _queued.load() == 0) return;
+    }
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    schedule([task = std::move(task)] {
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "[WorkerPool] task failed: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "[WorkerPool] task failed" << std::endl;
+        }
+    });
+}
+
+void WorkerPool::runAll(std::vector<std::function<void()>> tasks) {
+    TaskGroup group(*this);
+    for (auto& t : tasks) group.run(std::move(t));
+    group.wait();
+}
+
+// --- TaskGroup ---------------------------------------------------------------
+
+TaskGroup::TaskGroup(WorkerPool& pool, CancellationToken token)
+    : _pool(pool), _st(std::make_shared<State>(std::move(token))) {}
+
+TaskGroup::~TaskGroup() {
+    if (_waited) return;
+    cancel();
+    try { wait(); } catch (...) {}
+}
+
+bool TaskGroup::State::runOne() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        if (pending.empty()) return false;
+        task = std::move(pending.front());
+        pending.pop_front();
+    }
+    if (!token.cancelled()) {
+        CancellationToken::Scope scope(token);
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(mu);
+            if (!error) error = std::current_exception();
+            token.cancel();
+        }
+    }
+    std::lock_guard<std::mutex> lk(mu);
+    if (--outstanding == 0) cv.notify_all();
+    return true;
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lk(_st->mu);
+        _st->pending.push_back(std::move(task));
+        ++_st->outstanding;
+    }
+    // the pool job is only a ticket: whoever gets there first (a worker or
+    // the waiter) runs the next pending task of this group
+    _pool.schedule([st = _st] { st->runOne(); });
+}
+
+void TaskGroup::wait() {
+    _waited = true;
+    while (_st->runOne()) {}
+    std::unique_lock<std::mutex> lk(_st->mu);
+    _st->cv.wait(lk, [this] { return _st->outstanding == 0; });
+    if (_st->error) std::rethrow_exception(_st->error);
+    lk.unlock();
+    _st->token.throwIfCancelled();
+}
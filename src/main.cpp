@@ -1,9 +1,22 @@
 #include <crow.h>
+#include <v8.h>
+#include <libplatform/libplatform.h>
 #include "SchemaManager.h"
 #include "IndexManager.h"
 #include "DBManager.h"
 #include "QueryExecutor.h"
+#include "SqlParser.h"
+#include "QueryCursor.h"
+#include "ChainStore.h"
+#include "ViewManager.h"
+#include "QueryCache.h"
+#include "ExternalSorter.h"
+#include "WorkerPool.h"
+#include "IsolatePool.h"
+#include "ScriptCache.h"
+#include "V8Convert.h"
 #include "JwtUtils.h"
+#include "CryptoUtils.h"
 #include "authmiddleware.h"
 #include "llm_mistral.h"
 #include <fstream>
@@ -13,41 +26,21 @@ using namespace v8;
 // LUC: 20210733 : ugliest of hacks
 int crow::detail::dumb_timer_queue::tick = 5;
 
-// Globals for V8
+// Globals for V8 (isolates and contexts live in IsolatePool)
 std::unique_ptr<Platform> g_platform;
-Isolate* g_isolate;
 
-// In your global scope:
-v8::Persistent<v8::Context> persistent_ctx;
+// API handlers run here, off the Crow I/O threads (sized in main())
+static std::unique_ptr<WorkerPool> g_apiPool;
+// Per-request query deadline in ms (QUARKSQL_QUERY_TIMEOUT_MS, 0 = none)
+static long g_queryTimeoutMs = 0;
 
 
-// In-process cache for require()
-static std::unordered_map<std::string, Global<Object>> moduleCache;
-
 // Load a file into a string
 static std::string LoadScript(const std::string& path) {
     std::ifstream file(path);
     return { std::istreambuf_iterator<char>(file), {} };
 }
 
-// Converts a QueryResult into a crow::json::wvalue
-inline crow::json::wvalue queryResultToJson(const QueryResult& qr) {
-    crow::json::wvalue x;
-    
-    // Fill rows[] array
-    for (size_t i = 0; i < qr.rows.size(); ++i) {
-        const auto& row = qr.rows[i];
-        crow::json::wvalue obj;
-        for (const auto& kv : row.vals) {
-            obj[kv.first] = kv.second;
-        }
-        // operator[](size_t) auto-grows into a list
-        x[i] = std::move(obj);
-    }
-   
-    return x;
-}
-
 // Initialize V8
 /*static void InitializeV8() {
     V8::InitializeICUDefaultLocation("");
@@ -103,11 +96,14 @@ static void RequireCallback(const FunctionCallbackInfo<Value>& info) {
         return;
     }
 
+    // the cache lives in the context, so snapshotted modules are found too
+    Local<Object> registry = IsolatePool::moduleRegistry(iso, ctx);
     std::string name = *String::Utf8Value(iso, info[0]);
     std::cerr << "[require] name=" << name << "\n";
-    if (moduleCache.count(name)) {
+    Local<Value> cached;
+    if (registry->Get(ctx, info[0]).ToLocal(&cached) && cached->IsObject()) {
         std::cerr << "[require] cache hit: " << name << "\n";
-        info.GetReturnValue().Set(moduleCache[name].Get(iso));
+        info.GetReturnValue().Set(cached);
         return;
     }
 
@@ -116,11 +112,10 @@ static void RequireCallback(const FunctionCallbackInfo<Value>& info) {
         std::cerr << "[require] empty source for: scripts/" << name << ".js\n";
     }
     std::string wrapped = "(function(exports, require){\n" + src + "\n})";
-    Local<String> code = String::NewFromUtf8(iso, wrapped.c_str(), NewStringType::kNormal).ToLocalChecked();
 
     TryCatch tc(iso);
     Local<Script> scr;
-    if (!Script::Compile(ctx, code).ToLocal(&scr)) {
+    if (!ScriptCache::compile(ctx, wrapped).ToLocal(&scr)) {
         String::Utf8Value emsg(iso, tc.Exception());
         std::string msg = *emsg ? *emsg : "Compile error";
         std::cerr << "[require] compile failed for: " << name << " | " << msg << "\n";
@@ -158,7 +153,7 @@ static void RequireCallback(const FunctionCallbackInfo<Value>& info) {
         return;
     }
 
-    moduleCache[name].Reset(iso, exports);
+    registry->Set(ctx, info[0], exports).FromJust();
     info.GetReturnValue().Set(exports);
     std::cerr << "[require] loaded: " << name << "\n";
 }
@@ -170,260 +165,1335 @@ static void RequireCallback(const FunctionCallbackInfo<Value>& info) {
 static void JsCppSignJwt(const v8::FunctionCallbackInfo<v8::Value>& info) {
     v8::Isolate* iso = info.GetIsolate();
     v8::HandleScope hs(iso);
-    if (info.Length() != 2 || !info[0]->IsString() || !info[1]->IsString()) {
+    if (info.Length() < 1 || info.Length() > 2 || !info[0]->IsString() ||
+        (info.Length() == 2 && !info[1]->IsString())) {
         iso->ThrowException(
           v8::String::NewFromUtf8(iso,
-            "CppSignJwt(payloadJson, secret) requires two strings",
+            "CppSignJwt(payloadJson[, secret]) requires strings",
             v8::NewStringType::kNormal).ToLocalChecked());
         return;
     }
     v8::String::Utf8Value pj(iso, info[0]);  
-    v8::String::Utf8Value sk(iso, info[1]);
+    // no secret: the server's (QUARKSQL_JWT_SECRET)
+    std::string secret = info.Length() == 2 ? *v8::String::Utf8Value(iso, info[1])
+                                            : JwtVerifier::instance().secret();
+    try {
+        std::string token = CppSignJwt(std::string(*pj), secret);
+        info.GetReturnValue().Set(
+          v8::String::NewFromUtf8(iso, token.c_str(),
+            v8::NewStringType::kNormal).ToLocalChecked());
+    } catch (const std::exception& e) {
+        iso->ThrowException(
+          v8::String::NewFromUtf8(iso, e.what(),
+            v8::NewStringType::kNormal).ToLocalChecked());
+    }
+}
+
+static void JsCppVerifyJwt(const v8::FunctionCallbackInfo<v8::Value>& info) {
+    v8::Isolate* iso = info.GetIsolate();
+    v8::HandleScope hs(iso);
+    if (info.Length() < 1 || info.Length() > 2 || !info[0]->IsString() ||
+        (info.Length() == 2 && !info[1]->IsString())) {
+        iso->ThrowException(
+          v8::String::NewFromUtf8(iso,
+            "CppVerifyJwt(token[, secret]) requires strings",
+            v8::NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+    v8::String::Utf8Value tk(iso, info[0]);
+    try {
+        // tokens under the server secret go through the cached verifier
+        std::string payload;
+        if (info.Length() == 1 || *v8::String::Utf8Value(iso, info[1]) == JwtVerifier::instance().secret())
+            payload = JwtVerifier::instance().verify(std::string(*tk));
+        else
+            payload = CppVerifyJwt(std::string(*tk), *v8::String::Utf8Value(iso, info[1]));
+        info.GetReturnValue().Set(
+          v8::String::NewFromUtf8(iso, payload.c_str(),
+            v8::NewStringType::kNormal).ToLocalChecked());
+    } catch (const std::exception& e) {
+        iso->ThrowException(
+          v8::String::NewFromUtf8(iso, e.what(),
+            v8::NewStringType::kNormal).ToLocalChecked());
+    }
+}
+
+// -----------------------------------------------------------------------------
+// 2) The binding function
+// -----------------------------------------------------------------------------
+static void BindJwtUtils(v8::Isolate* iso, v8::Local<v8::Context> ctx) {
+    using namespace v8;
+
+    // CppSignJwt
+    Local<FunctionTemplate> signTpl = FunctionTemplate::New(iso, JsCppSignJwt);
+    Local<Function> signFn = signTpl->GetFunction(ctx).ToLocalChecked();
+    ctx->Global()
+       ->Set(ctx,
+             String::NewFromUtf8(iso, "CppSignJwt", NewStringType::kNormal)
+                 .ToLocalChecked(),
+             signFn)
+       .FromJust();
+
+    // CppVerifyJwt
+    Local<FunctionTemplate> verifyTpl = FunctionTemplate::New(iso, JsCppVerifyJwt);
+    Local<Function> verifyFn = verifyTpl->GetFunction(ctx).ToLocalChecked();
+    ctx->Global()
+       ->Set(ctx,
+             String::NewFromUtf8(iso, "CppVerifyJwt", NewStringType::kNormal)
+                 .ToLocalChecked(),
+             verifyFn)
+       .FromJust();
+}
+
+// crypto bindings (OpenSSL): CppSha256, CppPbkdf2, CppScrypt, CppRandomId
+// -----------------------------------------------------------------------------
+static void ThrowJs(Isolate* iso, const char* msg) {
+    iso->ThrowException(String::NewFromUtf8(iso, msg, NewStringType::kNormal).ToLocalChecked());
+}
+
+static void ReturnString(const FunctionCallbackInfo<Value>& info, const std::string& s) {
+    info.GetReturnValue().Set(
+        String::NewFromUtf8(info.GetIsolate(), s.data(), NewStringType::kNormal, (int)s.size()).ToLocalChecked());
+}
+
+// CppSha256(str) -> hex digest of the UTF-8 bytes
+static void JsCppSha256(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (info.Length() != 1 || !info[0]->IsString()) {
+        ThrowJs(iso, "CppSha256(data) requires a string");
+        return;
+    }
+    ReturnString(info, CppSha256(*String::Utf8Value(iso, info[0])));
+}
+
+// CppPbkdf2(password, salt[, iterations]) -> hex key
+static void JsCppPbkdf2(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsString()) {
+        ThrowJs(iso, "CppPbkdf2(password, salt[, iterations]) requires two strings");
+        return;
+    }
+    uint32_t iterations = 100000;
+    if (info.Length() >= 3 && info[2]->IsNumber())
+        iterations = info[2]->Uint32Value(iso->GetCurrentContext()).FromMaybe(0);
+    try {
+        ReturnString(info, CppPbkdf2(*String::Utf8Value(iso, info[0]), *String::Utf8Value(iso, info[1]), iterations));
+    } catch (const std::exception& e) {
+        ThrowJs(iso, e.what());
+    }
+}
+
+// CppScrypt(password, salt[, N, r, p]) -> hex key
+static void JsCppScrypt(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+    if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsString()) {
+        ThrowJs(iso, "CppScrypt(password, salt[, N, r, p]) requires two strings");
+        return;
+    }
+    auto num = [&](int i, uint64_t def) -> uint64_t {
+        if (info.Length() <= i || !info[i]->IsNumber()) return def;
+        double d = info[i]->NumberValue(ctx).FromMaybe(0);
+        return d >= 1 ? (uint64_t)d : def;
+    };
+    try {
+        ReturnString(info, CppScrypt(*String::Utf8Value(iso, info[0]), *String::Utf8Value(iso, info[1]),
+                                     num(2, 16384), num(3, 8), num(4, 1)));
+    } catch (const std::exception& e) {
+        ThrowJs(iso, e.what());
+    }
+}
+
+// CppRandomId([len]) -> [a-zA-Z0-9]{len}, CSPRNG
+static void JsCppRandomId(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    uint32_t len = 16;
+    if (info.Length() >= 1 && info[0]->IsNumber())
+        len = info[0]->Uint32Value(iso->GetCurrentContext()).FromMaybe(16);
+    if (len == 0 || len > 4096) {
+        ThrowJs(iso, "CppRandomId(len): len must be 1..4096");
+        return;
+    }
+    try {
+        ReturnString(info, CppRandomId(len));
+    } catch (const std::exception& e) {
+        ThrowJs(iso, e.what());
+    }
+}
+
+static void BindCryptoUtils(Isolate* iso, Local<Context> ctx) {
+    struct { const char* name; FunctionCallback fn; } fns[] = {
+        { "CppSha256",   JsCppSha256 },
+        { "CppPbkdf2",   JsCppPbkdf2 },
+        { "CppScrypt",   JsCppScrypt },
+        { "CppRandomId", JsCppRandomId },
+    };
+    for (const auto& f : fns) {
+        Local<Function> fn = FunctionTemplate::New(iso, f.fn)->GetFunction(ctx).ToLocalChecked();
+        ctx->Global()
+           ->Set(ctx, String::NewFromUtf8(iso, f.name, NewStringType::kNormal).ToLocalChecked(), fn)
+           .FromJust();
+    }
+}
+
+///
+
+static void BindRequire(Isolate* iso, Local<Context> ctx) {
+    Local<FunctionTemplate> tpl = FunctionTemplate::New(iso, RequireCallback);
+    Local<Function> requireFn = tpl->GetFunction(ctx).ToLocalChecked();
+    Maybe<bool> ok = ctx->Global()
+       ->Set(ctx,
+             String::NewFromUtf8(iso, "require", NewStringType::kNormal).ToLocalChecked(),
+             requireFn);
+       
+}
+
+//----------------------------------------------
+// 2) db.query / db.execute bindings
+//----------------------------------------------
+
+// optional result shape argument: "rows" or {shape: "rows"}; false (with a
+// pending exception) if it is invalid
+static bool ParseShapeArg(Isolate* iso, Local<Context> ctx, Local<Value> sv,
+                          V8Convert::Shape& shape) {
+    shape = V8Convert::Shape::Objects;
+    if (sv->IsUndefined()) return true;
+    if (sv->IsObject()) {
+        if (!sv.As<Object>()->Get(ctx, String::NewFromUtf8(iso, "shape", NewStringType::kNormal).ToLocalChecked()).ToLocal(&sv))
+            return false;
+    }
+    if (!sv->IsUndefined() && !V8Convert::parseShape(*String::Utf8Value(iso, sv), shape)) {
+        iso->ThrowException(String::NewFromUtf8(iso, "db.query: shape must be 'objects', 'rows' or 'columns'", NewStringType::kNormal).ToLocalChecked());
+        return false;
+    }
+    return true;
+}
+
+// array of SQL strings -> out; false (with a pending exception) otherwise
+static bool ReadSqlArray(Isolate* iso, Local<Context> ctx, Local<Value> v,
+                         const char* usage, std::vector<std::string>& out) {
+    if (!v->IsArray()) {
+        iso->ThrowException(String::NewFromUtf8(iso, usage, NewStringType::kNormal).ToLocalChecked());
+        return false;
+    }
+    Local<Array> arr = v.As<Array>();
+    out.reserve(arr->Length());
+    for (uint32_t i = 0; i < arr->Length(); ++i) {
+        Local<Value> e;
+        if (!arr->Get(ctx, i).ToLocal(&e)) return false;
+        if (!e->IsString()) {
+            iso->ThrowException(String::NewFromUtf8(iso, usage, NewStringType::kNormal).ToLocalChecked());
+            return false;
+        }
+        out.emplace_back(*String::Utf8Value(iso, e));
+    }
+    return true;
+}
+
+static void JsDbQuery(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+
+    if (info.Length()<1 || !info[0]->IsString()) {
+        iso->ThrowException(String::NewFromUtf8(iso,"db.query(sql[, shape]) requires string",NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+    std::string sql = *String::Utf8Value(iso, info[0]);
+
+    // optional result shape: db.query(sql, "rows") or db.query(sql, {shape: "rows"})
+    V8Convert::Shape shape;
+    if (!ParseShapeArg(iso, ctx, info.Length() >= 2 ? info[1] : Undefined(iso).As<Value>(), shape))
+        return;
+
+    //auto q = SqlParser::parse(sql);
+    QueryResult r;
+    try {
+        QueryExecutor::execute(sql, r);
+    } catch (const std::exception& e) {
+        iso->ThrowException(String::NewFromUtf8(iso, e.what(), NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+    info.GetReturnValue().Set(V8Convert::toV8(iso, ctx, r, shape));
+}
+
+// db.page(sql[, shape]) -> {rows, next}
+// One keyset page: rows as db.query returns them, and next, the cursor to
+// pass as AFTER '<next>' for the following page (null after the last one).
+static void JsDbPage(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+
+    if (info.Length()<1 || !info[0]->IsString()) {
+        ThrowJs(iso, "db.page(sql[, shape]) requires string");
+        return;
+    }
+    std::string sql = *String::Utf8Value(iso, info[0]);
+    V8Convert::Shape shape;
+    if (!ParseShapeArg(iso, ctx, info.Length() >= 2 ? info[1] : Undefined(iso).As<Value>(), shape))
+        return;
+
+    QueryResult r;
+    try {
+        Query q = SqlParser::parse(sql);
+        q.keyset = true;   // a first page (no AFTER) hands out its cursor too
+        QueryExecutor::execute(q, r);
+    } catch (const std::exception& e) {
+        ThrowJs(iso, e.what());
+        return;
+    }
+    Local<Object> obj = Object::New(iso);
+    obj->Set(ctx, String::NewFromUtf8(iso, "rows", NewStringType::kNormal).ToLocalChecked(),
+             V8Convert::toV8(iso, ctx, r, shape)).FromJust();
+    obj->Set(ctx, String::NewFromUtf8(iso, "next", NewStringType::kNormal).ToLocalChecked(),
+             r.next.empty() ? Null(iso).As<Value>()
+                            : String::NewFromUtf8(iso, r.next.c_str(), NewStringType::kNormal).ToLocalChecked().As<Value>()).FromJust();
+    info.GetReturnValue().Set(obj);
+}
+
+static void JsDbExecute(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+
+    if (info.Length()<1 || !info[0]->IsString()) {
+        iso->ThrowException(String::NewFromUtf8(iso,"db.execute(sql) requires string",NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+    std::string sql = *String::Utf8Value(iso, info[0]);
+    try {
+        //auto q = SqlParser::parse(sql);
+        QueryResult r;
+		QueryExecutor::execute(sql, r);
+        Local<Object> obj = Object::New(iso);
+        Maybe<bool> ok = obj->Set(ctx,
+                 String::NewFromUtf8(iso,"success",NewStringType::kNormal).ToLocalChecked(),
+                 Boolean::New(iso,true));
+        info.GetReturnValue().Set(obj);
+    } catch (const std::exception& e) {
+        Local<Object> obj = Object::New(iso);
+        Maybe<bool> ok = obj->Set(ctx,
+                 String::NewFromUtf8(iso,"success",NewStringType::kNormal).ToLocalChecked(),
+                 Boolean::New(iso,false));
+                 
+        Maybe<bool> err = obj->Set(ctx,
+                 String::NewFromUtf8(iso,"error",NewStringType::kNormal).ToLocalChecked(),
+                 String::NewFromUtf8(iso,e.what(),NewStringType::kNormal).ToLocalChecked());
+
+        info.GetReturnValue().Set(obj);
+    }
+}
+
+// db.queryMany([sql, ...][, shape]) -> [result, ...]
+// All statements are parsed before any runs, then run concurrently on the
+// worker pool; identical statements run once. One failure throws.
+static void JsDbQueryMany(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+
+    std::vector<std::string> sqls;
+    if (!ReadSqlArray(iso, ctx, info.Length() >= 1 ? info[0] : Undefined(iso).As<Value>(),
+                      "db.queryMany([sql, ...][, shape]) requires an array of strings", sqls))
+        return;
+    V8Convert::Shape shape;
+    if (!ParseShapeArg(iso, ctx, info.Length() >= 2 ? info[1] : Undefined(iso).As<Value>(), shape))
+        return;
+
+    std::vector<Query>       queries;
+    std::vector<size_t>      slot(sqls.size());   // statement -> queries index
+    std::unordered_map<std::string, size_t> seen;
+    std::vector<QueryResult> results;
+    try {
+        for (size_t i = 0; i < sqls.size(); ++i) {
+            auto it = seen.find(sqls[i]);
+            if (it != seen.end()) { slot[i] = it->second; continue; }
+            Query q = SqlParser::parse(sqls[i]);
+            if (q.type != QueryType::SELECT)
+                throw std::runtime_error("db.queryMany: not a SELECT: " + sqls[i]);
+            slot[i] = seen[sqls[i]] = queries.size();
+            queries.push_back(std::move(q));
+        }
+        results.resize(queries.size());
+        if (queries.size() == 1) {
+            QueryExecutor::execute(queries[0], results[0]);
+        } else {
+            std::vector<std::function<void()>> tasks;
+            for (size_t i = 0; i < queries.size(); ++i)
+                tasks.push_back([&queries, &results, i] { QueryExecutor::execute(queries[i], results[i]); });
+            WorkerPool::shared().runAll(std::move(tasks));
+        }
+    } catch (const std::exception& e) {
+        iso->ThrowException(String::NewFromUtf8(iso, e.what(), NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+
+    Local<Array> out = Array::New(iso, (int)sqls.size());
+    for (size_t i = 0; i < sqls.size(); ++i)
+        out->Set(ctx, (uint32_t)i, V8Convert::toV8(iso, ctx, results[slot[i]], shape)).FromJust();
+    info.GetReturnValue().Set(out);
+}
+
+// db.executeBatch([sql, ...]) -> {success, affected: [n, ...]} or
+// {success: false, error, index}
+// Parsed up front, run in order in one DBManager::Batch and committed
+// atomically: either every statement's writes land or none do. Inside
+// db.transaction() the statements become part of that transaction instead.
+static void JsDbExecuteBatch(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+
+    std::vector<std::string> sqls;
+    if (!ReadSqlArray(iso, ctx, info.Length() >= 1 ? info[0] : Undefined(iso).As<Value>(),
+                      "db.executeBatch([sql, ...]) requires an array of strings", sqls))
+        return;
+
+    auto str = [iso](const char* s) {
+        return String::NewFromUtf8(iso, s, NewStringType::kNormal).ToLocalChecked();
+    };
+    Local<Object> obj = Object::New(iso);
+    size_t at = 0;
+    try {
+        std::vector<Query> queries;
+        queries.reserve(sqls.size());
+        for (; at < sqls.size(); ++at) {
+            queries.push_back(SqlParser::parse(sqls[at]));
+            if (queries.back().type == QueryType::SELECT)
+                throw std::runtime_error("db.executeBatch: SELECT is not allowed");
+        }
+        std::vector<int> affected(queries.size(), 0);
+        std::unique_ptr<DBManager::Batch> batch;
+        if (!DBManager::inScope()) batch.reset(new DBManager::Batch());
+        for (at = 0; at < queries.size(); ++at) {
+            QueryResult r;
+            QueryExecutor::execute(queries[at], r);
+            affected[at] = r.affected;
+        }
+        if (batch) batch->commit();
+
+        Local<Array> arr = Array::New(iso, (int)affected.size());
+        for (size_t i = 0; i < affected.size(); ++i)
+            arr->Set(ctx, (uint32_t)i, Integer::New(iso, affected[i])).FromJust();
+        obj->Set(ctx, str("success"), Boolean::New(iso, true)).FromJust();
+        obj->Set(ctx, str("affected"), arr).FromJust();
+    } catch (const std::exception& e) {
+        obj->Set(ctx, str("success"), Boolean::New(iso, false)).FromJust();
+        obj->Set(ctx, str("error"), str(e.what())).FromJust();
+        if (at < sqls.size())
+            obj->Set(ctx, str("index"), Integer::New(iso, (int)at)).FromJust();
+    }
+    info.GetReturnValue().Set(obj);
+}
+
+// db.queryAsync(sql[, shape]) / db.executeAsync(sql) -> Promise
+// The statement runs on the worker pool while JS goes on; the promise is
+// settled on the isolate's thread when the request loop picks up the
+// completion (IsolatePool::runPosted). queryAsync rejects where db.query
+// would throw; executeAsync resolves with db.execute's {success[, error]}.
+// Inside db.transaction() they run synchronously, so writes stay in the
+// transaction.
+struct AsyncDbOp {
+    Global<Promise::Resolver> resolver;
+    std::string               sql;
+    bool                      isExecute = false;
+    V8Convert::Shape          shape = V8Convert::Shape::Objects;
+    QueryResult               result;
+    bool                      failed = false;
+    std::string               error;
+};
+
+static void RunAsyncDbOp(AsyncDbOp& op) {
+    try {
+        Query q = SqlParser::parse(op.sql);
+        if (q.type == QueryType::SELECT && op.isExecute)
+            throw std::runtime_error("db.executeAsync: use db.queryAsync for SELECT");
+        QueryExecutor::execute(q, op.result);
+    } catch (const std::exception& e) {
+        op.failed = true;
+        op.error  = e.what();
+    }
+}
+
+static void SettleAsyncDbOp(Isolate* iso, AsyncDbOp& op) {
+    Local<Context> ctx = iso->GetCurrentContext();
+    Local<Promise::Resolver> res = op.resolver.Get(iso);
+    op.resolver.Reset();
+    auto str = [iso](const std::string& s) {
+        return String::NewFromUtf8(iso, s.c_str(), NewStringType::kNormal).ToLocalChecked();
+    };
+    if (op.isExecute) {
+        Local<Object> obj = Object::New(iso);
+        obj->Set(ctx, str("success"), Boolean::New(iso, !op.failed)).FromJust();
+        if (op.failed) obj->Set(ctx, str("error"), str(op.error)).FromJust();
+        res->Resolve(ctx, obj).FromJust();
+    } else if (op.failed) {
+        res->Reject(ctx, Exception::Error(str(op.error))).FromJust();
+    } else {
+        res->Resolve(ctx, V8Convert::toV8(iso, ctx, op.result, op.shape)).FromJust();
+    }
+}
+
+static void StartAsyncDbOp(const FunctionCallbackInfo<Value>& info, bool isExecute) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+
+    if (info.Length() < 1 || !info[0]->IsString()) {
+        ThrowJs(iso, isExecute ? "db.executeAsync(sql) requires string"
+                               : "db.queryAsync(sql[, shape]) requires string");
+        return;
+    }
+    auto op = std::make_shared<AsyncDbOp>();
+    op->sql = *String::Utf8Value(iso, info[0]);
+    op->isExecute = isExecute;
+    if (!isExecute &&
+        !ParseShapeArg(iso, ctx, info.Length() >= 2 ? info[1] : Undefined(iso).As<Value>(), op->shape))
+        return;
+
+    Local<Promise::Resolver> res;
+    if (!Promise::Resolver::New(ctx).ToLocal(&res)) return;
+    op->resolver.Reset(iso, res);
+    info.GetReturnValue().Set(res->GetPromise());
+
+    IsolatePool::Slot* slot = IsolatePool::slot(iso);
+    if (!slot || DBManager::inScope()) {
+        RunAsyncDbOp(*op);
+        SettleAsyncDbOp(iso, *op);
+        return;
+    }
+    IsolatePool::beginAsync(*slot);
+    WorkerPool::shared().submit([op, slot, tok = CancellationToken::current()] {
+        {
+            CancellationToken::Scope scope(tok);
+            RunAsyncDbOp(*op);
+        }
+        IsolatePool::post(*slot, [op, slot] { SettleAsyncDbOp(slot->isolate, *op); });
+    });
+}
+
+static void JsDbQueryAsync(const FunctionCallbackInfo<Value>& info)   { StartAsyncDbOp(info, false); }
+static void JsDbExecuteAsync(const FunctionCallbackInfo<Value>& info) { StartAsyncDbOp(info, true); }
+
+// db.cursor(sql[, shape]) -> {next(batchSize), close()}
+// next(n) (default 1000) returns the next batch in the given result shape;
+// an empty batch means the end, at which point the cursor's RocksDB
+// snapshot is released. Cursors dropped without close() are freed by GC.
+struct JsCursor {
+    Global<Object>               handle;
+    std::unique_ptr<QueryCursor> cursor;
+    V8Convert::Shape             shape = V8Convert::Shape::Objects;
+};
+
+static JsCursor* CursorOf(const FunctionCallbackInfo<Value>& info) {
+    Local<Object> self = info.This();
+    if (self->InternalFieldCount() < 1) return nullptr;
+    return static_cast<JsCursor*>(self->GetAlignedPointerFromInternalField(0));
+}
+
+static void JsCursorNext(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+    JsCursor* c = CursorOf(info);
+    if (!c) { ThrowJs(iso, "cursor.next: not a cursor"); return; }
+
+    size_t n = 1000;
+    if (info.Length() >= 1 && info[0]->IsNumber()) {
+        double v = info[0].As<Number>()->Value();
+        n = v >= 1 ? (size_t)v : 1;
+    }
+    QueryResult r;
+    try {
+        c->cursor->next(n, r);
+        if (r.rows.empty()) c->cursor->close();
+    } catch (const std::exception& e) {
+        ThrowJs(iso, e.what());
+        return;
+    }
+    info.GetReturnValue().Set(V8Convert::toV8(iso, ctx, r, c->shape));
+}
+
+static void JsCursorClose(const FunctionCallbackInfo<Value>& info) {
+    if (JsCursor* c = CursorOf(info)) c->cursor->close();
+}
+
+static void JsDbCursor(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+
+    if (info.Length() < 1 || !info[0]->IsString()) {
+        ThrowJs(iso, "db.cursor(sql[, shape]) requires string");
+        return;
+    }
+    std::unique_ptr<JsCursor> c(new JsCursor());
+    if (!ParseShapeArg(iso, ctx, info.Length() >= 2 ? info[1] : Undefined(iso).As<Value>(), c->shape))
+        return;
+    try {
+        c->cursor.reset(new QueryCursor(*String::Utf8Value(iso, info[0])));
+    } catch (const std::exception& e) {
+        ThrowJs(iso, e.what());
+        return;
+    }
+
+    Local<ObjectTemplate> tpl = ObjectTemplate::New(iso);
+    tpl->SetInternalFieldCount(1);
+    tpl->Set(String::NewFromUtf8(iso, "next", NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsCursorNext));
+    tpl->Set(String::NewFromUtf8(iso, "close", NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsCursorClose));
+    Local<Object> obj;
+    if (!tpl->NewInstance(ctx).ToLocal(&obj)) return;
+
+    obj->SetAlignedPointerInInternalField(0, c.get());
+    c->handle.Reset(iso, obj);
+    c->handle.SetWeak(c.get(), [](const WeakCallbackInfo<JsCursor>& data) {
+        JsCursor* dead = data.GetParameter();
+        dead->handle.Reset();
+        delete dead;
+    }, WeakCallbackType::kParameter);
+    c.release();
+    info.GetReturnValue().Set(obj);
+}
+
+// db.transaction(fn[, {retries}]) -> fn's return value
+// Runs fn(db) with every db write on this thread buffered in one optimistic
+// DBManager::Transaction and commits once. On a write conflict fn is run
+// again in a fresh transaction (up to `retries` more times, default 5), so
+// it must not have side effects outside the database. If fn throws, its
+// writes are rolled back and the exception propagates. Nested calls join
+// the outer transaction.
+static void JsDbTransaction(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+
+    if (info.Length() < 1 || !info[0]->IsFunction()) {
+        ThrowJs(iso, "db.transaction(fn[, {retries}]) requires a function");
+        return;
+    }
+    Local<Function> fn = info[0].As<Function>();
+    Local<Value> argv[1] = { info.This() };
+    if (DBManager::inScope()) {
+        Local<Value> rv;
+        if (fn->Call(ctx, info.This(), 1, argv).ToLocal(&rv)) info.GetReturnValue().Set(rv);
+        return;
+    }
+
+    int retries = 5;
+    if (info.Length() >= 2 && info[1]->IsObject()) {
+        Local<Value> rv;
+        if (!info[1].As<Object>()->Get(ctx, String::NewFromUtf8(iso, "retries", NewStringType::kNormal).ToLocalChecked()).ToLocal(&rv))
+            return;
+        if (rv->IsNumber()) retries = std::max(0, (int)rv.As<Number>()->Value());
+    }
+
+    for (int attempt = 0; attempt <= retries; ++attempt) {
+        try {
+            DBManager::Transaction tx;
+            Local<Value> rv;
+            if (!fn->Call(ctx, info.This(), 1, argv).ToLocal(&rv))
+                return;   // fn threw: tx rolls back, the exception propagates
+            if (tx.commit()) {
+                info.GetReturnValue().Set(rv);
+                return;
+            }
+        } catch (const std::exception& e) {
+            ThrowJs(iso, e.what());
+            return;
+        }
+    }
+    ThrowJs(iso, "db.transaction: gave up after repeated write conflicts");
+}
+
+// Keys and values cross the boundary without Utf8Value copies: arguments are
+// written straight into per-thread scratch buffers, and values come back
+// from a PinnableSlice (ASCII as one-byte strings, large ASCII values as
+// external strings that keep the pinned RocksDB buffer instead of copying).
+static rocksdb::Slice KvArg(Isolate* iso, Local<Value> v, std::string& buf) {
+    Local<String> s = v.As<String>();
+    size_t need = (size_t)s->Length() * 3;
+    if (buf.size() < need) buf.resize(need);
+    int n = s->WriteUtf8(iso, &buf[0], (int)need, nullptr,
+                         String::NO_NULL_TERMINATION | String::REPLACE_INVALID_UTF8);
+    return rocksdb::Slice(buf.data(), (size_t)n);
+}
+
+class PinnedOneByteString : public String::ExternalOneByteStringResource {
+public:
+    rocksdb::PinnableSlice slice;
+    const char* data() const override { return slice.data(); }
+    size_t length() const override { return slice.size(); }
+};
+
+static const size_t kKvExternalMin = 64 * 1024;   // smaller values are just copied
+
+static bool IsAscii(const char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        if ((unsigned char)p[i] & 0x80) return false;
+    return true;
+}
+
+static Local<String> KvValue(Isolate* iso, const char* p, size_t n) {
+    if (IsAscii(p, n))
+        return String::NewFromOneByte(iso, reinterpret_cast<const uint8_t*>(p), NewStringType::kNormal, (int)n).ToLocalChecked();
+    return String::NewFromUtf8(iso, p, NewStringType::kNormal, (int)n).ToLocalChecked();
+}
+
+// "" when the key is missing (as before)
+static void KvGet(const FunctionCallbackInfo<Value>& info, rocksdb::ColumnFamilyHandle* h, Local<Value> keyArg) {
+    Isolate* iso = info.GetIsolate();
+    static thread_local std::string kbuf;
+    rocksdb::Slice key = KvArg(iso, keyArg, kbuf);
+
+    std::unique_ptr<PinnedOneByteString> res(new PinnedOneByteString());
+    auto s = DBManager::instance().db()->Get(rocksdb::ReadOptions(), h, key, &res->slice);
+    if (!s.ok()) { info.GetReturnValue().SetEmptyString(); return; }
+    if (res->slice.size() >= kKvExternalMin && IsAscii(res->slice.data(), res->slice.size())) {
+        Local<String> str;
+        if (String::NewExternalOneByte(iso, res.get()).ToLocal(&str)) {
+            res.release();   // owned by V8 now
+            info.GetReturnValue().Set(str);
+            return;
+        }
+    }
+    info.GetReturnValue().Set(KvValue(iso, res->slice.data(), res->slice.size()));
+}
+
+static void KvPut(const FunctionCallbackInfo<Value>& info, rocksdb::ColumnFamilyHandle* h, Local<Value> keyArg, Local<Value> valArg) {
+    Isolate* iso = info.GetIsolate();
+    static thread_local std::string kbuf, vbuf;
+    rocksdb::Slice key = KvArg(iso, keyArg, kbuf);
+    rocksdb::Slice val = KvArg(iso, valArg, vbuf);
+    auto s = DBManager::instance().db()->Put(rocksdb::WriteOptions(), h, key, val);
+    if (s.ok()) DBManager::instance().bumpVersion(h->GetName());   // may be a table
+    info.GetReturnValue().Set(s.ok());
+}
+
+static void KvDel(const FunctionCallbackInfo<Value>& info, rocksdb::ColumnFamilyHandle* h, Local<Value> keyArg) {
+    Isolate* iso = info.GetIsolate();
+    static thread_local std::string kbuf;
+    rocksdb::Slice key = KvArg(iso, keyArg, kbuf);
+    auto s = DBManager::instance().db()->Delete(rocksdb::WriteOptions(), h, key);
+    if (s.ok()) DBManager::instance().bumpVersion(h->GetName());
+    info.GetReturnValue().Set(s.ok());
+}
+
+static void KvKeys(const FunctionCallbackInfo<Value>& info, rocksdb::ColumnFamilyHandle* h, Local<Value> prefixArg) {
+    Isolate* iso = info.GetIsolate();
+    Local<Context> ctx = iso->GetCurrentContext();
+    std::string pbuf;
+    rocksdb::Slice prefix = prefixArg->IsString() ? KvArg(iso, prefixArg, pbuf) : rocksdb::Slice();
+    auto it = std::unique_ptr<rocksdb::Iterator>(DBManager::instance().db()->NewIterator(rocksdb::ReadOptions(), h));
+    Local<Array> arr = Array::New(iso);
+    uint32_t idx = 0;
+    if (prefix.empty()) it->SeekToFirst(); else it->Seek(prefix);
+    for (; it->Valid(); it->Next()) {
+        rocksdb::Slice k = it->key();
+        if (!prefix.empty() && !k.starts_with(prefix)) break;
+        arr->Set(ctx, idx++, KvValue(iso, k.data(), k.size())).FromJust();
+    }
+    info.GetReturnValue().Set(arr);
+}
+
+// One page of a key range. opts: {start, end, prefix, after, limit, reverse,
+// values}. start is inclusive and end exclusive; prefix narrows both; after
+// resumes behind a key returned before (the `next` of the previous page).
+// Returns {keys, values (unless values:false), next} where next is null
+// after the last page.
+static bool KvScanOpt(Isolate* iso, Local<Context> ctx, Local<Object> o, const char* name, Local<Value>& out) {
+    return o->Get(ctx, String::NewFromUtf8(iso, name, NewStringType::kNormal).ToLocalChecked()).ToLocal(&out);
+}
+
+static void KvScan(const FunctionCallbackInfo<Value>& info, rocksdb::ColumnFamilyHandle* h, Local<Value> optsArg) {
+    Isolate* iso = info.GetIsolate();
+    Local<Context> ctx = iso->GetCurrentContext();
+
+    std::string lower, upper, after, prefix;
+    bool hasUpper = false, hasAfter = false, reverse = false, values = true;
+    uint32_t limit = 1000;
+    if (optsArg->IsObject()) {
+        Local<Object> o = optsArg.As<Object>();
+        Local<Value> v;
+        if (!KvScanOpt(iso, ctx, o, "start", v)) return;
+        if (v->IsString()) lower = *String::Utf8Value(iso, v);
+        if (!KvScanOpt(iso, ctx, o, "end", v)) return;
+        if (v->IsString()) { upper = *String::Utf8Value(iso, v); hasUpper = true; }
+        if (!KvScanOpt(iso, ctx, o, "prefix", v)) return;
+        if (v->IsString()) prefix = *String::Utf8Value(iso, v);
+        if (!KvScanOpt(iso, ctx, o, "after", v)) return;
+        if (v->IsString()) { after = *String::Utf8Value(iso, v); hasAfter = true; }
+        if (!KvScanOpt(iso, ctx, o, "limit", v)) return;
+        if (v->IsNumber()) limit = (uint32_t)std::max(1.0, v.As<Number>()->Value());
+        if (!KvScanOpt(iso, ctx, o, "reverse", v)) return;
+        reverse = v->BooleanValue(iso);
+        if (!KvScanOpt(iso, ctx, o, "values", v)) return;
+        if (!v->IsUndefined()) values = v->BooleanValue(iso);
+    }
+    if (!prefix.empty()) {
+        if (prefix > lower) lower = prefix;
+        // smallest key above every key with the prefix, if any
+        std::string succ = prefix;
+        while (!succ.empty() && (unsigned char)succ.back() == 0xff) succ.pop_back();
+        if (!succ.empty()) {
+            succ.back() = (char)((unsigned char)succ.back() + 1);
+            if (!hasUpper || succ < upper) { upper = succ; hasUpper = true; }
+        }
+    }
+
+    std::unique_ptr<rocksdb::Iterator> it(DBManager::instance().db()->NewIterator(rocksdb::ReadOptions(), h));
+    if (!reverse) {
+        const std::string& from = (hasAfter && after > lower) ? after : lower;
+        it->Seek(from);
+        if (hasAfter && it->Valid() && it->key() == rocksdb::Slice(after)) it->Next();
+    } else {
+        if (hasAfter && (!hasUpper || after < upper)) {
+            it->SeekForPrev(after);
+            if (it->Valid() && it->key() == rocksdb::Slice(after)) it->Prev();
+        } else if (hasUpper) {
+            it->Seek(upper);
+            if (it->Valid()) it->Prev(); else it->SeekToLast();
+        } else {
+            it->SeekToLast();
+        }
+    }
+
+    Local<Array> keys = Array::New(iso);
+    Local<Array> vals = Array::New(iso);
+    uint32_t n = 0;
+    bool more = false;
+    for (; it->Valid(); reverse ? it->Prev() : it->Next()) {
+        rocksdb::Slice k = it->key();
+        if (reverse ? k.compare(lower) < 0 : (hasUpper && k.compare(upper) >= 0)) break;
+        if (reverse && hasUpper && k.compare(upper) >= 0) continue;
+        if (n == limit) { more = true; break; }
+        keys->Set(ctx, n, KvValue(iso, k.data(), k.size())).FromJust();
+        if (values) {
+            rocksdb::Slice v = it->value();
+            vals->Set(ctx, n, KvValue(iso, v.data(), v.size())).FromJust();
+        }
+        ++n;
+    }
+
+    auto str = [iso](const char* s) {
+        return String::NewFromUtf8(iso, s, NewStringType::kNormal).ToLocalChecked();
+    };
+    Local<Object> out = Object::New(iso);
+    out->Set(ctx, str("keys"), keys).FromJust();
+    if (values) out->Set(ctx, str("values"), vals).FromJust();
+    Local<Value> next = Null(iso);
+    if (more && n > 0) keys->Get(ctx, n - 1).ToLocal(&next);
+    out->Set(ctx, str("next"), next).FromJust();
+    info.GetReturnValue().Set(out);
+}
+
+// values of many keys in one rocksdb MultiGet; "" for missing keys
+static void KvMultiGet(const FunctionCallbackInfo<Value>& info, rocksdb::ColumnFamilyHandle* h, Local<Value> keysArg) {
+    Isolate* iso = info.GetIsolate();
+    Local<Context> ctx = iso->GetCurrentContext();
+    if (!keysArg->IsArray()) { ThrowJs(iso, "multiGet(keys) requires an array of strings"); return; }
+    Local<Array> arr = keysArg.As<Array>();
+    const uint32_t n = arr->Length();
+
+    std::vector<std::string> keys(n);
+    std::vector<rocksdb::Slice> slices(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        Local<Value> k;
+        if (!arr->Get(ctx, i).ToLocal(&k)) return;
+        if (!k->IsString()) { ThrowJs(iso, "multiGet(keys) requires an array of strings"); return; }
+        rocksdb::Slice s = KvArg(iso, k, keys[i]);
+        keys[i].resize(s.size());
+        slices[i] = rocksdb::Slice(keys[i]);
+    }
+    std::vector<rocksdb::PinnableSlice> vals(n);
+    std::vector<rocksdb::Status> st(n);
+    if (n) DBManager::instance().db()->MultiGet(rocksdb::ReadOptions(), h, n, slices.data(), vals.data(), st.data());
+
+    Local<Array> out = Array::New(iso, (int)n);
+    for (uint32_t i = 0; i < n; ++i) {
+        Local<Value> v = st[i].ok() ? KvValue(iso, vals[i].data(), vals[i].size()).As<Value>()
+                                    : String::Empty(iso).As<Value>();
+        out->Set(ctx, i, v).FromJust();
+    }
+    info.GetReturnValue().Set(out);
+}
+
+// column family named by a string argument, or null (with an exception)
+static rocksdb::ColumnFamilyHandle* KvFamily(Isolate* iso, Local<Value> v) {
+    auto* handle = DBManager::instance().cf(*String::Utf8Value(iso, v));
+    if (!handle) ThrowJs(iso, "Unknown column family");
+    return handle;
+}
+
+// Direct RocksDB key-value accessors (for blockchain module)
+static void JsDbKvPut(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (info.Length() < 3 || !info[0]->IsString() || !info[1]->IsString() || !info[2]->IsString()) {
+        ThrowJs(iso, "db.kvPut(cf,key,val) requires 3 strings");
+        return;
+    }
+    if (auto* h = KvFamily(iso, info[0])) KvPut(info, h, info[1], info[2]);
+}
+
+static void JsDbKvGet(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsString()) {
+        ThrowJs(iso, "db.kvGet(cf,key) requires 2 strings");
+        return;
+    }
+    if (auto* h = KvFamily(iso, info[0])) KvGet(info, h, info[1]);
+}
+
+static void JsDbKvDel(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsString()) {
+        ThrowJs(iso, "db.kvDel(cf,key) requires 2 strings");
+        return;
+    }
+    if (auto* h = KvFamily(iso, info[0])) KvDel(info, h, info[1]);
+}
+
+static void JsDbKvKeys(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (info.Length() < 1 || !info[0]->IsString()) {
+        ThrowJs(iso, "db.kvKeys(cf[,prefix]) requires cf string");
+        return;
+    }
+    if (auto* h = KvFamily(iso, info[0]))
+        KvKeys(info, h, info.Length() >= 2 ? info[1] : Undefined(iso).As<Value>());
+}
+
+static void JsDbKvScan(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (info.Length() < 1 || !info[0]->IsString()) {
+        ThrowJs(iso, "db.kvScan(cf[, opts]) requires cf string");
+        return;
+    }
+    if (auto* h = KvFamily(iso, info[0]))
+        KvScan(info, h, info.Length() >= 2 ? info[1] : Undefined(iso).As<Value>());
+}
+
+static void JsDbKvMultiGet(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (info.Length() < 2 || !info[0]->IsString()) {
+        ThrowJs(iso, "db.kvMultiGet(cf, keys) requires cf string and an array of keys");
+        return;
+    }
+    if (auto* h = KvFamily(iso, info[0])) KvMultiGet(info, h, info[1]);
+}
+
+// db.kvOpen(cf) -> {get(key), put(key, val), del(key), keys([prefix]),
+//                   scan([opts]), multiGet(keys)}
+// The column family is resolved once and kept in the handle. Open handles
+// lazily at run time, not while a module loads: the startup snapshot can't
+// hold the native pointer.
+static rocksdb::ColumnFamilyHandle* KvHandleOf(const FunctionCallbackInfo<Value>& info) {
+    Local<Object> self = info.This();
+    if (self->InternalFieldCount() < 1) {
+        ThrowJs(info.GetIsolate(), "not a kv handle");
+        return nullptr;
+    }
+    return static_cast<rocksdb::ColumnFamilyHandle*>(self->GetAlignedPointerFromInternalField(0));
+}
+
+static void JsKvHandleGet(const FunctionCallbackInfo<Value>& info) {
+    HandleScope hs(info.GetIsolate());
+    if (info.Length() < 1 || !info[0]->IsString()) { ThrowJs(info.GetIsolate(), "kv.get(key) requires a string"); return; }
+    if (auto* h = KvHandleOf(info)) KvGet(info, h, info[0]);
+}
+
+static void JsKvHandlePut(const FunctionCallbackInfo<Value>& info) {
+    HandleScope hs(info.GetIsolate());
+    if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsString()) { ThrowJs(info.GetIsolate(), "kv.put(key,val) requires 2 strings"); return; }
+    if (auto* h = KvHandleOf(info)) KvPut(info, h, info[0], info[1]);
+}
+
+static void JsKvHandleDel(const FunctionCallbackInfo<Value>& info) {
+    HandleScope hs(info.GetIsolate());
+    if (info.Length() < 1 || !info[0]->IsString()) { ThrowJs(info.GetIsolate(), "kv.del(key) requires a string"); return; }
+    if (auto* h = KvHandleOf(info)) KvDel(info, h, info[0]);
+}
+
+static void JsKvHandleKeys(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (auto* h = KvHandleOf(info))
+        KvKeys(info, h, info.Length() >= 1 ? info[0] : Undefined(iso).As<Value>());
+}
+
+static void JsKvHandleScan(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (auto* h = KvHandleOf(info))
+        KvScan(info, h, info.Length() >= 1 ? info[0] : Undefined(iso).As<Value>());
+}
+
+static void JsKvHandleMultiGet(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    if (auto* h = KvHandleOf(info))
+        KvMultiGet(info, h, info.Length() >= 1 ? info[0] : Undefined(iso).As<Value>());
+}
+
+static void JsDbKvOpen(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+    if (info.Length() < 1 || !info[0]->IsString()) {
+        ThrowJs(iso, "db.kvOpen(cf) requires cf string");
+        return;
+    }
+    auto* h = KvFamily(iso, info[0]);
+    if (!h) return;
+
+    Local<ObjectTemplate> tpl = ObjectTemplate::New(iso);
+    tpl->SetInternalFieldCount(1);
+    tpl->Set(String::NewFromUtf8(iso, "get",  NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsKvHandleGet));
+    tpl->Set(String::NewFromUtf8(iso, "put",  NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsKvHandlePut));
+    tpl->Set(String::NewFromUtf8(iso, "del",  NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsKvHandleDel));
+    tpl->Set(String::NewFromUtf8(iso, "keys", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsKvHandleKeys));
+    tpl->Set(String::NewFromUtf8(iso, "scan", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsKvHandleScan));
+    tpl->Set(String::NewFromUtf8(iso, "multiGet", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsKvHandleMultiGet));
+    Local<Object> obj;
+    if (!tpl->NewInstance(ctx).ToLocal(&obj)) return;
+    obj->SetAlignedPointerInInternalField(0, h);   // CF handles live as long as the DB
+    info.GetReturnValue().Set(obj);
+}
+
+// db.cacheStats() -> {enabled, hits, misses, hitRate, invalidations,
+// evictions, entries, bytes, capacity} of the SELECT result cache
+static void JsDbCacheStats(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    HandleScope hs(iso);
+    Local<Context> ctx = iso->GetCurrentContext();
+    auto st = QueryCache::instance().stats();
+    const uint64_t lookups = st.hits + st.misses;
+    Local<Object> obj = Object::New(iso);
+    auto set = [&](const char* k, Local<Value> v) {
+        obj->Set(ctx, String::NewFromUtf8(iso, k, NewStringType::kNormal).ToLocalChecked(), v).FromJust();
+    };
+    set("enabled",       Boolean::New(iso, QueryCache::instance().enabled()));
+    set("hits",          Number::New(iso, (double)st.hits));
+    set("misses",        Number::New(iso, (double)st.misses));
+    set("hitRate",       Number::New(iso, lookups ? (double)st.hits / (double)lookups : 0.0));
+    set("invalidations", Number::New(iso, (double)st.invalidations));
+    set("evictions",     Number::New(iso, (double)st.evictions));
+    set("entries",       Number::New(iso, (double)st.entries));
+    set("bytes",         Number::New(iso, (double)st.bytes));
+    set("capacity",      Number::New(iso, (double)st.capacity));
+    info.GetReturnValue().Set(obj);
+}
+
+static void BindDbObject(Isolate* iso, Local<Context> ctx) {
+    Isolate::Scope iscope(iso);
+    HandleScope hs(iso);
+
+    Local<ObjectTemplate> tpl = ObjectTemplate::New(iso);
+    tpl->Set(String::NewFromUtf8(iso,"query",NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsDbQuery));
+    tpl->Set(String::NewFromUtf8(iso,"execute",NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsDbExecute));
+    tpl->Set(String::NewFromUtf8(iso,"page",NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsDbPage));
+    tpl->Set(String::NewFromUtf8(iso,"queryMany",NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsDbQueryMany));
+    tpl->Set(String::NewFromUtf8(iso,"executeBatch",NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsDbExecuteBatch));
+    tpl->Set(String::NewFromUtf8(iso,"transaction",NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsDbTransaction));
+    tpl->Set(String::NewFromUtf8(iso,"cursor",NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsDbCursor));
+    tpl->Set(String::NewFromUtf8(iso,"queryAsync",NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsDbQueryAsync));
+    tpl->Set(String::NewFromUtf8(iso,"executeAsync",NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsDbExecuteAsync));
+    tpl->Set(String::NewFromUtf8(iso,"cacheStats",NewStringType::kNormal).ToLocalChecked(),
+             FunctionTemplate::New(iso, JsDbCacheStats));
+
+    tpl->Set(String::NewFromUtf8(iso,"kvPut",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvPut));
+    tpl->Set(String::NewFromUtf8(iso,"kvGet",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvGet));
+    tpl->Set(String::NewFromUtf8(iso,"kvDel",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvDel));
+    tpl->Set(String::NewFromUtf8(iso,"kvKeys",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvKeys));
+    tpl->Set(String::NewFromUtf8(iso,"kvScan",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvScan));
+    tpl->Set(String::NewFromUtf8(iso,"kvMultiGet",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvMultiGet));
+    tpl->Set(String::NewFromUtf8(iso,"kvOpen",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvOpen));
+
+    Local<Object> dbObj = tpl->NewInstance(ctx).ToLocalChecked();
+    Maybe<bool> ok = ctx->Global()
+       ->Set(ctx,
+             String::NewFromUtf8(iso, "db", NewStringType::kNormal).ToLocalChecked(),
+             dbObj);
+}
+
+//----------------------------------------------
+// shared.* : process-wide state for JS
+//----------------------------------------------
+// Module variables are per isolate, so anything all requests must agree on
+// (counters, read-modify-write sections) is kept here, in C++:
+//   shared.get(key) / shared.set(key, str)   plain string values
+//   shared.incr(key[, by]) / shared.max(key, n)   atomic numeric updates
+//   shared.lock(name, fn)   runs fn() holding a named, process-wide lock
+static std::mutex g_sharedMu;
+static std::unordered_map<std::string, std::string> g_sharedValues;
+static std::unordered_map<std::string, std::unique_ptr<std::recursive_mutex>> g_sharedLocks;
+
+static void JsSharedGet(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    if (info.Length() < 1 || !info[0]->IsString()) {
+        iso->ThrowException(String::NewFromUtf8(iso, "shared.get(key) requires a string", NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+    std::string key = *String::Utf8Value(iso, info[0]);
+    std::string val;
+    {
+        std::lock_guard<std::mutex> lk(g_sharedMu);
+        auto it = g_sharedValues.find(key);
+        if (it == g_sharedValues.end()) return;   // undefined
+        val = it->second;
+    }
+    info.GetReturnValue().Set(String::NewFromUtf8(iso, val.c_str(), NewStringType::kNormal).ToLocalChecked());
+}
+
+static void JsSharedSet(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    if (info.Length() < 2 || !info[0]->IsString()) {
+        iso->ThrowException(String::NewFromUtf8(iso, "shared.set(key,value) requires a key string", NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+    std::string key = *String::Utf8Value(iso, info[0]);
+    std::string val = *String::Utf8Value(iso, info[1]);
+    std::lock_guard<std::mutex> lk(g_sharedMu);
+    g_sharedValues[key] = val;
+}
+
+// incr (mode 0) adds `by`; max (mode 1) raises the value to at least n
+static void SharedUpdate(const FunctionCallbackInfo<Value>& info, int mode) {
+    Isolate* iso = info.GetIsolate();
+    Local<Context> ctx = iso->GetCurrentContext();
+    if (info.Length() < 1 || !info[0]->IsString() || (mode == 1 && info.Length() < 2)) {
+        iso->ThrowException(String::NewFromUtf8(iso,
+            mode == 0 ? "shared.incr(key[,by]) requires a key string" : "shared.max(key,n) requires key and number",
+            NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+    std::string key = *String::Utf8Value(iso, info[0]);
+    double arg = (info.Length() >= 2) ? info[1]->NumberValue(ctx).FromMaybe(0.0) : 1.0;
+    double v;
+    {
+        std::lock_guard<std::mutex> lk(g_sharedMu);
+        auto& slot = g_sharedValues[key];
+        double cur = slot.empty() ? 0.0 : std::atof(slot.c_str());
+        v = (mode == 0) ? cur + arg : std::max(cur, arg);
+        std::ostringstream os; os.precision(17); os << v;
+        slot = os.str();
+    }
+    info.GetReturnValue().Set(Number::New(iso, v));
+}
+static void JsSharedIncr(const FunctionCallbackInfo<Value>& info) { SharedUpdate(info, 0); }
+static void JsSharedMax (const FunctionCallbackInfo<Value>& info) { SharedUpdate(info, 1); }
+
+static void JsSharedLock(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    Local<Context> ctx = iso->GetCurrentContext();
+    if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsFunction()) {
+        iso->ThrowException(String::NewFromUtf8(iso, "shared.lock(name, fn) requires a name and a function", NewStringType::kNormal).ToLocalChecked());
+        return;
+    }
+    std::string name = *String::Utf8Value(iso, info[0]);
+    std::recursive_mutex* mu;
+    {
+        std::lock_guard<std::mutex> lk(g_sharedMu);
+        auto& p = g_sharedLocks[name];
+        if (!p) p.reset(new std::recursive_mutex);
+        mu = p.get();
+    }
+    std::lock_guard<std::recursive_mutex> held(*mu);
+    Local<Value> result;
+    if (info[1].As<Function>()->Call(ctx, ctx->Global(), 0, nullptr).ToLocal(&result))
+        info.GetReturnValue().Set(result);
+    // else: the JS exception propagates to the caller
+}
+
+static void BindSharedObject(Isolate* iso, Local<Context> ctx) {
+    Local<ObjectTemplate> tpl = ObjectTemplate::New(iso);
+    tpl->Set(String::NewFromUtf8(iso,"get",NewStringType::kNormal).ToLocalChecked(),  FunctionTemplate::New(iso, JsSharedGet));
+    tpl->Set(String::NewFromUtf8(iso,"set",NewStringType::kNormal).ToLocalChecked(),  FunctionTemplate::New(iso, JsSharedSet));
+    tpl->Set(String::NewFromUtf8(iso,"incr",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsSharedIncr));
+    tpl->Set(String::NewFromUtf8(iso,"max",NewStringType::kNormal).ToLocalChecked(),  FunctionTemplate::New(iso, JsSharedMax));
+    tpl->Set(String::NewFromUtf8(iso,"lock",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsSharedLock));
+
+    Local<Object> sharedObj = tpl->NewInstance(ctx).ToLocalChecked();
+    ctx->Global()
+       ->Set(ctx, String::NewFromUtf8(iso, "shared", NewStringType::kNormal).ToLocalChecked(), sharedObj)
+       .FromJust();
+}
+
+//----------------------------------------------
+// chain.* : the blockchain ledger's block log (ChainStore)
+//----------------------------------------------
+//   chain.append(block)                 block object or JSON text -> new length
+//   chain.length() / chain.block(i) / chain.last()
+//   chain.blocks([from[, limit]])       array of blocks from index from on
+//                                       (0, all), read in one scan
+//   chain.balance(account[, asOf])      {unit: value}; asOf an ISO-8601 UTC
+//                                       timestamp, as Date.toISOString() gives
+//   chain.transactions(account[, cursor[, limit]])
+//                                       {transactions, next}; next is null
+//                                       after the last page (limit 100)
+static Local<Value> ParseJsonText(Isolate* iso, Local<Context> ctx, const std::string& text) {
+    Local<String> s = String::NewFromUtf8(iso, text.data(), NewStringType::kNormal, (int)text.size()).ToLocalChecked();
+    Local<Value> v;
+    if (!JSON::Parse(ctx, s).ToLocal(&v)) return Null(iso);
+    return v;
+}
+
+static void JsChainAppend(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    Local<Context> ctx = iso->GetCurrentContext();
+    if (info.Length() < 1 || !(info[0]->IsString() || info[0]->IsObject())) {
+        ThrowJs(iso, "chain.append(block) requires a block object or its JSON");
+        return;
+    }
+    Local<String> text;
+    if (info[0]->IsString()) text = info[0].As<String>();
+    else if (!JSON::Stringify(ctx, info[0]).ToLocal(&text)) return;
+    try {
+        uint64_t n = ChainStore::instance().append(*String::Utf8Value(iso, text));
+        info.GetReturnValue().Set(Number::New(iso, (double)n));
+    } catch (const std::exception& e) {
+        ThrowJs(iso, e.what());
+    }
+}
+
+static void JsChainLength(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
     try {
-        std::string token = CppSignJwt(std::string(*pj), std::string(*sk));
-        info.GetReturnValue().Set(
-          v8::String::NewFromUtf8(iso, token.c_str(),
-            v8::NewStringType::kNormal).ToLocalChecked());
+        info.GetReturnValue().Set(Number::New(iso, (double)ChainStore::instance().length()));
     } catch (const std::exception& e) {
-        iso->ThrowException(
-          v8::String::NewFromUtf8(iso, e.what(),
-            v8::NewStringType::kNormal).ToLocalChecked());
+        ThrowJs(iso, e.what());
     }
 }
 
-static void JsCppVerifyJwt(const v8::FunctionCallbackInfo<v8::Value>& info) {
-    v8::Isolate* iso = info.GetIsolate();
-    v8::HandleScope hs(iso);
-    if (info.Length() != 2 || !info[0]->IsString() || !info[1]->IsString()) {
-        iso->ThrowException(
-          v8::String::NewFromUtf8(iso,
-            "CppVerifyJwt(token, secret) requires two strings",
-            v8::NewStringType::kNormal).ToLocalChecked());
+// block i as an object, null if there is none
+static void ChainBlock(const FunctionCallbackInfo<Value>& info, int64_t index) {
+    Isolate* iso = info.GetIsolate();
+    std::string text;
+    if (index < 0 || !ChainStore::instance().block((uint64_t)index, text)) {
+        info.GetReturnValue().SetNull();
+        return;
+    }
+    info.GetReturnValue().Set(ParseJsonText(iso, iso->GetCurrentContext(), text));
+}
+
+static void JsChainBlock(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    if (info.Length() < 1 || !info[0]->IsNumber()) {
+        ThrowJs(iso, "chain.block(index) requires a number");
         return;
     }
-    v8::String::Utf8Value tk(iso, info[0]);
-    v8::String::Utf8Value sk(iso, info[1]);
     try {
-        std::string payload = CppVerifyJwt(std::string(*tk), std::string(*sk));
-        info.GetReturnValue().Set(
-          v8::String::NewFromUtf8(iso, payload.c_str(),
-            v8::NewStringType::kNormal).ToLocalChecked());
+        ChainBlock(info, info[0]->IntegerValue(iso->GetCurrentContext()).FromMaybe(-1));
     } catch (const std::exception& e) {
-        iso->ThrowException(
-          v8::String::NewFromUtf8(iso, e.what(),
-            v8::NewStringType::kNormal).ToLocalChecked());
+        ThrowJs(iso, e.what());
     }
 }
 
-// -----------------------------------------------------------------------------
-// 2) The binding function
-// -----------------------------------------------------------------------------
-static void BindJwtUtils(v8::Isolate* iso, v8::Local<v8::Context> ctx) {
-    using namespace v8;
-
-    // CppSignJwt
-    Local<FunctionTemplate> signTpl = FunctionTemplate::New(iso, JsCppSignJwt);
-    Local<Function> signFn = signTpl->GetFunction(ctx).ToLocalChecked();
-    ctx->Global()
-       ->Set(ctx,
-             String::NewFromUtf8(iso, "CppSignJwt", NewStringType::kNormal)
-                 .ToLocalChecked(),
-             signFn)
-       .FromJust();
-
-    // CppVerifyJwt
-    Local<FunctionTemplate> verifyTpl = FunctionTemplate::New(iso, JsCppVerifyJwt);
-    Local<Function> verifyFn = verifyTpl->GetFunction(ctx).ToLocalChecked();
-    ctx->Global()
-       ->Set(ctx,
-             String::NewFromUtf8(iso, "CppVerifyJwt", NewStringType::kNormal)
-                 .ToLocalChecked(),
-             verifyFn)
-       .FromJust();
+static void JsChainBlocks(const FunctionCallbackInfo<Value>& info) {
+    Isolate* iso = info.GetIsolate();
+    Local<Context> ctx = iso->GetCurrentContext();
+    int64_t from = 0, limit = -1;
+    if (info.Length() >= 1 && info[0]->IsNumber()) from = info[0]->IntegerValue(ctx).FromMaybe(0);
+    if (info.Length() >= 2 && info[1]->IsNumber()) limit = info[1]->IntegerValue(ctx).FromMaybe(-1);
+    if (from < 0) from = 0;
+    try {
+        info.GetReturnValue().Set(ParseJsonText(iso, ctx,
+            ChainStore::instance().blocks((uint64_t)from, limit < 0 ? SIZE_MAX : (size_t)limit)));
+    } catch (const std::exception& e) {
+        ThrowJs(iso, e.what());
+    }
 }
 
-///
-
-static void BindRequire(Isolate* iso, Local<Context> ctx) {
-    Local<FunctionTemplate> tpl = FunctionTemplate::New(iso, RequireCallback);
-    Local<Function> requireFn = tpl->GetFunction(ctx).ToLocalChecked();
-    Maybe<bool> ok = ctx->Global()
-       ->Set(ctx,
-             String::NewFromUtf8(iso, "require", NewStringType::kNormal).ToLocalChecked(),
-             requireFn);
-       
+static void JsChainLast(const FunctionCallbackInfo<Value>& info) {
+    try {
+        ChainBlock(info, (int64_t)ChainStore::instance().length() - 1);
+    } catch (const std::exception& e) {
+        ThrowJs(info.GetIsolate(), e.what());
+    }
 }
 
-//----------------------------------------------
-// 2) db.query / db.execute bindings
-//----------------------------------------------
-static void JsDbQuery(const FunctionCallbackInfo<Value>& info) {
+static void JsChainBalance(const FunctionCallbackInfo<Value>& info) {
     Isolate* iso = info.GetIsolate();
-    HandleScope hs(iso);
-    Local<Context> ctx = iso->GetCurrentContext();
-
-    if (info.Length()<1 || !info[0]->IsString()) {
-        iso->ThrowException(String::NewFromUtf8(iso,"db.query(sql) requires string",NewStringType::kNormal).ToLocalChecked());
+    if (info.Length() < 1 || !info[0]->IsString()) {
+        ThrowJs(iso, "chain.balance(account[, asOf]) requires an account string");
         return;
     }
-    std::string sql = *String::Utf8Value(iso, info[0]);
-    //auto q = SqlParser::parse(sql);
-    QueryResult r;
-	QueryExecutor::execute(sql, r);
-	auto result = queryResultToJson(r);
-	
-    std::string out = crow::json::dump(result);
-    std::cout << "-------" << out << "---------" << std::endl;
-    Local<Value> jsonV8 = JSON::Parse(ctx,
-        String::NewFromUtf8(iso, out.c_str(), NewStringType::kNormal).ToLocalChecked()
-    ).ToLocalChecked();
-    info.GetReturnValue().Set(jsonV8);
+    std::string account = *String::Utf8Value(iso, info[0]);
+    std::string asOf;
+    if (info.Length() >= 2 && info[1]->IsString()) asOf = *String::Utf8Value(iso, info[1]);
+    try {
+        info.GetReturnValue().Set(ParseJsonText(iso, iso->GetCurrentContext(),
+                                                ChainStore::instance().balance(account, asOf)));
+    } catch (const std::exception& e) {
+        ThrowJs(iso, e.what());
+    }
 }
 
-static void JsDbExecute(const FunctionCallbackInfo<Value>& info) {
+static void JsChainTransactions(const FunctionCallbackInfo<Value>& info) {
     Isolate* iso = info.GetIsolate();
-    HandleScope hs(iso);
     Local<Context> ctx = iso->GetCurrentContext();
-
-    if (info.Length()<1 || !info[0]->IsString()) {
-        iso->ThrowException(String::NewFromUtf8(iso,"db.execute(sql) requires string",NewStringType::kNormal).ToLocalChecked());
+    if (info.Length() < 1 || !info[0]->IsString()) {
+        ThrowJs(iso, "chain.transactions(account[, cursor[, limit]]) requires an account string");
         return;
     }
-    std::string sql = *String::Utf8Value(iso, info[0]);
+    std::string account = *String::Utf8Value(iso, info[0]);
+    std::string cursor;
+    if (info.Length() >= 2 && info[1]->IsString()) cursor = *String::Utf8Value(iso, info[1]);
+    int64_t limit = 100;
+    if (info.Length() >= 3 && info[2]->IsNumber()) limit = info[2]->IntegerValue(ctx).FromMaybe(100);
+    if (limit < 1) limit = 1;
+
+    std::string next, page;
     try {
-        //auto q = SqlParser::parse(sql);
-        QueryResult r;
-		QueryExecutor::execute(sql, r);
-        Local<Object> obj = Object::New(iso);
-        Maybe<bool> ok = obj->Set(ctx,
-                 String::NewFromUtf8(iso,"success",NewStringType::kNormal).ToLocalChecked(),
-                 Boolean::New(iso,true));
-        info.GetReturnValue().Set(obj);
+        page = ChainStore::instance().transactions(account, cursor, (size_t)limit, next);
     } catch (const std::exception& e) {
-        Local<Object> obj = Object::New(iso);
-        Maybe<bool> ok = obj->Set(ctx,
-                 String::NewFromUtf8(iso,"success",NewStringType::kNormal).ToLocalChecked(),
-                 Boolean::New(iso,false));
-                 
-        Maybe<bool> err = obj->Set(ctx,
-                 String::NewFromUtf8(iso,"error",NewStringType::kNormal).ToLocalChecked(),
-                 String::NewFromUtf8(iso,e.what(),NewStringType::kNormal).ToLocalChecked());
-
-        info.GetReturnValue().Set(obj);
+        ThrowJs(iso, e.what());
+        return;
     }
+    Local<Object> out = Object::New(iso);
+    out->Set(ctx, String::NewFromUtf8(iso, "transactions", NewStringType::kNormal).ToLocalChecked(),
+             ParseJsonText(iso, ctx, page)).FromJust();
+    Local<Value> nextVal = next.empty() ? Null(iso).As<Value>()
+        : String::NewFromUtf8(iso, next.c_str(), NewStringType::kNormal).ToLocalChecked().As<Value>();
+    out->Set(ctx, String::NewFromUtf8(iso, "next", NewStringType::kNormal).ToLocalChecked(), nextVal).FromJust();
+    info.GetReturnValue().Set(out);
 }
 
-static void BindDbObject(Isolate* iso, Local<Context> ctx) {
-    Isolate::Scope iscope(iso);
-    HandleScope hs(iso);
-
+static void BindChainObject(Isolate* iso, Local<Context> ctx) {
     Local<ObjectTemplate> tpl = ObjectTemplate::New(iso);
-    tpl->Set(String::NewFromUtf8(iso,"query",NewStringType::kNormal).ToLocalChecked(),
-             FunctionTemplate::New(iso, JsDbQuery));
-    tpl->Set(String::NewFromUtf8(iso,"execute",NewStringType::kNormal).ToLocalChecked(),
-             FunctionTemplate::New(iso, JsDbExecute));
-
-    // Direct RocksDB key-value accessors (for blockchain module)
-    auto JsDbKvPut = [](const FunctionCallbackInfo<Value>& info){
-        Isolate* iso = info.GetIsolate();
-        HandleScope hs(iso);
-        if (info.Length() < 3 || !info[0]->IsString() || !info[1]->IsString() || !info[2]->IsString()) {
-            iso->ThrowException(String::NewFromUtf8(iso, "db.kvPut(cf,key,val) requires 3 strings", NewStringType::kNormal).ToLocalChecked());
-            return;
-        }
-        std::string cf   = *String::Utf8Value(iso, info[0]);
-        std::string key  = *String::Utf8Value(iso, info[1]);
-        std::string val  = *String::Utf8Value(iso, info[2]);
-        auto* handle = DBManager::instance().cf(cf);
-        if (!handle) {
-            iso->ThrowException(String::NewFromUtf8(iso, "Unknown column family", NewStringType::kNormal).ToLocalChecked());
-            return;
-        }
-        auto s = DBManager::instance().db()->Put(rocksdb::WriteOptions(), handle, key, val);
-        info.GetReturnValue().Set(Boolean::New(iso, s.ok()));
-    };
-
-    auto JsDbKvGet = [](const FunctionCallbackInfo<Value>& info){
-        Isolate* iso = info.GetIsolate();
-        HandleScope hs(iso);
-        if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsString()) {
-            iso->ThrowException(String::NewFromUtf8(iso, "db.kvGet(cf,key) requires 2 strings", NewStringType::kNormal).ToLocalChecked());
-            return;
-        }
-        std::string cf   = *String::Utf8Value(iso, info[0]);
-        std::string key  = *String::Utf8Value(iso, info[1]);
-        auto* handle = DBManager::instance().cf(cf);
-        if (!handle) {
-            iso->ThrowException(String::NewFromUtf8(iso, "Unknown column family", NewStringType::kNormal).ToLocalChecked());
-            return;
-        }
-        std::string val;
-        auto s = DBManager::instance().db()->Get(rocksdb::ReadOptions(), handle, key, &val);
-        if (!s.ok()) val.clear();
-        info.GetReturnValue().Set(String::NewFromUtf8(iso, val.c_str(), NewStringType::kNormal).ToLocalChecked());
-    };
-
-    auto JsDbKvDel = [](const FunctionCallbackInfo<Value>& info){
-        Isolate* iso = info.GetIsolate();
-        HandleScope hs(iso);
-        if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsString()) {
-            iso->ThrowException(String::NewFromUtf8(iso, "db.kvDel(cf,key) requires 2 strings", NewStringType::kNormal).ToLocalChecked());
-            return;
-        }
-        std::string cf   = *String::Utf8Value(iso, info[0]);
-        std::string key  = *String::Utf8Value(iso, info[1]);
-        auto* handle = DBManager::instance().cf(cf);
-        if (!handle) {
-            iso->ThrowException(String::NewFromUtf8(iso, "Unknown column family", NewStringType::kNormal).ToLocalChecked());
-            return;
-        }
-        auto s = DBManager::instance().db()->Delete(rocksdb::WriteOptions(), handle, key);
-        info.GetReturnValue().Set(Boolean::New(iso, s.ok()));
-    };
-
-    auto JsDbKvKeys = [](const FunctionCallbackInfo<Value>& info){
-        Isolate* iso = info.GetIsolate();
-        HandleScope hs(iso);
-        Local<Context> ctx = iso->GetCurrentContext();
-        if (info.Length() < 1 || !info[0]->IsString()) {
-            iso->ThrowException(String::NewFromUtf8(iso, "db.kvKeys(cf[,prefix]) requires cf string", NewStringType::kNormal).ToLocalChecked());
-            return;
-        }
-        std::string cf   = *String::Utf8Value(iso, info[0]);
-        std::string prefix = (info.Length() >= 2 && info[1]->IsString()) ? *String::Utf8Value(iso, info[1]) : std::string();
-        auto* handle = DBManager::instance().cf(cf);
-        if (!handle) {
-            iso->ThrowException(String::NewFromUtf8(iso, "Unknown column family", NewStringType::kNormal).ToLocalChecked());
-            return;
-        }
-        auto it = std::unique_ptr<rocksdb::Iterator>(DBManager::instance().db()->NewIterator(rocksdb::ReadOptions(), handle));
-        Local<Array> arr = Array::New(iso);
-        uint32_t idx = 0;
-        if (prefix.empty()) {
-            for (it->SeekToFirst(); it->Valid(); it->Next()) {
-                auto k = it->key().ToString();
-                arr->Set(ctx, idx++, String::NewFromUtf8(iso, k.c_str(), NewStringType::kNormal).ToLocalChecked()).FromJust();
-            }
-        } else {
-            for (it->Seek(prefix); it->Valid(); it->Next()) {
-                auto k = it->key().ToString();
-                if (k.rfind(prefix, 0) != 0) break;
-                arr->Set(ctx, idx++, String::NewFromUtf8(iso, k.c_str(), NewStringType::kNormal).ToLocalChecked()).FromJust();
-            }
-        }
-        info.GetReturnValue().Set(arr);
-    };
-
-    tpl->Set(String::NewFromUtf8(iso,"kvPut",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvPut));
-    tpl->Set(String::NewFromUtf8(iso,"kvGet",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvGet));
-    tpl->Set(String::NewFromUtf8(iso,"kvDel",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvDel));
-    tpl->Set(String::NewFromUtf8(iso,"kvKeys",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsDbKvKeys));
-
-    Local<Object> dbObj = tpl->NewInstance(ctx).ToLocalChecked();
-    Maybe<bool> ok = ctx->Global()
-       ->Set(ctx,
-             String::NewFromUtf8(iso, "db", NewStringType::kNormal).ToLocalChecked(),
-             dbObj);
+    tpl->Set(String::NewFromUtf8(iso,"append",NewStringType::kNormal).ToLocalChecked(),       FunctionTemplate::New(iso, JsChainAppend));
+    tpl->Set(String::NewFromUtf8(iso,"length",NewStringType::kNormal).ToLocalChecked(),       FunctionTemplate::New(iso, JsChainLength));
+    tpl->Set(String::NewFromUtf8(iso,"block",NewStringType::kNormal).ToLocalChecked(),        FunctionTemplate::New(iso, JsChainBlock));
+    tpl->Set(String::NewFromUtf8(iso,"blocks",NewStringType::kNormal).ToLocalChecked(),       FunctionTemplate::New(iso, JsChainBlocks));
+    tpl->Set(String::NewFromUtf8(iso,"last",NewStringType::kNormal).ToLocalChecked(),         FunctionTemplate::New(iso, JsChainLast));
+    tpl->Set(String::NewFromUtf8(iso,"balance",NewStringType::kNormal).ToLocalChecked(),      FunctionTemplate::New(iso, JsChainBalance));
+    tpl->Set(String::NewFromUtf8(iso,"transactions",NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(iso, JsChainTransactions));
+
+    Local<Object> chainObj = tpl->NewInstance(ctx).ToLocalChecked();
+    ctx->Global()
+       ->Set(ctx, String::NewFromUtf8(iso, "chain", NewStringType::kNormal).ToLocalChecked(), chainObj)
+       .FromJust();
 }
 
 //----------------------------------------------
@@ -434,9 +1504,9 @@ static v8::Local<v8::Value> InvokeApiFunction(v8::Isolate* iso,
                                               v8::Local<v8::Context> ctx,
                                               const std::string& fnName,
                                               const crow::json::rvalue& args) {
-    v8::Isolate::Scope iscope(iso);
-    v8::HandleScope    hs(iso);
-    v8::TryCatch       tc(iso);
+    v8::Isolate::Scope       iscope(iso);
+    v8::EscapableHandleScope hs(iso);
+    v8::TryCatch             tc(iso);
 
     // 1) Grab global `api`
     v8::Local<v8::Value> apiVal;
@@ -515,64 +1585,106 @@ static v8::Local<v8::Value> InvokeApiFunction(v8::Isolate* iso,
         return v8::Undefined(iso);
     }
 
-    return result;
+    return hs.Escape(result);
 }
 
-// Call the JS sanitize.safeStringify(value) helper and return its result as a std::string.
-// On any error (missing module, exception, etc.) it returns an empty string.
+// JSON for an API result, with sanitize.safeStringify's rules (cycles and
+// other unserializable values give "[]"), done natively so no JS runs for it.
+// Returns an empty string if the value has no JSON form.
 static std::string SafeStringify(v8::Isolate* isolate,
                                  v8::Local<v8::Context> ctx,
                                  v8::Local<v8::Value> element) {
-  	std::cout << "safe sanitize" << std::endl;
-    // 1) Create a local handle-scope for any temporaries we make
-    v8::HandleScope hs(isolate);
+    std::string out;
+    if (!V8Convert::toJson(isolate, ctx, element, out))
+        std::cerr << "[SafeStringify] value has no JSON form\n";
+    return out;
+}
 
-    // 2) Grab the sanitize module from global: `const sanitize = globalThis.sanitize;`
-    v8::Local<v8::Value> modVal;
-    if (!ctx->Global()
-             ->Get(ctx,
-                   v8::String::NewFromUtf8(isolate, "sanitize",
-                                           v8::NewStringType::kNormal)
-                       .ToLocalChecked())
-             .ToLocal(&modVal) ||
-        !modVal->IsObject()) {
-        std::cerr << "[SafeStringify] sanitize module not found\n";
-        return "";
+// Execute api.<fn>(body) and produce the HTTP status and response body.
+// Runs on an API pool thread with an isolate leased from the IsolatePool.
+static void RunApiRequest(const std::string& fn, const std::string& reqBody,
+                          const AuthMiddleware::context& auth,
+                          int& code, std::string& out) {
+    // 1) Parse JSON input, default to {}
+    auto body = crow::json::load(reqBody);
+    if (!body || body.t() != crow::json::type::Object)
+        body = crow::json::load("{}");
+
+    // --- V8 THREAD SETUP ---
+    // check out a free isolate; it is ours alone until the lease ends
+    IsolatePool::Lease lease;
+    v8::Isolate*      iso = lease.isolate();
+    v8::Locker        locker(iso);
+    v8::Isolate::Scope iscope(iso);
+    v8::HandleScope   hs(iso);
+
+    v8::Local<v8::Context> ctx = lease.context();
+    v8::Context::Scope context_scope(ctx);
+
+    // The middleware already verified the request's token: hand its claims
+    // to JS as requestAuth = {token, claims} (undefined on public routes),
+    // so auth.verify() of that same token costs nothing
+    {
+        v8::Local<v8::Value> ra = v8::Undefined(iso);
+        if (!auth.token.empty()) {
+            v8::Local<v8::Object> o = v8::Object::New(iso);
+            o->Set(ctx, v8::String::NewFromUtf8(iso, "token", v8::NewStringType::kNormal).ToLocalChecked(),
+                   v8::String::NewFromUtf8(iso, auth.token.c_str(), v8::NewStringType::kNormal).ToLocalChecked()).FromJust();
+            o->Set(ctx, v8::String::NewFromUtf8(iso, "claims", v8::NewStringType::kNormal).ToLocalChecked(),
+                   v8::String::NewFromUtf8(iso, auth.claims.c_str(), v8::NewStringType::kNormal).ToLocalChecked()).FromJust();
+            ra = o;
+        }
+        ctx->Global()->Set(ctx, v8::String::NewFromUtf8(iso, "requestAuth", v8::NewStringType::kNormal).ToLocalChecked(), ra).FromJust();
     }
-    auto modObj = modVal.As<v8::Object>();
 
-    // 3) Grab the safeStringify function: `const fn = sanitize.safeStringify;`
-    v8::Local<v8::Value> fnVal;
-    if (!modObj
-             ->Get(ctx,
-                   v8::String::NewFromUtf8(isolate, "safeStringify",
-                                           v8::NewStringType::kNormal)
-                       .ToLocalChecked())
-             .ToLocal(&fnVal) ||
-        !fnVal->IsFunction()) {
-        std::cerr << "[SafeStringify] sanitize.safeStringify not found\n";
-        return "";
+    // 2) Invoke your safe API function under TryCatch
+    v8::TryCatch tc(iso);
+    v8::Local<v8::Value> result = InvokeApiFunction(iso, ctx, fn, body);
+
+    // If the JS handler itself threw, catch it:
+    if (tc.HasCaught()) {
+        v8::String::Utf8Value err(iso, tc.Exception());
+        code = 500;
+        out  = std::string("JS handler exception: ") + *err;
+        return;
     }
-    auto stringifyFn = fnVal.As<v8::Function>();
 
-    // 4) Call it with our element as the single argument
-    v8::TryCatch tc(isolate);
-    v8::Local<v8::Value> argv[1] = { element };
-    v8::Local<v8::Value> strVal;
-    if (!stringifyFn->Call(ctx, ctx->Global(), 1, argv).ToLocal(&strVal)) {
-        v8::String::Utf8Value err(isolate, tc.Exception());
-        std::cerr << "[SafeStringify] JS exception: "
-                  << (*err ? *err : "<unknown>") << "\n";
-        return "";
+    // A handler may return a Promise: run microtasks and the completions of
+    // its async db calls until it settles. Work still in flight afterwards
+    // is drained too, since it refers to this isolate.
+    IsolatePool::Slot& slot = lease.slot();
+    if (result->IsPromise()) {
+        v8::Local<v8::Promise> promise = result.As<v8::Promise>();
+        for (;;) {
+            iso->PerformMicrotaskCheckpoint();
+            if (promise->State() != v8::Promise::kPending) break;
+            if (!IsolatePool::runPosted(slot, true)) break;   // nothing left that could settle it
+        }
+        if (promise->State() == v8::Promise::kFulfilled) {
+            result = promise->Result();
+        } else {
+            if (promise->State() == v8::Promise::kRejected) {
+                v8::String::Utf8Value err(iso, promise->Result());
+                std::cerr << "[InvokeApi] JS exception in api." << fn << " -> " << (*err ? *err : "<no reason>") << "\n";
+            } else {
+                std::cerr << "[InvokeApi] api." << fn << " returned a promise that never settled\n";
+            }
+            result = v8::Undefined(iso);
+        }
     }
+    while (IsolatePool::runPosted(slot, true)) iso->PerformMicrotaskCheckpoint();
 
-    // 5) Convert the returned JS string into a std::string
-    if (!strVal->IsString()) {
-        std::cerr << "[SafeStringify] Unexpected return type; expected String\n";
-        return "";
+    // 3) If handler returned undefined, 404
+    if (result->IsUndefined()) {
+        code = 404;
+        out  = "API handler undefined or error";
+        return;
     }
-    v8::String::Utf8Value utf8(isolate, strVal);
-    return *utf8 ? *utf8 : "";
+
+    // 4) Serialize straight into the response body; the isolate is
+    // released when we return, before the response is written
+    out = SafeStringify(iso, ctx, result);
+    code = 200;
 }
 
 #include <fstream>
@@ -603,52 +1715,36 @@ static std::string mime_for(std::string path) {
 }
 
 //----------------------------------------------
-// 4) main()
+// Per-isolate setup: bindings + auth/sanitize/business scripts
 //----------------------------------------------
-int main(int argc, char** argv) {
-	
-	// --- V8 init ---
-    //InitializeV8();
-    V8::InitializeICUDefaultLocation("");
-    V8::InitializeExternalStartupData("");
-    g_platform = platform::NewDefaultPlatform();
-    V8::InitializePlatform(g_platform.get());
-    V8::Initialize();
-
-    ArrayBuffer::Allocator* alloc = ArrayBuffer::Allocator::NewDefaultAllocator();
-    Isolate::CreateParams params;
-    params.array_buffer_allocator = alloc;
-    g_isolate = Isolate::New(params);
-    {
-    	Isolate::Scope isolate_scope(g_isolate);
-        HandleScope hs(g_isolate);
-        
-		// In main(), immediately after:
-		Local<Context> ctx = Context::New(g_isolate);
-		Context::Scope ctx_scope(ctx);
-		persistent_ctx.Reset(g_isolate, ctx);
+static bool InitIsolate(IsolatePool::Slot& slot) {
+    Isolate* iso = slot.isolate;
+    Local<Context> ctx = slot.context.Get(iso);
 
 		// 1) Bind require() & db & jwt
-        BindRequire(g_isolate, ctx);
-        BindDbObject(g_isolate, ctx);
-        BindJwtUtils(g_isolate, ctx);
+        BindRequire(iso, ctx);
+        BindDbObject(iso, ctx);
+        BindJwtUtils(iso, ctx);
+        BindCryptoUtils(iso, ctx);
+        BindSharedObject(iso, ctx);
+        BindChainObject(iso, ctx);
         
         // 2.1) Grab the global �require�  
 		v8::Local<v8::Value> require_val;
 		if (!ctx->Global()
-		        ->Get(ctx, v8::String::NewFromUtf8(g_isolate, "require",
+		        ->Get(ctx, v8::String::NewFromUtf8(iso, "require",
 		                                           v8::NewStringType::kNormal)
 		                             .ToLocalChecked())
 		        .ToLocal(&require_val) ||
 		    !require_val->IsFunction()) {
 			// handle the fact that �require� isn�t actually defined
-		  	return -1;
+		  	return false;
 		}
 		v8::Local<v8::Function> requireFn = require_val.As<v8::Function>();
 
 		// 2.2) Create the argument you actually want � a V8 string �auth�
 		v8::Local<v8::String> auth_str =
-		    v8::String::NewFromUtf8(g_isolate, "auth", v8::NewStringType::kNormal)
+		    v8::String::NewFromUtf8(iso, "auth", v8::NewStringType::kNormal)
 		        .ToLocalChecked();
 		v8::Local<v8::Value> require_argv[] = { auth_str };
 		
@@ -658,13 +1754,13 @@ int main(int argc, char** argv) {
 		v8::Local<v8::Value> authMod;
 		if (!maybe_mod.ToLocal(&authMod)) {
 		  // the require() threw an exception�handle it!
-		  return 0;
+		  return false;
 		}
 
 		// 2.4) Stash it back on the global as �auth�
 		ctx->Global()
 		    ->Set(ctx,
-		          v8::String::NewFromUtf8(g_isolate, "auth",
+		          v8::String::NewFromUtf8(iso, "auth",
 		                                  v8::NewStringType::kNormal)
 		              .ToLocalChecked(),
 		          authMod)
@@ -673,7 +1769,7 @@ int main(int argc, char** argv) {
 	
 		// ��� 2.5) require("sanitize") and stash it as global �sanitize� ������������
 		v8::Local<v8::String> sanitize_str =
-		    v8::String::NewFromUtf8(g_isolate, "sanitize", v8::NewStringType::kNormal)
+		    v8::String::NewFromUtf8(iso, "sanitize", v8::NewStringType::kNormal)
 		        .ToLocalChecked();
 		v8::Local<v8::Value> require_argv2[] = { sanitize_str };
 		
@@ -682,7 +1778,7 @@ int main(int argc, char** argv) {
 		         .ToLocal(&sanitizeModVal) ||
 		    !sanitizeModVal->IsObject()) {
 		    std::cerr << "[Init] ERROR: require(\"sanitize\") failed\n";
-		    return -1;  // or handle error
+		    return false;  // or handle error
 		}
 		
 		// stash it on global as `sanitize`
@@ -696,28 +1792,173 @@ int main(int argc, char** argv) {
         std::string biz = LoadScript("scripts/business.js");
 		/*Local<Script> bs = Script::Compile(
             ctx,
-            String::NewFromUtf8(g_isolate,biz.c_str(),NewStringType::kNormal).ToLocalChecked()
+            String::NewFromUtf8(iso,biz.c_str(),NewStringType::kNormal).ToLocalChecked()
         ).ToLocalChecked();
         bs->Run(ctx).ToLocalChecked();*/
         
-        TryCatch trycatch(g_isolate);
-		Local<String> source = String::NewFromUtf8(g_isolate, biz.c_str(), NewStringType::kNormal).ToLocalChecked();
-
+        TryCatch trycatch(iso);
 		Local<Script> bs;
-		if (!Script::Compile(ctx, source).ToLocal(&bs)) {
-    		String::Utf8Value err(g_isolate, trycatch.Exception());
+		if (!ScriptCache::compile(ctx, biz).ToLocal(&bs)) {
+    		String::Utf8Value err(iso, trycatch.Exception());
     		std::cerr << "[V8 COMPILE ERROR] " << *err << std::endl;
-    		return 1;
+    		return false;
 		}	
 		
 		Local<Value> result;
 		if (!bs->Run(ctx).ToLocal(&result)) {
-		    String::Utf8Value err(g_isolate, trycatch.Exception());
+		    String::Utf8Value err(iso, trycatch.Exception());
 		    std::cerr << "[V8 RUNTIME ERROR] " << *err << std::endl;
-		    return 1;
+		    return false;
 		}
-        
-   	} // V8 engine initial scope ends
+        return true;
+}
+
+// Every native callback the JS context can reach. Snapshots refer to them by
+// position in this list, so it only has to match between the binary that
+// wrote a snapshot and the one loading it (the snapshot key covers that).
+static const intptr_t g_externalRefs[] = {
+    reinterpret_cast<intptr_t>(RequireCallback),
+    reinterpret_cast<intptr_t>(JsCppSignJwt),
+    reinterpret_cast<intptr_t>(JsCppVerifyJwt),
+    reinterpret_cast<intptr_t>(JsCppSha256),
+    reinterpret_cast<intptr_t>(JsCppPbkdf2),
+    reinterpret_cast<intptr_t>(JsCppScrypt),
+    reinterpret_cast<intptr_t>(JsCppRandomId),
+    reinterpret_cast<intptr_t>(JsDbQuery),
+    reinterpret_cast<intptr_t>(JsDbExecute),
+    reinterpret_cast<intptr_t>(JsDbPage),
+    reinterpret_cast<intptr_t>(JsDbQueryMany),
+    reinterpret_cast<intptr_t>(JsDbExecuteBatch),
+    reinterpret_cast<intptr_t>(JsDbTransaction),
+    reinterpret_cast<intptr_t>(JsDbCursor),
+    reinterpret_cast<intptr_t>(JsCursorNext),
+    reinterpret_cast<intptr_t>(JsCursorClose),
+    reinterpret_cast<intptr_t>(JsDbQueryAsync),
+    reinterpret_cast<intptr_t>(JsDbExecuteAsync),
+    reinterpret_cast<intptr_t>(JsDbCacheStats),
+    reinterpret_cast<intptr_t>(JsDbKvPut),
+    reinterpret_cast<intptr_t>(JsDbKvGet),
+    reinterpret_cast<intptr_t>(JsDbKvDel),
+    reinterpret_cast<intptr_t>(JsDbKvKeys),
+    reinterpret_cast<intptr_t>(JsDbKvOpen),
+    reinterpret_cast<intptr_t>(JsKvHandleGet),
+    reinterpret_cast<intptr_t>(JsKvHandlePut),
+    reinterpret_cast<intptr_t>(JsKvHandleDel),
+    reinterpret_cast<intptr_t>(JsKvHandleKeys),
+    reinterpret_cast<intptr_t>(JsKvHandleScan),
+    reinterpret_cast<intptr_t>(JsKvHandleMultiGet),
+    reinterpret_cast<intptr_t>(JsDbKvScan),
+    reinterpret_cast<intptr_t>(JsDbKvMultiGet),
+    reinterpret_cast<intptr_t>(JsSharedGet),
+    reinterpret_cast<intptr_t>(JsSharedSet),
+    reinterpret_cast<intptr_t>(JsSharedIncr),
+    reinterpret_cast<intptr_t>(JsSharedMax),
+    reinterpret_cast<intptr_t>(JsSharedLock),
+    reinterpret_cast<intptr_t>(JsChainAppend),
+    reinterpret_cast<intptr_t>(JsChainLength),
+    reinterpret_cast<intptr_t>(JsChainBlock),
+    reinterpret_cast<intptr_t>(JsChainBlocks),
+    reinterpret_cast<intptr_t>(JsChainLast),
+    reinterpret_cast<intptr_t>(JsChainBalance),
+    reinterpret_cast<intptr_t>(JsChainTransactions),
+    0
+};
+
+// Snapshot key: V8 version, this build, and the content of every script
+// (FNV-1a). Editing any scripts/*.js file or rebuilding makes a new snapshot.
+static std::string SnapshotKey() {
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&h](const std::string& s) {
+        for (unsigned char c : s) { h ^= c; h *= 1099511628211ULL; }
+        h ^= 0xff; h *= 1099511628211ULL;   // field separator
+    };
+    mix(V8::GetVersion());
+    mix(__DATE__ " " __TIME__);
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it("scripts", ec), end; !ec && it != end; it.increment(ec))
+        if (it->is_regular_file() && it->path().extension() == ".js")
+            files.push_back(it->path().generic_string());
+    std::sort(files.begin(), files.end());
+    for (const auto& f : files) { mix(f); mix(LoadScript(f)); }
+    char buf[17];
+    std::snprintf(buf, sizeof buf, "%016llx", (unsigned long long)h);
+    return buf;
+}
+
+// Load .v8cache/snapshot-<key>.bin, or build it (InitIsolate in a
+// SnapshotCreator) and write it for the next start. Empty on failure, in
+// which case the isolates run InitIsolate themselves.
+static std::string LoadOrCreateSnapshot() {
+    const fs::path dir = ".v8cache";
+    const fs::path file = dir / ("snapshot-" + SnapshotKey() + ".bin");
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (in) {
+            std::string blob{ std::istreambuf_iterator<char>(in), {} };
+            if (!blob.empty()) {
+                std::cout << "[Snapshot] using " << file.string() << std::endl;
+                return blob;
+            }
+        }
+    }
+    std::string blob = IsolatePool::createSnapshot(InitIsolate, g_externalRefs);
+    if (blob.empty()) return blob;
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        auto name = it->path().filename().string();
+        if (name.rfind("snapshot-", 0) == 0) fs::remove(it->path(), ec);   // stale keys
+    }
+    // write-then-rename so a crash never leaves a truncated snapshot behind
+    const fs::path tmp = file.string() + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(blob.data(), (std::streamsize)blob.size());
+        if (!out) {
+            std::cerr << "[Snapshot] cannot write " << tmp.string() << std::endl;
+            return blob;
+        }
+    }
+    fs::rename(tmp, file, ec);
+    std::cout << "[Snapshot] created " << file.string() << " (" << blob.size() << " bytes)" << std::endl;
+    return blob;
+}
+
+//----------------------------------------------
+// 4) main()
+//----------------------------------------------
+int main(int argc, char** argv) {
+	
+	// --- V8 init ---
+    //InitializeV8();
+    V8::InitializeICUDefaultLocation("");
+    V8::InitializeExternalStartupData("");
+    g_platform = platform::NewDefaultPlatform();
+    V8::InitializePlatform(g_platform.get());
+    V8::Initialize();
+
+    // One isolate per concurrently running request (QUARKSQL_ISOLATES,
+    // default: one per core), all started from a snapshot of the loaded
+    // scripts unless QUARKSQL_SNAPSHOT=0
+    size_t isolates = WorkerPool::defaultParallelism();
+    if (const char* env = std::getenv("QUARKSQL_ISOLATES")) {
+        long v = std::atol(env);
+        if (v > 0) isolates = (size_t)v;
+    }
+    // On-disk code cache for compiled scripts (QUARKSQL_CODE_CACHE=0 disables)
+    if (const char* env = std::getenv("QUARKSQL_CODE_CACHE")) {
+        std::string v(env);
+        if (v == "0" || v == "false" || v == "FALSE") ScriptCache::setEnabled(false);
+    }
+    std::string snapshot;
+    {
+        const char* env = std::getenv("QUARKSQL_SNAPSHOT");
+        std::string v = env ? env : "1";
+        if (v != "0" && v != "false" && v != "FALSE") snapshot = LoadOrCreateSnapshot();
+    }
+    if (!IsolatePool::instance().init(isolates, InitIsolate, std::move(snapshot), g_externalRefs)) return 1;
     
 	
     crow::App<AuthMiddleware> app;
@@ -729,12 +1970,54 @@ int main(int argc, char** argv) {
             AuthMiddleware::SetQueryTokenFallback(false);
         }
     }
+    // ORDER BY memory budget (MB) before sorted runs spill to QUARKSQL_TMPDIR
+    if (const char* env = std::getenv("QUARKSQL_SORT_MEM_MB")) {
+        long mb = std::atol(env);
+        if (mb > 0) ExternalSorter::setDefaultMemoryBudget((size_t)mb * 1024 * 1024);
+    }
+    if (const char* env = std::getenv("QUARKSQL_TMPDIR")) {
+        ExternalSorter::setDefaultTempDir(env);
+    }
+    // Default scan parallelism (a query can override it with PARALLEL n)
+    if (const char* env = std::getenv("QUARKSQL_SCAN_DOP")) {
+        long dop = std::atol(env);
+        if (dop > 0) WorkerPool::setDefaultParallelism((size_t)dop);
+    }
+    // Threads running API handlers (the Crow threads only do I/O)
+    {
+        long n = (long)WorkerPool::defaultParallelism();
+        if (const char* env = std::getenv("QUARKSQL_API_THREADS")) {
+            long v = std::atol(env);
+            if (v > 0) n = v;
+        }
+        g_apiPool.reset(new WorkerPool((size_t)n));
+    }
+    // JWT secret and verified-token cache (QUARKSQL_JWT_CACHE entries, 0 = off)
+    {
+        const char* sec = std::getenv("QUARKSQL_JWT_SECRET");
+        size_t cap = 10000;
+        if (const char* env = std::getenv("QUARKSQL_JWT_CACHE")) cap = (size_t)std::max(0L, std::atol(env));
+        JwtVerifier::instance().configure(sec && *sec ? sec : JwtVerifier::instance().secret(), cap);
+    }
+    // SELECT result cache budget (MB); 0 or unset = off
+    if (const char* env = std::getenv("QUARKSQL_QUERY_CACHE_MB")) {
+        long mb = std::atol(env);
+        if (mb > 0) {
+            QueryCache::instance().configure((size_t)mb * 1024 * 1024);
+            std::cout << "[QueryCache] " << mb << " MB" << std::endl;
+        }
+    }
+    // Cancel a request's queries once they run longer than this
+    if (const char* env = std::getenv("QUARKSQL_QUERY_TIMEOUT_MS")) {
+        g_queryTimeoutMs = std::max(0L, std::atol(env));
+    }
 
 	
 	// --- Schema & DB init ---
 	SchemaManager::loadFromFile("schemas.json");
 	if (!DBManager::instance().init("quarks_db")) return 1;
 	IndexManager::rebuildAll();
+	ViewManager::load();
 	
 	// ---------- Crow route wiring for LLM ----------
     /*CROW_ROUTE(app, "/llm/generateCode")
@@ -781,47 +2064,30 @@ int main(int argc, char** argv) {
 	CROW_ROUTE(app, "/api/<string>")
 	    .methods("POST"_method)
 	([&](const crow::request& req, crow::response& res, std::string fn) {
-	    // 1) Parse JSON input, default to {}
-	    auto body = crow::json::load(req.body);
-	    if (!body || body.t() != crow::json::type::Object)
-	        body = crow::json::load("{}");
-	
-	    // �� V8 THREAD SETUP ��
-	    v8::Locker        locker(g_isolate);
-	    v8::Isolate::Scope iscope(g_isolate);
-	    v8::HandleScope   hs(g_isolate);
-	
-	    v8::Local<v8::Context> ctx = persistent_ctx.Get(g_isolate);
-	    
-		//----Inner Context Scope (�new scope�) ����
-		v8::Context::Scope context_scope(ctx);
-		// ������������������
-	
-	    // 2) Invoke your safe API function under TryCatch
-	    v8::TryCatch tc(g_isolate);
-	    v8::Local<v8::Value> result = InvokeApiFunction(g_isolate, ctx, fn, body);
-	
-	    // If the JS handler itself threw, catch it:
-	    if (tc.HasCaught()) {
-	        v8::String::Utf8Value err(g_isolate, tc.Exception());
-	        res.code = 500;
-	        return res.end(std::string("JS handler exception: ") + *err);
-	    }
-	    
-	    // 3) If handler returned undefined, 404 
-	    if (result->IsUndefined()) {
-	        res.code = 404;
-	        return res.end("API handler undefined or error");
-	    }
-	    
-	    // 4) Safely JSON.stringify the result
-	    std::string s;
-		s = SafeStringify(g_isolate, ctx, result);	
-		std::cout << "got result: " << s << std::endl;
-	
-		res.set_header("Content-Type", "application/json");
-		return res.end(s);
-
+	    // The handler (JS + SQL) runs on the API pool; the Crow thread only
+	    // queues it and goes back to I/O. The response is completed on the
+	    // connection's own io_service.
+	    auto* io = req.io_service;
+	    AuthMiddleware::context auth = app.get_context<AuthMiddleware>(req);
+	    g_apiPool->submit([&res, io, fn, reqBody = req.body, auth = std::move(auth)] {
+	        int code = 200;
+	        std::string out;
+	        try {
+	            CancellationToken token;
+	            if (g_queryTimeoutMs > 0)
+	                token.cancelAfter(std::chrono::milliseconds(g_queryTimeoutMs));
+	            CancellationToken::Scope scope(token);
+	            RunApiRequest(fn, reqBody, auth, code, out);
+	        } catch (const std::exception& e) {
+	            code = 500;
+	            out  = std::string("API handler failed: ") + e.what();
+	        }
+	        io->post([&res, code, out = std::move(out)] {
+	            res.code = code;
+	            if (code == 200) res.set_header("Content-Type", "application/json");
+	            res.end(out);
+	        });
+	    });
 	});
     
     /////////
@@ -886,10 +2152,10 @@ int main(int argc, char** argv) {
 
 
 	// OPTIONAL, to be extra-sure there really are no left-over scopes (may cause core dump)
- 	//g_isolate->Exit();
+ 	//iso->Exit();
 
 	// --- Cleanup V8 --- (will cause core dump)
-    //g_isolate->Dispose();
+    //iso->Dispose();
         
     V8::Dispose();
     V8::ShutdownPlatform();
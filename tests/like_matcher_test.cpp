@@ -0,0 +1,147 @@
+// like_matcher_test.cpp
+#include "LikeMatcher.h"
+#include <gtest/gtest.h>
+#include <cctype>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using Kind = LikeMatcher::Kind;
+
+bool like(const std::string& pattern, const std::string& s) {
+    return LikeMatcher(pattern).matches(s);
+}
+bool ilike(const std::string& pattern, const std::string& s) {
+    return LikeMatcher(pattern, true).matches(s);
+}
+
+// textbook backtracking LIKE (no escapes), the reference for random patterns
+bool naiveLike(std::string_view p, std::string_view s) {
+    if (p.empty()) return s.empty();
+    if (p[0] == '%') {
+        for (size_t i = 0; i <= s.size(); ++i)
+            if (naiveLike(p.substr(1), s.substr(i))) return true;
+        return false;
+    }
+    if (s.empty()) return false;
+    return (p[0] == '_' || p[0] == s[0]) && naiveLike(p.substr(1), s.substr(1));
+}
+
+}
+
+TEST(LikeMatcher, Classification) {
+    EXPECT_EQ(LikeMatcher("abc").kind(), Kind::Exact);
+    EXPECT_EQ(LikeMatcher("abc%").kind(), Kind::Prefix);
+    EXPECT_EQ(LikeMatcher("%abc").kind(), Kind::Suffix);
+    EXPECT_EQ(LikeMatcher("%abc%").kind(), Kind::Contains);
+    EXPECT_EQ(LikeMatcher("%").kind(), Kind::All);
+    EXPECT_EQ(LikeMatcher("%%").kind(), Kind::All);
+    EXPECT_EQ(LikeMatcher("a_c").kind(), Kind::General);
+    EXPECT_EQ(LikeMatcher("a%c").kind(), Kind::General);
+    EXPECT_EQ(LikeMatcher("ab_d%").literalPrefix(), "ab");
+    EXPECT_EQ(LikeMatcher("abc%").literalPrefix(), "abc");
+    EXPECT_EQ(LikeMatcher("%abc").literalPrefix(), "");
+}
+
+TEST(LikeMatcher, PercentAndUnderscore) {
+    EXPECT_TRUE(like("abc", "abc"));
+    EXPECT_FALSE(like("abc", "abcd"));
+    EXPECT_TRUE(like("", ""));
+    EXPECT_FALSE(like("", "a"));
+    EXPECT_TRUE(like("%", ""));
+    EXPECT_TRUE(like("ab%", "ab"));
+    EXPECT_FALSE(like("ab%", "a"));
+    EXPECT_TRUE(like("%yz", "xyz"));
+    EXPECT_TRUE(like("%b%", "abc"));
+    EXPECT_FALSE(like("%d%", "abc"));
+    EXPECT_TRUE(like("a_c", "abc"));
+    EXPECT_FALSE(like("a_c", "ac"));
+    EXPECT_FALSE(like("a_c", "abbc"));
+    EXPECT_TRUE(like("___", "xyz"));
+    EXPECT_FALSE(like("___", "xy"));
+    EXPECT_TRUE(like("_%", "x"));
+    EXPECT_FALSE(like("_%", ""));
+    EXPECT_TRUE(like("%_", "x"));
+    EXPECT_TRUE(like("a%c%e", "abcde"));
+    EXPECT_TRUE(like("a%c%e", "ace"));
+    EXPECT_FALSE(like("a%c%e", "acx"));
+    EXPECT_TRUE(like("%a_c%", "xxabcxx"));
+    EXPECT_FALSE(like("%a_c%", "xxacxx"));
+    EXPECT_TRUE(like("ab%ab", "abab"));
+    EXPECT_FALSE(like("ab%ab", "aba"));   // anchors may not overlap
+    EXPECT_TRUE(like("%aab", "aaab"));
+}
+
+TEST(LikeMatcher, MatchesNaiveReference) {
+    std::mt19937 rng(1);
+    const char alphabet[] = "ab%_";
+    for (int t = 0; t < 20000; ++t) {
+        std::string p, s;
+        for (int i = rng() % 7; i > 0; --i) p += alphabet[rng() % 4];
+        for (int i = rng() % 9; i > 0; --i) s += alphabet[rng() % 2];
+        ASSERT_EQ(like(p, s), naiveLike(p, s)) << "pattern '" << p << "' on '" << s << "'";
+    }
+}
+
+TEST(LikeMatcher, Escapes) {
+    EXPECT_TRUE(like("100\\%", "100%"));
+    EXPECT_FALSE(like("100\\%", "1000"));
+    EXPECT_EQ(LikeMatcher("100\\%").kind(), Kind::Exact);
+    EXPECT_TRUE(like("a\\_c", "a_c"));
+    EXPECT_FALSE(like("a\\_c", "abc"));
+    EXPECT_TRUE(like("a\\\\b", "a\\b"));
+    EXPECT_TRUE(like("%\\%%", "50% off"));
+    EXPECT_FALSE(like("%\\%%", "50 off"));
+    EXPECT_EQ(LikeMatcher("%\\%%").kind(), Kind::Contains);
+    EXPECT_TRUE(like("\\%_", "%x"));
+    EXPECT_FALSE(like("\\%_", "ax"));
+    EXPECT_EQ(LikeMatcher("a\\%b%").literalPrefix(), "a%b");
+    EXPECT_TRUE(like("ab\\", "ab\\"));   // a trailing backslash is literal
+}
+
+TEST(LikeMatcher, IlikeFoldsCase) {
+    EXPECT_TRUE(ilike("abc", "ABC"));
+    EXPECT_TRUE(ilike("ABC", "abc"));
+    EXPECT_TRUE(ilike("Ab%", "aBxyz"));
+    EXPECT_TRUE(ilike("%XyZ", "fooxYz"));
+    EXPECT_TRUE(ilike("%mid%", "SOME MID TEXT"));
+    EXPECT_TRUE(ilike("a_C%e", "AbcdE"));
+    EXPECT_FALSE(ilike("abc", "abd"));
+    EXPECT_FALSE(like("abc", "ABC"));
+    EXPECT_TRUE(LikeMatcher("x", true).caseInsensitive());
+    EXPECT_EQ(LikeMatcher("AbC%", true).literalPrefix(), "abc");
+}
+
+TEST(LikeMatcher, FindAtVectorBoundaries) {
+    // the SSE2 loop covers positions while i + m - 1 + 16 <= n, the scalar
+    // tail the rest; put the needle at every offset of haystacks just below,
+    // at and just above one vector's worth of candidates
+    for (size_t m : { 2, 3, 5, 16, 17 }) {
+        std::string needle(m, 'n');
+        needle.front() = 'A';
+        needle.back() = 'Z';
+        for (size_t n : { m - 1 + 15, m - 1 + 16, m - 1 + 17 }) {
+            // decoys share the first and last byte but never the middle
+            std::string clean(n, '.');
+            if (m > 2)
+                for (size_t i = 0; i + m <= n; i += 3) { clean[i] = 'A'; clean[i + m - 1] = 'Z'; }
+            EXPECT_EQ(LikeMatcher::find(clean, needle), std::string_view::npos) << "m=" << m << " n=" << n;
+
+            for (size_t pos = 0; pos + m <= n; ++pos) {
+                std::string h = clean;
+                h.replace(pos, m, needle);
+                size_t expect = std::string_view(h).find(needle);
+                EXPECT_EQ(LikeMatcher::find(h, needle), expect) << "m=" << m << " n=" << n << " pos=" << pos;
+                for (size_t from : { size_t(1), size_t(7) })
+                    EXPECT_EQ(LikeMatcher::find(h, needle, from), std::string_view(h).find(needle, from))
+                        << "m=" << m << " n=" << n << " pos=" << pos << " from=" << from;
+                EXPECT_TRUE(LikeMatcher("%" + needle + "%").matches(h));
+            }
+        }
+    }
+    EXPECT_EQ(LikeMatcher::find("abc", "", 2), 2u);
+    EXPECT_EQ(LikeMatcher::find("abc", "x", 4), std::string_view::npos);
+    EXPECT_EQ(LikeMatcher::find("ab", "abc"), std::string_view::npos);
+}
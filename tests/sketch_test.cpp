@@ -0,0 +1,130 @@
+// sketch_test.cpp
+#include "Sketch.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+HyperLogLog hllOf(int from, int to) {
+    HyperLogLog h;
+    for (int i = from; i < to; ++i) h.add("v" + std::to_string(i));
+    return h;
+}
+
+// fraction of the sorted sample below x
+double rankOf(const std::vector<double> &sorted, double x) {
+    return double(std::lower_bound(sorted.begin(), sorted.end(), x) - sorted.begin()) / sorted.size();
+}
+
+}
+
+TEST(HyperLogLog, SparseRoundTrip) {
+    HyperLogLog h = hllOf(0, 100);
+    std::string s = h.serialize();
+    ASSERT_TRUE(HyperLogLog::isSerialized(s));
+    EXPECT_EQ(s[5], 's');
+    HyperLogLog back = HyperLogLog::parse(s);
+    EXPECT_EQ(back.serialize(), s);
+    EXPECT_DOUBLE_EQ(back.estimate(), h.estimate());
+}
+
+TEST(HyperLogLog, DenseRoundTrip) {
+    HyperLogLog h = hllOf(0, 50000);
+    std::string s = h.serialize();
+    EXPECT_EQ(s[5], 'd');
+    EXPECT_EQ(s.size(), 6 + 2 * HyperLogLog::kRegisters);
+    HyperLogLog back = HyperLogLog::parse(s);
+    EXPECT_EQ(back.serialize(), s);
+    EXPECT_DOUBLE_EQ(back.estimate(), h.estimate());
+}
+
+TEST(HyperLogLog, ParseRejectsMalformed) {
+    EXPECT_THROW(HyperLogLog::parse("hll1:"), std::runtime_error);
+    EXPECT_THROW(HyperLogLog::parse("hll1:x"), std::runtime_error);
+    EXPECT_THROW(HyperLogLog::parse("hll1:s00"), std::runtime_error);
+    EXPECT_THROW(HyperLogLog::parse("hll1:szz001"), std::runtime_error);
+    EXPECT_THROW(HyperLogLog::parse("hll1:d00"), std::runtime_error);
+    EXPECT_THROW(HyperLogLog::parse("tdigest1:0,0"), std::runtime_error);
+}
+
+TEST(HyperLogLog, MergeEqualsUnion) {
+    // overlapping halves: the merge is the register-wise max, so it must
+    // equal the sketch built over the union
+    HyperLogLog a = hllOf(0, 30000), b = hllOf(20000, 60000);
+    a.merge(b);
+    EXPECT_EQ(a.serialize(), hllOf(0, 60000).serialize());
+
+    HyperLogLog empty;
+    empty.merge(b);
+    EXPECT_EQ(empty.serialize(), b.serialize());
+    b.merge(HyperLogLog());
+    EXPECT_EQ(empty.serialize(), b.serialize());
+}
+
+TEST(HyperLogLog, ErrorBound) {
+    // 2^12 registers give ~1.6% standard error; allow three of them
+    for (int n : { 100, 1000, 10000, 100000, 1000000 }) {
+        double e = hllOf(0, n).estimate();
+        EXPECT_NEAR(e / n, 1.0, 3 * 0.016) << "n=" << n;
+    }
+    // duplicates don't count
+    HyperLogLog h = hllOf(0, 5000);
+    h.merge(hllOf(0, 5000));
+    for (int i = 0; i < 5000; ++i) h.add("v" + std::to_string(i));
+    EXPECT_NEAR(h.estimate() / 5000, 1.0, 3 * 0.016);
+}
+
+TEST(TDigest, QuantilesMatchExact) {
+    std::mt19937 rng(42);
+    std::lognormal_distribution<double> dist(3.0, 1.0);   // skewed tail
+    std::vector<double> xs(200000);
+    TDigest d;
+    for (auto &x : xs) { x = dist(rng); d.add(x); }
+    std::sort(xs.begin(), xs.end());
+
+    // compare in rank space: the estimate should sit near the requested quantile
+    EXPECT_NEAR(rankOf(xs, d.quantile(0.5)),  0.5,  0.01);
+    EXPECT_NEAR(rankOf(xs, d.quantile(0.9)),  0.9,  0.005);
+    EXPECT_NEAR(rankOf(xs, d.quantile(0.99)), 0.99, 0.002);
+    EXPECT_EQ(d.quantile(0.0), xs.front());
+    EXPECT_EQ(d.quantile(1.0), xs.back());
+}
+
+TEST(TDigest, MergeAndRoundTrip) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> dist(0.0, 1000.0);
+    std::vector<double> xs;
+    TDigest parts[4];
+    for (int i = 0; i < 100000; ++i) {
+        double x = dist(rng);
+        xs.push_back(x);
+        parts[i % 4].add(x);
+    }
+    std::sort(xs.begin(), xs.end());
+
+    // merging serialized parts, as a view roll-up does
+    TDigest all;
+    for (auto &p : parts) all.merge(TDigest::parse(p.serialize()));
+    EXPECT_DOUBLE_EQ(all.count(), 100000.0);
+    for (double q : { 0.5, 0.9, 0.99 })
+        EXPECT_NEAR(rankOf(xs, all.quantile(q)), q, 0.01) << "q=" << q;
+
+    std::string s = all.serialize();
+    TDigest back = TDigest::parse(s);
+    EXPECT_EQ(back.serialize(), s);
+}
+
+TEST(TDigest, EmptyAndMalformed) {
+    TDigest d;
+    EXPECT_TRUE(d.empty());
+    EXPECT_EQ(d.quantile(0.5), 0.0);
+    EXPECT_THROW(TDigest::parse("tdigest1:"), std::runtime_error);
+    EXPECT_THROW(TDigest::parse("tdigest1:1,2;3"), std::runtime_error);
+    EXPECT_THROW(TDigest::parse("tdigest1:1,2;3:0"), std::runtime_error);
+    EXPECT_THROW(TDigest::parse("hll1:s"), std::runtime_error);
+}